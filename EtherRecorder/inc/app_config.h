@@ -52,6 +52,18 @@ bool get_config_bool(const char* section, const char* key, bool default_value);
 
 
 
+typedef void (*ConfigKeyVisitor)(const char* key, const char* value, void* context);
+
+/**
+ * @brief Calls visit with each key of a section and its value, for settings
+ *        whose keys are not known in advance, such as per thread labels.
+ *
+ * @param section The section of the configuration.
+ * @param visit Called once per key.
+ * @param context Passed on to visit.
+ */
+void for_each_config_key(const char* section, ConfigKeyVisitor visit, void* context);
+
 /**
  * @brief Frees all resources used by the configuration system.
  */
@@ -0,0 +1,35 @@
+/**
+ * @file base64_encode.h
+ * @brief Bytes to base64 text (RFC 4648, with padding), 12 or 24 bytes at a time.
+ *
+ * On x86-64 the bytes go through AVX2 or SSSE3 where the CPU has them; the
+ * choice is made once, on the first call. Other targets, and the bytes left
+ * over at the end, take a table lookup per 6 bits.
+ */
+#ifndef BASE64_ENCODE_H
+#define BASE64_ENCODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Characters base64_encode writes for a number of bytes.
+ */
+#define BASE64_ENCODED_SIZE(length) ((((length) + 2) / 3) * 4)
+
+/**
+ * @brief Writes the base64 text of some bytes.
+ *
+ * @param data Bytes to encode
+ * @param length Number of bytes
+ * @param out Receives BASE64_ENCODED_SIZE(length) characters; no terminator is written
+ * @return The number of characters written
+ */
+size_t base64_encode(const uint8_t* data, size_t length, char* out);
+
+/**
+ * @brief Name of the encoder base64_encode uses: "avx2", "ssse3" or "scalar".
+ */
+const char* base64_encode_variant(void);
+
+#endif // BASE64_ENCODE_H
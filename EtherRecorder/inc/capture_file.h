@@ -0,0 +1,96 @@
+/**
+ * @file capture_file.h
+ * @brief Capture of received payloads.
+ *
+ * With [logger] receive_capture = true, each receive thread writes every
+ * read, exactly as received, to a file of its own in receive_capture_path,
+ * named <thread label>_<YYYYmmdd_HHMMSS>.cap (or .jsonl) after the time the
+ * thread started, and logs one summary line per read in place of a hex
+ * dump. The file is written through a platform file writer, so on Linux
+ * the disk writes go through io_uring rather than the receive thread.
+ *
+ * A binary capture starts with CAPTURE_FILE_MAGIC. Each read follows as a
+ * CaptureRecordHeader_T and then its payload, in host byte order. A JSON
+ * capture holds one docs/LOG_FORMAT_SPEC.md payload record per line, the
+ * payload in base64.
+ */
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform_sockets.h"
+
+#define CAPTURE_FILE_MAGIC "ETHCAP1"     // 7 characters and a terminator
+#define CAPTURE_FILE_MAGIC_SIZE 8
+
+/**
+ * @brief Precedes each payload in a capture file.
+ */
+typedef struct CaptureRecordHeader_T {
+    uint64_t time_ns;                    // wall clock at the read, ns since the epoch
+    uint32_t length;                     // payload bytes that follow
+    uint32_t reserved;
+} CaptureRecordHeader_T;
+
+typedef enum CaptureFormat {
+    CAPTURE_FORMAT_BINARY,               // CaptureRecordHeader_T and payload per read
+    CAPTURE_FORMAT_JSON                  // a JSON payload record per line
+} CaptureFormat;
+
+/**
+ * @brief The connection a capture is of, for the metadata of JSON records.
+ */
+typedef struct CaptureConnection_T {
+    bool is_tcp;
+    bool has_endpoints;                  // local and remote are filled in
+    PlatformSocketAddress local;
+    PlatformSocketAddress remote;
+} CaptureConnection_T;
+
+typedef struct CaptureFile CaptureFile;
+
+/**
+ * @brief Creates a thread's capture file.
+ *
+ * A second file for the same label within the same second takes a _2,
+ * _3, ... suffix rather than replacing the first.
+ *
+ * @param directory Directory for the file, created if missing
+ * @param label Thread label, which names the file
+ * @param format Layout of the file
+ * @param connection The connection captured, or NULL if unknown
+ * @return The capture file, or NULL if it could not be created
+ */
+CaptureFile* capture_file_open(const char* directory, const char* label, CaptureFormat format,
+                               const CaptureConnection_T* connection);
+
+/**
+ * @brief Appends one read.
+ *
+ * @param capture Capture file
+ * @param data Bytes received
+ * @param length Number of bytes
+ * @param offset Receives the offset of the record in the file
+ * @return false if the file could not be written
+ */
+bool capture_file_write(CaptureFile* capture, const void* data, size_t length, uint64_t* offset);
+
+/**
+ * @brief Hands anything buffered to the disk, without waiting for it.
+ */
+void capture_file_flush(CaptureFile* capture);
+
+/**
+ * @brief Writes out what is buffered and closes the file.
+ */
+void capture_file_close(CaptureFile* capture);
+
+/**
+ * @brief Path of the capture file.
+ */
+const char* capture_file_path(const CaptureFile* capture);
+
+#endif // CAPTURE_FILE_H
@@ -27,8 +27,8 @@ typedef struct {
     uint32_t chunk_delay_ms;           ///< Delay between chunks
     uint32_t reload_delay_ms;          ///< Delay before reloading in loop mode
     uint32_t queue_timeout_ms;         ///< Timeout for queue operations
-    uint32_t max_queue_size;           ///< Maximum queue size
-    bool block_when_full;              ///< Whether to block when queue is full
+    uint32_t max_queue_size;           ///< Most messages the reader keeps queued at the target; 0 for no limit
+    bool block_when_full;              ///< Wait for room when the target is full, rather than drop the chunk
     bool log_progress;                 ///< Whether to log progress
     uint32_t progress_interval_ms;     ///< Progress logging interval
 } FileReaderConfig;
@@ -0,0 +1,29 @@
+/**
+ * @file hex_encode.h
+ * @brief Bytes to hexadecimal text, 16 or 32 bytes at a time.
+ *
+ * On x86-64 the bytes go through SSE2, or AVX2 where the CPU has it; the
+ * choice is made once, on the first call. Other targets, and the bytes left
+ * over at the end, take a table lookup per byte.
+ */
+#ifndef HEX_ENCODE_H
+#define HEX_ENCODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Writes two uppercase hex digits per byte.
+ *
+ * @param data Bytes to encode
+ * @param length Number of bytes
+ * @param out Receives 2 * length characters; no terminator is written
+ */
+void hex_encode(const uint8_t* data, size_t length, char* out);
+
+/**
+ * @brief Name of the encoder hex_encode uses: "avx2", "sse2" or "scalar".
+ */
+const char* hex_encode_variant(void);
+
+#endif // HEX_ENCODE_H
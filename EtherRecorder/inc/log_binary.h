@@ -0,0 +1,119 @@
+/**
+ * @file log_binary.h
+ * @brief Encoding and decoding of the binary log file format.
+ *
+ * A binary log file is a sequence of segments. Each segment starts with a
+ * header giving the timestamp precision and index width the text layout
+ * uses, followed by label records that map thread ids to thread labels.
+ * Entry records follow, carrying the index as a varint delta from the
+ * previous entry in the segment, the timestamp as nanoseconds since the
+ * epoch, the level, the thread id and the message bytes.
+ *
+ * A new segment is started whenever the logger (re)opens the file, so a
+ * segment can be decoded on its own. See docs/LOG_FORMAT_SPEC.md.
+ */
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_BINARY_MAGIC "ETHLOG"
+#define LOG_BINARY_MAGIC_LENGTH 6
+#define LOG_BINARY_VERSION 1
+#define LOG_BINARY_VARINT_MAX 10      // Bytes in the longest varint (a uint64_t)
+#define LOG_BINARY_HEADER_MAX_SIZE (LOG_BINARY_MAGIC_LENGTH + 4 + LOG_BINARY_VARINT_MAX)
+#define LOG_BINARY_MAX_THREADS 256    // Thread ids per segment
+
+/** Bytes a record adds to its text: type, varints, timestamp and level */
+#define LOG_BINARY_RECORD_OVERHEAD (1 + 3 * LOG_BINARY_VARINT_MAX + 8 + 1)
+
+/**
+ * @brief Kinds of record in a binary log file.
+ */
+typedef enum LogBinaryRecordType {
+    LOG_BINARY_RECORD_ENTRY = 0x01,     // A log entry
+    LOG_BINARY_RECORD_LABEL = 0x02,     // Defines or redefines a thread id's label
+    LOG_BINARY_RECORD_SEGMENT = 'E'     // Segment header, the first byte of the magic
+} LogBinaryRecordType;
+
+/**
+ * @brief Result of decoding one record.
+ */
+typedef enum LogBinaryStatus {
+    LOG_BINARY_OK,
+    LOG_BINARY_END,          // No bytes left, or only the zeroed tail of a preallocated file
+    LOG_BINARY_TRUNCATED,    // The record runs past the end of the data
+    LOG_BINARY_INVALID       // Not a record this version understands
+} LogBinaryStatus;
+
+/**
+ * @brief A decoded record. text points into the decoded data.
+ */
+typedef struct LogBinaryRecord_T {
+    LogBinaryRecordType type;
+    uint64_t index_delta;        // Entry: index less the previous entry's
+    uint64_t timestamp_ns;       // Entry: nanoseconds since the epoch
+    uint8_t level;               // Entry: LogLevel
+    uint16_t thread_id;          // Entry and label
+    const char *text;            // Entry: message, label: thread label; not NUL terminated
+    size_t length;
+    uint8_t fraction_digits;     // Segment: digits after the seconds in the text layout
+    uint8_t index_width;         // Segment: zero padded width of the index
+    uint64_t label_count;        // Segment: label records that follow the header
+} LogBinaryRecord_T;
+
+/**
+ * @brief Writes a value as an unsigned LEB128 varint.
+ * @param out Destination, at least LOG_BINARY_VARINT_MAX bytes.
+ * @param value The value.
+ * @return The number of bytes written.
+ */
+size_t log_binary_put_varint(uint8_t *out, uint64_t value);
+
+/**
+ * @brief Writes a segment header.
+ * @param out Destination, at least LOG_BINARY_HEADER_MAX_SIZE bytes.
+ * @param fraction_digits Digits after the seconds in the text layout.
+ * @param index_width Zero padded width of the index in the text layout.
+ * @param label_count Number of label records the caller writes next.
+ * @return The number of bytes written.
+ */
+size_t log_binary_encode_header(uint8_t *out, uint8_t fraction_digits, uint8_t index_width,
+                                uint64_t label_count);
+
+/**
+ * @brief Writes a label record.
+ * @param out Destination, at least LOG_BINARY_RECORD_OVERHEAD + length bytes.
+ * @param thread_id The thread id.
+ * @param label The thread label.
+ * @param length Bytes of label.
+ * @return The number of bytes written.
+ */
+size_t log_binary_encode_label(uint8_t *out, uint16_t thread_id, const char *label, size_t length);
+
+/**
+ * @brief Writes an entry record.
+ * @param out Destination, at least LOG_BINARY_RECORD_OVERHEAD + length bytes.
+ * @param index_delta The entry's index less the previous entry's in the segment.
+ * @param timestamp_ns Nanoseconds since the epoch.
+ * @param level The LogLevel.
+ * @param thread_id The id of the thread's label.
+ * @param message The message text.
+ * @param length Bytes of message.
+ * @return The number of bytes written.
+ */
+size_t log_binary_encode_entry(uint8_t *out, uint64_t index_delta, uint64_t timestamp_ns, uint8_t level,
+                               uint16_t thread_id, const char *message, size_t length);
+
+/**
+ * @brief Decodes the record at *cursor and advances past it.
+ * @param cursor Position in the data; only advanced on LOG_BINARY_OK.
+ * @param end End of the data.
+ * @param record Receives the record.
+ * @return LOG_BINARY_OK, or why no record could be decoded.
+ */
+LogBinaryStatus log_binary_decode_record(const uint8_t **cursor, const uint8_t *end, LogBinaryRecord_T *record);
+
+#endif // LOG_BINARY_H
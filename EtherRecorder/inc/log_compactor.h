@@ -0,0 +1,34 @@
+/**
+ * @file log_compactor.h
+ * @brief Background compression of rotated log files.
+ *
+ * The logger hands each file it rotates to the compactor thread, which
+ * replaces it with a log_lz.h compressed copy named <file>.lz. The thread
+ * runs at the lowest priority the platform offers, so it only uses cycles
+ * the receive and send threads leave idle.
+ */
+#ifndef LOG_COMPACTOR_H
+#define LOG_COMPACTOR_H
+
+#include <stdbool.h>
+
+#include "app_thread.h"
+
+/**
+ * @brief Gets the compactor thread configuration.
+ * @return The thread configuration.
+ */
+ThreadConfig* get_log_compactor_thread(void);
+
+/**
+ * @brief Queues a rotated log file for compression.
+ *
+ * Never blocks on the compression itself; safe to call with the logging
+ * mutex held.
+ *
+ * @param file_name The rotated file.
+ * @return true if queued, false if the compactor is not running or is full.
+ */
+bool log_compactor_submit(const char* file_name);
+
+#endif // LOG_COMPACTOR_H
@@ -0,0 +1,96 @@
+/**
+ * @file log_flight.h
+ * @brief Flight recorder: the most recent log entries in a memory-mapped ring.
+ *
+ * Every entry a thread logs is also copied into a fixed ring of records in a
+ * shared file mapping, before it is queued for the logger thread. The copy
+ * reaches the file as soon as it is stored, so when the process dies, with
+ * entries still queued or staged, or with the logger thread hung, the ring
+ * still holds the last records. etherlog-recover decodes it.
+ *
+ * A producer takes a sequence with one atomic add, claims its slot by
+ * swapping the older sequence there for LOG_FLIGHT_SEQUENCE_BUSY, and
+ * publishes the record with one atomic store: no locks and no waiting on
+ * other threads. A producer lapped while it was preempted finds a newer
+ * sequence or a busy slot and drops its entry, rather than mixing it into
+ * another producer's record. A record caught busy by a crash is skipped
+ * rather than decoded half written.
+ */
+#ifndef LOG_FLIGHT_H
+#define LOG_FLIGHT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "logger.h"
+#include "platform_atomic.h"
+
+#define LOG_FLIGHT_MAGIC "ETHFLT1"      // 7 characters and a terminator
+#define LOG_FLIGHT_VERSION 2
+#define LOG_FLIGHT_HEADER_SIZE 64        // records start one cache line in
+#define LOG_FLIGHT_RECORD_SIZE 512
+#define LOG_FLIGHT_LABEL_SIZE 32
+#define LOG_FLIGHT_DATA_SIZE (LOG_FLIGHT_RECORD_SIZE - 24 - LOG_FLIGHT_LABEL_SIZE)
+#define LOG_FLIGHT_SEQUENCE_BUSY UINT64_MAX  // record sequence while a producer fills it
+
+// Recorder states, in the header
+#define LOG_FLIGHT_STATE_RUNNING 1       // process was running; a crash leaves it so
+#define LOG_FLIGHT_STATE_CLOSED 2        // logger shut down cleanly
+
+/**
+ * @brief Start of the flight recorder file.
+ */
+typedef struct LogFlightHeader_T {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t record_count;
+    uint32_t state;                      // LOG_FLIGHT_STATE_*
+    uint64_t created_time_ns;            // wall clock when the ring was created, ns since the epoch
+    PlatformAtomicUInt64 next_sequence;  // sequence the next record takes
+    uint8_t reserved[LOG_FLIGHT_HEADER_SIZE - 40];
+} LogFlightHeader_T;
+
+/**
+ * @brief One slot of the ring.
+ *
+ * A deferred entry keeps its format string followed by its packed
+ * arguments, rendered by the decoder; any other entry keeps its text.
+ */
+typedef struct LogFlightRecord_T {
+    PlatformAtomicUInt64 sequence;       // record's sequence + 1 once complete, 0 if never written, or busy
+    uint64_t elapsed_ns;                 // entry's timestamp, ns after the ring was created
+    uint8_t level;
+    uint8_t deferred;                    // 1 if data is a format and packed arguments
+    uint16_t format_length;              // deferred: bytes of format, then its terminator
+    uint16_t length;                     // bytes of data in use
+    uint16_t reserved;
+    char thread_label[LOG_FLIGHT_LABEL_SIZE];
+    char data[LOG_FLIGHT_DATA_SIZE];
+} LogFlightRecord_T;
+
+/**
+ * @brief Creates the ring file and maps it.
+ *
+ * A file left by an earlier run is first renamed to <file>.prev, so the
+ * records of a run that crashed survive a restart.
+ *
+ * @param file_name Path of the ring file; /dev/shm keeps it off the disk on Linux.
+ * @param record_count Records in the ring.
+ * @return true if the recorder is running.
+ */
+bool log_flight_open(const char* file_name, uint32_t record_count);
+
+/**
+ * @brief Copies an entry into the ring. Safe from any thread, never blocks.
+ *
+ * Does nothing unless the recorder is running.
+ */
+void log_flight_record(const LogEntry_T* entry);
+
+/**
+ * @brief Marks the ring cleanly closed and stops recording; the file is kept.
+ */
+void log_flight_close(void);
+
+#endif // LOG_FLIGHT_H
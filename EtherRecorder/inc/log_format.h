@@ -0,0 +1,69 @@
+/**
+ * @file log_format.h
+ * @brief Deferred formatting of log messages.
+ *
+ * Instead of running vsnprintf on the calling thread, a call site's format
+ * string is parsed once into a list of argument kinds. Each call then only
+ * copies the raw argument values into the log entry, and the logger thread
+ * renders the text when it publishes the entry.
+ */
+#ifndef LOG_FORMAT_H
+#define LOG_FORMAT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdarg.h>
+
+#include "logger.h"
+
+/**
+ * @brief Kinds of argument a deferred format string may consume.
+ */
+typedef enum LogArgKind {
+    LOG_ARG_INT,         // int and anything promoted to it (%d %u %x %c %hd ...)
+    LOG_ARG_LONG,        // %ld %lu %lx
+    LOG_ARG_LLONG,       // %lld %llu %llx
+    LOG_ARG_INTMAX,      // %jd %ju
+    LOG_ARG_SIZE,        // %zu %zd
+    LOG_ARG_PTRDIFF,     // %td
+    LOG_ARG_DOUBLE,      // %f %e %g %a
+    LOG_ARG_LDOUBLE,     // %Lf %Le %Lg %La
+    LOG_ARG_PTR,         // %p
+    LOG_ARG_STRING       // %s, copied into the entry
+} LogArgKind;
+
+/**
+ * @brief Parses a call site's format string on first use.
+ *
+ * Safe to call from any thread; the first caller parses and later callers
+ * reuse the result.
+ *
+ * @param site The call site.
+ * @param format The format string passed at the call site.
+ * @return true if calls with this format can be deferred, false if they
+ *         must be formatted on the calling thread.
+ */
+bool log_format_prepare_site(LogCallSite_T *site, const char *format);
+
+/**
+ * @brief Copies the arguments of one call into a packed buffer.
+ * @param site A call site for which log_format_prepare_site returned true.
+ * @param buffer Destination for the packed arguments.
+ * @param size Size of the destination buffer.
+ * @param args The call's arguments.
+ * @param packed_size Receives the number of bytes used.
+ * @return true on success, false if the arguments do not fit.
+ */
+bool log_format_pack_args(const LogCallSite_T *site, char *buffer, size_t size, va_list args,
+                          size_t *packed_size);
+
+/**
+ * @brief Renders a packed call into text.
+ * @param site The call site the arguments were packed for.
+ * @param packed The packed arguments.
+ * @param out Destination for the text, always NUL terminated.
+ * @param size Size of the destination buffer.
+ */
+void log_format_render(const LogCallSite_T *site, const char *packed, char *out, size_t size);
+
+#endif // LOG_FORMAT_H
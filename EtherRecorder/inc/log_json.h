@@ -0,0 +1,75 @@
+/**
+ * @file log_json.h
+ * @brief Streaming JSON writer into a caller's buffer.
+ *
+ * Builds one JSON object at a time, members in the order they are written,
+ * with no allocation: the caller supplies the buffer, usually on its stack.
+ * A value that does not fit marks the writer overflowed, and
+ * log_json_finish then reports the record as lost rather than writing it
+ * half formed. Strings are escaped 16 bytes at a time on x86-64; bytes from
+ * 0x80 up are copied as they are, so UTF-8 text passes through.
+ */
+#ifndef LOG_JSON_H
+#define LOG_JSON_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Most bytes log_json_string can need for a string of a given length.
+ */
+#define LOG_JSON_STRING_SIZE(length) ((length) * 6 + 2)
+
+/**
+ * @brief Writer state; fill in with log_json_init.
+ */
+typedef struct LogJsonWriter {
+    char* out;
+    size_t capacity;
+    size_t length;
+    bool need_comma;                     // a member has been written at this level
+    bool overflowed;                     // a value did not fit; the record is lost
+} LogJsonWriter;
+
+/**
+ * @brief Starts a record in a buffer.
+ */
+void log_json_init(LogJsonWriter* writer, char* buffer, size_t capacity);
+
+void log_json_begin_object(LogJsonWriter* writer);
+void log_json_end_object(LogJsonWriter* writer);
+
+/**
+ * @brief Writes a member name. It is written as given, so must need no escaping.
+ */
+void log_json_key(LogJsonWriter* writer, const char* key);
+
+/**
+ * @brief Writes a string value, escaped.
+ */
+void log_json_string(LogJsonWriter* writer, const char* text, size_t length);
+
+void log_json_uint(LogJsonWriter* writer, uint64_t value);
+
+/**
+ * @brief Writes an RFC 3339 UTC timestamp string, e.g. "2024-01-20T15:04:05.123456Z".
+ *
+ * @param seconds Seconds since the epoch
+ * @param nanoseconds Nanoseconds into the second
+ * @param fraction_digits Digits after the seconds, 0 to 9
+ */
+void log_json_timestamp(LogJsonWriter* writer, int64_t seconds, uint32_t nanoseconds, int fraction_digits);
+
+/**
+ * @brief Writes bytes as a base64 string value.
+ */
+void log_json_base64(LogJsonWriter* writer, const void* data, size_t length);
+
+/**
+ * @brief Ends the record with a newline.
+ * @return The record's length, or 0 if it overflowed the buffer.
+ */
+size_t log_json_finish(LogJsonWriter* writer);
+
+#endif // LOG_JSON_H
@@ -0,0 +1,93 @@
+/**
+ * @file log_lz.h
+ * @brief Built-in LZ compression of rotated log files.
+ *
+ * The codec is a byte-oriented LZ77 in the style of LZ4: sequences of
+ * literals followed by a back reference of at least four bytes into the
+ * previous 64 KiB. It needs no tables to decode and runs at several
+ * hundred MB/s, which suits log text made of long repeated prefixes.
+ *
+ * A compressed log file holds the file in independently compressed blocks,
+ * followed by a trailer index of where each block starts, so it can be
+ * decompressed from any block. Blocks end at a line break where there is
+ * one, so a text log decompressed from any block starts on a whole line.
+ * See docs/LOG_FORMAT_SPEC.md.
+ */
+#ifndef LOG_LZ_H
+#define LOG_LZ_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define LOG_LZ_MAGIC "ETHLZ"
+#define LOG_LZ_MAGIC_LENGTH 5
+#define LOG_LZ_VERSION 1
+#define LOG_LZ_TRAILER_MAGIC "ETHLZIDX"
+#define LOG_LZ_FILE_SUFFIX ".lz"
+#define LOG_LZ_DEFAULT_BLOCK_SIZE 0x100000  // 1 MiB of log per block
+
+/**
+ * @brief Largest compressed size of length bytes.
+ */
+#define LOG_LZ_COMPRESS_BOUND(length) ((length) + (length) / 255 + 16)
+
+/**
+ * @brief Compresses a buffer.
+ * @param source The bytes to compress.
+ * @param length Bytes in source.
+ * @param destination Receives the compressed bytes.
+ * @param capacity Size of destination; LOG_LZ_COMPRESS_BOUND(length) always suffices.
+ * @return The compressed size, or 0 if it did not fit.
+ */
+size_t log_lz_compress(const uint8_t *source, size_t length, uint8_t *destination, size_t capacity);
+
+/**
+ * @brief Decompresses a buffer produced by log_lz_compress.
+ * @param source The compressed bytes.
+ * @param length Bytes in source.
+ * @param destination Receives the original bytes.
+ * @param raw_length The original size.
+ * @return true on success, false if the data is damaged.
+ */
+bool log_lz_decompress(const uint8_t *source, size_t length, uint8_t *destination, size_t raw_length);
+
+/**
+ * @brief Callback polled between blocks; returning true abandons the work.
+ */
+typedef bool (*LogLzCancel_T)(void);
+
+/**
+ * @brief Compresses a file into the block format.
+ *
+ * The output is written under a temporary name and renamed into place once
+ * complete, so a partial file is never left under the final name.
+ *
+ * @param source_file The file to compress; left in place.
+ * @param destination_file The compressed file to create.
+ * @param block_size Bytes of the source per block.
+ * @param cancel Optional; checked between blocks.
+ * @return true if destination_file was written.
+ */
+bool log_lz_compress_file(const char *source_file, const char *destination_file, size_t block_size,
+                          LogLzCancel_T cancel);
+
+/**
+ * @brief Checks whether a buffer starts like a compressed log file.
+ */
+bool log_lz_is_compressed(const uint8_t *data, size_t size);
+
+/**
+ * @brief Decompresses a compressed log file held in memory.
+ * @param data The compressed file.
+ * @param size Bytes in data.
+ * @param first_block Index of the block to start from, 0 for the whole file.
+ * @param count Blocks to decompress, 0 for all from first_block on.
+ * @param raw_size Receives the number of bytes returned.
+ * @return The decompressed bytes, to be freed by the caller, or NULL if the
+ *         file is damaged or has fewer blocks.
+ */
+uint8_t *log_lz_decompress_file(const uint8_t *data, size_t size, uint64_t first_block, uint64_t count,
+                               size_t *raw_size);
+
+#endif // LOG_LZ_H
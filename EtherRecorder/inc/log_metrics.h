@@ -0,0 +1,86 @@
+/**
+ * @file log_metrics.h
+ * @brief Counters and histograms of the logging pipeline.
+ *
+ * Producers count into the LogQueueStats_T of the queue they push to. Each
+ * thread has a queue of its own, so those counters are written by one
+ * thread only and cost a load and a store rather than a locked add. Every
+ * other figure is kept by the logger thread, which also writes the report,
+ * so nothing here is shared between producers.
+ *
+ * The report goes to the log on request (the "metrics" command) and when
+ * the logger shuts down, if [logger] metrics = true.
+ */
+#ifndef LOG_METRICS_H
+#define LOG_METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "platform_atomic.h"
+
+#define LOG_METRICS_LATENCY_BUCKETS 32   // Bucket n counts latencies of 2^(n-1) to 2^n - 1 ns
+#define LOG_METRICS_DEPTH_BUCKETS 10     // Queue fill in steps of 10%
+#define LOG_METRICS_HISTORY_SECONDS 60   // Per-second figures kept for the report
+#define LOG_METRICS_LEVELS 8             // LogLevel values, LOG_TRACE to LOG_FATAL
+
+/**
+ * @brief Producer side counters of one log queue.
+ */
+typedef struct LogQueueStats_T {
+    PlatformAtomicUInt64 submitted;      // Entries submitted
+    PlatformAtomicUInt64 overflows;      // Submits that found the queue full
+    PlatformAtomicUInt64 latency[LOG_METRICS_LATENCY_BUCKETS];  // Entry timestamp to queued
+} LogQueueStats_T;
+
+/**
+ * @brief Whether metrics are collected; set once from config at start-up.
+ */
+extern bool g_log_metrics_enabled;
+
+/**
+ * @brief Adds one queue's counters to a running total.
+ */
+void log_metrics_add_queue_stats(LogQueueStats_T *total, const LogQueueStats_T *stats);
+
+/**
+ * @brief Bucket index of a latency in nanoseconds.
+ */
+unsigned log_metrics_latency_bucket(uint64_t latency_ns);
+
+/**
+ * @brief Records one pass of the logger over the queues. Logger thread only.
+ * @param drained Entries published in the pass.
+ * @param fill Fill of the fullest queue, 0.0 to 1.0.
+ */
+void log_metrics_note_drain(uint32_t drained, double fill);
+
+/**
+ * @brief Adds entries dropped by the overflow policy. Logger thread only.
+ */
+void log_metrics_note_dropped(const uint64_t counts[LOG_METRICS_LEVELS]);
+
+/**
+ * @brief Adds entries withheld by call site rate limits. Logger thread only.
+ */
+void log_metrics_note_suppressed(uint64_t count);
+
+/**
+ * @brief Asks the logger thread to write a report at its next housekeeping pass.
+ */
+void log_metrics_request_report(void);
+
+/**
+ * @brief Takes a pending report request.
+ * @return true if a report was requested since the last call.
+ */
+bool log_metrics_take_report_request(void);
+
+/**
+ * @brief Writes the report, one line per call to emit. Logger thread only.
+ * @param queues Producer counters summed over every queue.
+ * @param emit Writes one line.
+ */
+void log_metrics_report(const LogQueueStats_T *queues, void (*emit)(const char *line));
+
+#endif // LOG_METRICS_H
@@ -1,51 +1,243 @@
 /*
 * @file log_queue.h
 * @brief Contains the log queue functions.
+*
+* A log queue is a bounded byte ring of variable-length records. Each record
+* is a LogRecordHeader_T followed by the thread label and the message (text,
+* or packed arguments for a deferred entry), padded to LOG_RECORD_ALIGN bytes,
+* so a record only takes the space it uses.
+*
+* head and tail are free-running byte positions. A producer reserves a record
+* by advancing head by its size, writes the body and publishes it by storing
+* the non-zero size, together with the record's position, into the header
+* last. The consumer reads the record at tail, zeroes it and advances tail, so
+* any header not yet published reads as zero. A record that runs past the end of the ring continues into a slack
+* area of LOG_RECORD_MAX_SIZE bytes rather than wrapping, keeping each record
+* contiguous.
+*
+* Every thread started through app_thread gets its own single-producer ring,
+* so the logging fast path touches no cache line shared with other
+* producers. Threads without a ring of their own (main, early start-up) share
+* the multi-producer global_log_queue, where space is claimed with one
+* fetch-add. The logger thread merges all rings by timestamp.
+*
+* What happens when a ring is full is set by the overflow policy. None of the
+* policies lock or do file I/O on the producer's thread.
 */
 #ifndef LOG_QUEUE_H
 #define LOG_QUEUE_H
 
 
 #include "logger.h"
+#include "log_metrics.h"
 #include "platform_atomic.h"
+#include "platform_file.h"
 
 
-#define LOG_QUEUE_SIZE 0x8000  // Size of the log queue
+#define LOG_QUEUE_SIZE 0x400000        // Bytes in the shared queue (power of two)
+#define LOG_THREAD_QUEUE_SIZE 0x40000  // Bytes in each thread's own queue (power of two)
+#define LOG_QUEUE_CACHE_LINE 64
+#define LOG_RECORD_ALIGN 8
+#define LOG_QUEUE_LEVELS (LOG_FATAL + 1)  // Levels with their own drop counter
 
-// Slot states - using uint8_t since we only need 2 bits
-typedef enum {
-    SLOT_EMPTY    = 0,  // Available for writing
-    SLOT_RESERVED = 1,  // Being written to
-    SLOT_WRITTEN  = 2   // Ready for reading
-} LogQueueSlotState;
+/**
+ * @brief What a producer does when its log queue is full.
+ */
+typedef enum LogOverflowPolicy {
+    LOG_OVERFLOW_BLOCK,          // Wait for the logger to make room
+    LOG_OVERFLOW_DROP_NEWEST,    // Discard the entry being logged
+    LOG_OVERFLOW_DROP_OLDEST,    // Discard the oldest queued entry to make room
+    LOG_OVERFLOW_SPILL_TO_DISK   // Queue the entry in a memory-mapped spill file
+} LogOverflowPolicy;
+
+/**
+ * @brief Header of a record in a log queue.
+ */
+typedef struct {
+    PlatformAtomicUInt64 state;             // Record size in the low half, its position in the high; zero until published
+    uint8_t level;                          // LogLevel
+    uint8_t label_length;                   // Bytes of thread label following the header
+    uint16_t message_length;                // Bytes of message following the label
+    uint16_t route;                         // Log file the entry is written to
+    PlatformHighResTimestamp_T timestamp;
+    const LogCallSite_T *site;              // Non-NULL if the message holds packed arguments
+} LogRecordHeader_T;
+
+#define LOG_RECORD_MAX_SIZE \
+    ((sizeof(LogRecordHeader_T) + THREAD_LABEL_SIZE + LOG_MSG_BUFFER_SIZE + LOG_RECORD_ALIGN - 1) \
+     & ~(size_t)(LOG_RECORD_ALIGN - 1))
 
 /**
  * @brief Structure representing a log queue.
+ *
+ * head and tail are kept on separate cache lines so producers reserving
+ * space do not contend with the consumer releasing it.
  */
 typedef struct {
-    LogEntry_T entries[LOG_QUEUE_SIZE];
-    PlatformAtomicUInt32 head;
-    PlatformAtomicUInt32 tail;
-    PlatformAtomicUInt8 slot_states[LOG_QUEUE_SIZE];  // Uses LogQueueSlotState values
+    PlatformAtomicUInt64 head;      // Byte position of the next record to reserve
+    uint64_t cached_tail;           // Single producer only: last tail seen
+    char head_pad[LOG_QUEUE_CACHE_LINE - sizeof(PlatformAtomicUInt64) - sizeof(uint64_t)];
+    PlatformAtomicUInt64 tail;      // Byte position of the next record to read
+    char tail_pad[LOG_QUEUE_CACHE_LINE - sizeof(PlatformAtomicUInt64)];
+    uint8_t *buffer;                // capacity bytes plus LOG_RECORD_MAX_SIZE of slack
+    uint64_t capacity;
+    uint64_t mask;
+    bool single_producer;           // Only the owning thread pushes
+    PlatformAtomicBool retired;     // Owning thread has exited; free once drained
+    PlatformFileMappingHandle mapping;  // Set if buffer is a mapped file rather than heap
+    LogQueueStats_T stats;          // Counted by producers while metrics are enabled
 } LogQueue_T;
 
 extern LogQueue_T global_log_queue; // Declare the log queue
 
 /**
- * @brief Initialises the log queue.
+ * @brief Initialises a log queue.
  * @param queue The log queue to initialise.
+ * @param capacity Size of the ring in bytes, must be a power of two.
+ * @param single_producer True if only one thread will ever push.
+ * @return true on success, false if the buffer could not be allocated.
  */
-void log_queue_init(LogQueue_T *queue);
+bool log_queue_init(LogQueue_T *queue, uint64_t capacity, bool single_producer);
 
+/**
+ * @brief Initialises a log queue whose buffer is a memory-mapped file.
+ *
+ * Records pushed to it are written into the file's pages by plain stores;
+ * the operating system writes them out, so producers make no system calls.
+ *
+ * @param queue The log queue to initialise.
+ * @param capacity Size of the ring in bytes, must be a power of two.
+ * @param file_name The file to create, truncated if it exists.
+ * @return true on success, false if the file could not be created or mapped.
+ */
+bool log_queue_init_mapped(LogQueue_T *queue, uint64_t capacity, const char *file_name);
+
+/**
+ * @brief Releases the buffer of a log queue.
+ * @param queue The log queue.
+ */
+void log_queue_destroy(LogQueue_T *queue);
 
+/**
+ * @brief Pushes a log entry onto a log queue.
+ *
+ * Only the used part of the label and message is copied. Never locks or
+ * sleeps. If the ring is full the entry is not queued and the caller decides
+ * what to do with it.
+ *
+ * @param log_queue The log queue.
+ * @param entry The log entry to copy into the queue.
+ * @return true if the entry was queued, false if the queue was full.
+ */
 bool log_queue_push(LogQueue_T *log_queue, const LogEntry_T *entry);
 
 /**
- * @brief Pops a log entry from the log queue.
+ * @brief Selects the overflow policy. Call before any queue is initialised.
+ * @param policy The policy.
+ * @param spill_file The spill file for LOG_OVERFLOW_SPILL_TO_DISK, else unused.
+ * @param spill_size Bytes in the spill ring, a power of two.
+ * @return false if the spill file could not be set up; entries that
+ *         overflow are then dropped.
+ */
+bool log_queue_set_overflow_policy(LogOverflowPolicy policy, const char *spill_file, uint64_t spill_size);
+
+/**
+ * @brief Pushes an entry, applying the overflow policy if the queue is full.
+ * @param log_queue The log queue.
+ * @param entry The log entry to copy into the queue.
+ * @return true if the entry was queued or deliberately dropped, false if
+ *         there is no logger thread left to take it.
+ */
+bool log_queue_submit(LogQueue_T *log_queue, const LogEntry_T *entry);
+
+/**
+ * @brief Marks the logger thread as gone; later submits return false.
+ */
+void log_queue_close_consumer(void);
+
+/**
+ * @brief Takes the counts of entries dropped since the last call.
+ * @param counts Receives the count for each LogLevel.
+ * @return The total number dropped.
+ */
+uint64_t log_queue_take_dropped(uint64_t counts[LOG_QUEUE_LEVELS]);
+
+/**
+ * @brief Sums the producer counters of every queue, including freed ones.
+ *
+ * Logger thread only.
+ *
+ * @param total Receives the sums.
+ */
+void log_queue_collect_stats(LogQueueStats_T *total);
+
+/**
+ * @brief Fill of the fullest queue at the last log_queue_pop_merged.
+ * @return 0.0 (empty) to 1.0 (full).
+ */
+double log_queue_last_fill(void);
+
+/**
+ * @brief Pops a log entry from a log queue.
+ *
+ * Records are returned strictly in the order they were reserved. Must only
+ * be called from the single consumer (the logger thread).
+ *
  * @param queue The log queue.
  * @param entry The log entry to populate.
- * @return 0 on success, -1 if the queue is empty.
+ * @return true if an entry was popped, false if the queue is empty or the
+ *         next record is still being written.
  */
 bool log_queue_pop(LogQueue_T *queue, LogEntry_T *entry);
 
+/**
+ * @brief Gives the calling thread its own single-producer log queue.
+ * @return true on success; on failure the thread keeps using the global queue.
+ */
+bool log_queue_attach_thread(void);
+
+/**
+ * @brief Retires the calling thread's log queue.
+ *
+ * Entries already queued are still logged; the logger frees the queue once
+ * it has drained it.
+ */
+void log_queue_detach_thread(void);
+
+/**
+ * @brief Gets the queue the calling thread should push to.
+ * @return The thread's own queue, or the global queue if it has none.
+ */
+LogQueue_T *log_queue_for_thread(void);
+
+/**
+ * @brief Pops the oldest pending entry across all log queues.
+ *
+ * Logger thread only. Performs one step of a k-way merge by timestamp over
+ * the global queue, the spill queue and every thread queue, and frees
+ * retired thread queues once they are empty.
+ *
+ * @param entry The log entry to populate.
+ * @return true if an entry was popped, false if every queue is empty.
+ */
+bool log_queue_pop_merged(LogEntry_T *entry);
+
+/**
+ * @brief Creates the event the logger thread parks on when it is idle.
+ * @return true on success; without it log_queue_park falls back to sleeping.
+ */
+bool log_queue_init_wakeup(void);
+
+/**
+ * @brief Puts the logger thread to sleep until an entry is pushed.
+ *
+ * Logger thread only. Returns at once if an entry is already pending, when a
+ * producer publishes the first entry since the park, or after timeout_ms.
+ * Producers only signal while the logger is parked, so pushing to an awake
+ * logger costs no system call.
+ *
+ * @param timeout_ms Longest time to sleep.
+ */
+void log_queue_park(uint32_t timeout_ms);
+
 #endif // LOG_QUEUE_H
@@ -10,12 +10,14 @@
 #include <stdarg.h>  // Add this for variable arguments
 
 #include "platform_time.h"
+#include "platform_atomic.h"
 #include "app_thread.h"  // Add this include for ThreadConfig
 #include "logger_macros.h"
 
 
 #define LOG_MSG_BUFFER_SIZE 1024 // Buffer size for log messages
 #define THREAD_LABEL_SIZE 64 // Buffer size for thread labels
+#define LOG_DEFERRED_MAX_ARGS 16 // Most arguments a deferred format may take
 
 #ifdef _DEBUG
 /*
@@ -27,6 +29,12 @@
 extern bool g_trace_all;
 #endif // _DEBUG
 
+/*
+    * The calling thread's log level, a LogLevel byte shared by every thread
+    * with the same label. Tested inline by logger_log; see logger_level_enabled.
+*/
+extern THREAD_LOCAL const volatile uint8_t *g_thread_log_level;
+
 /* Define log levels. */
 typedef enum LogLevel {
     LOG_TRACE,    /**< Trace level: Very detailed debugging information */
@@ -49,13 +57,57 @@ typedef enum LogOutput {
     LOG_OUTPUT_BOTH     // Both screen/stderr and file
 } LogOutput;
 
+/**
+ * @brief Parse state of a logger_log call site.
+ */
+typedef enum LogCallSiteState {
+    LOG_SITE_UNPARSED,  // Not yet seen
+    LOG_SITE_PARSING,   // First caller is parsing the format
+    LOG_SITE_DEFERRED,  // Arguments are packed and formatted by the logger thread
+    LOG_SITE_EAGER      // Format not supported for deferral, format on the caller
+} LogCallSiteState;
+
+/**
+ * @brief Static per-call-site state, one per logger_log invocation.
+ *
+ * Also holds the site's rate limit: at most rate_limit entries per
+ * rate_interval_ms, the rest counted and reported by the logger thread as
+ * one line when the interval ends.
+ */
+typedef struct LogCallSite_T {
+    const char *format;                            // Format string the kinds were parsed from
+    PlatformAtomicUInt32 state;                    // LogCallSiteState
+    uint8_t arg_count;
+    uint8_t arg_kinds[LOG_DEFERRED_MAX_ARGS];      // LogArgKind per argument
+    uint32_t rate_limit;                           // Entries per interval, 0 for [logger] rate_limit
+    uint32_t rate_interval_ms;                     // 0 for [logger] rate_limit_interval_ms
+    PlatformAtomicUInt32 window_start_ms;          // Start of the current interval
+    PlatformAtomicUInt32 window_count;             // Entries offered in it
+    PlatformAtomicUInt32 suppressed;               // Entries withheld since the last report
+    const char *suppressed_format;                 // Set by the caller that withheld the first
+    uint8_t suppressed_level;
+    uint16_t suppressed_route;                     // Log file of that caller's thread
+    char suppressed_label[THREAD_LABEL_SIZE];      // and its label, which the report goes out under
+    struct LogCallSite_T *next_suppressed;         // Next site with withheld entries
+} LogCallSite_T;
+
+#define LOG_CALL_SITE_INIT_LIMITED(limit, interval_ms) \
+    { NULL, { LOG_SITE_UNPARSED }, 0, { 0 }, (limit), (interval_ms), { 0 }, { 0 }, { 0 }, NULL, 0, 0, { 0 }, NULL }
+#define LOG_CALL_SITE_INIT LOG_CALL_SITE_INIT_LIMITED(0, 0)
+
 /**
  * @brief Structure representing a log entry.
+ *
+ * The sequence index printed with each line is assigned when the entry is
+ * published, so it always follows output order. When site is set, message
+ * holds the call's packed arguments and the text is rendered at publish time.
  */
 typedef struct LogEntry_T {
-    uint64_t index;
     LogLevel level;
     PlatformHighResTimestamp_T timestamp;
+    const LogCallSite_T *site;   // Non-NULL for a deferred entry
+    uint16_t message_length;     // Bytes of message in use (text excludes the terminator)
+    uint16_t route;              // Index of the thread's log file, 0 for the application log
     char message[LOG_MSG_BUFFER_SIZE];
     char thread_label[THREAD_LABEL_SIZE];
 } LogEntry_T;
@@ -80,9 +132,20 @@ void create_log_entry(LogEntry_T* entry, LogLevel level, const char* message);
 
 /**
  * @brief Sets a thread-specific log file from configuration.
+ *
+ * Must be called on the thread itself: the file is resolved once here and
+ * every later entry from the thread carries it as a route id.
  */
 void set_thread_log_file_from_config(const char *thread_name);
 
+/**
+ * @brief Resolves the calling thread's log level from [log_levels].
+ *
+ * Tries the label, then each parent as "PARENT.*"; a label with no entry
+ * follows the global log_level. Call on the thread itself as it registers.
+ */
+void set_thread_log_level_from_config(const char *thread_label);
+
 /**
  * @brief Converts the log level to a string.
  */
@@ -113,12 +176,26 @@ const char* get_level_name(LogLevel level);
  */
 void logger_set_level(LogLevel level);
 
+/**
+ * @brief Sets the log level of registered thread labels.
+ * @param label_pattern A thread label, or "PARENT.*" for every label under PARENT.
+ * @param level The level; it stays when the global level changes.
+ * @return The number of labels changed.
+ */
+int logger_set_thread_level(const char *label_pattern, LogLevel level);
+
 /**
  * @brief Internal logging function - use logger_log macro instead.
  * @note This function should not be called directly. Use the logger_log macro.
  */
 void _logger_log(LogLevel level, const char* format, ...);
 
+/**
+ * @brief Internal logging function for a known call site - use logger_log macro instead.
+ * @note Formatting is deferred to the logger thread when the site's format allows it.
+ */
+void _logger_log_site(LogCallSite_T* site, LogLevel level, const char* format, ...);
+
 /**
  * @brief Get the logger thread configuration.
  */
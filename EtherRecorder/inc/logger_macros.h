@@ -1,12 +1,29 @@
 /**
  * @file logger_macros.h
  * @brief Macro definitions for the logging system.
+ *
+ * Each logger_log invocation owns a static LogCallSite_T so its format string
+ * is parsed only once and, where possible, formatting is left to the logger
+ * thread. The format must therefore be a string literal.
+ *
+ * The level is tested against the calling thread's level before anything
+ * else, so a disabled call evaluates none of its arguments.
+ *
+ * logger_log_limited gives its site a rate limit of its own; other sites
+ * take the [logger] rate_limit settings.
  */
 #ifndef LOGGER_MACROS_H
 #define LOGGER_MACROS_H
 
 #include "logger.h"
 
+/**
+ * @brief Whether the calling thread logs at this level; a load and a compare.
+ *
+ * Guards work done only to build log output, such as a hex dump.
+ */
+#define logger_level_enabled(level) ((uint8_t)(level) >= *g_thread_log_level)
+
 #ifdef _DEBUG
 /*
  * In debug builds, if the log level is LOG_TRACE (or if g_trace_all is true),
@@ -19,41 +36,59 @@
 #pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
 #endif
 
-#define _logger_log_with_file_line(level, fmt, ...) \
-    _logger_log(level, "[%s:%d] " fmt, __FILE__, __LINE__, ##__VA_ARGS__)
+#define _logger_log_with_file_line(site, level, fmt, ...) \
+    _logger_log_site(site, level, "[%s:%d] " fmt, __FILE__, __LINE__, ##__VA_ARGS__)
 
-#define _logger_log_without_file_line(level, fmt, ...) \
-    _logger_log(level, fmt, ##__VA_ARGS__)
+#define _logger_log_without_file_line(site, level, fmt, ...) \
+    _logger_log_site(site, level, fmt, ##__VA_ARGS__)
 
 #if defined(__clang__)
 #pragma clang diagnostic pop
 #endif
 
-// The main logger_log macro definitions
+// The call site macro definitions
 #if defined(_MSC_VER)
   // MSVC - use different pragma syntax
-  #define logger_log(level, fmt, ...) \
+  #define _logger_log_at(limit, interval_ms, level, fmt, ...) \
       __pragma(warning(push)) \
       __pragma(warning(disable:4003)) \
-      ((level) == LOG_TRACE || g_trace_all ? \
-        _logger_log_with_file_line(level, fmt, ##__VA_ARGS__) : \
-        _logger_log_without_file_line(level, fmt, ##__VA_ARGS__)) \
+      do { \
+          static LogCallSite_T _log_site = LOG_CALL_SITE_INIT_LIMITED(limit, interval_ms); \
+          if (!logger_level_enabled(level)) \
+              break; \
+          if ((level) == LOG_TRACE || g_trace_all) \
+              _logger_log_with_file_line(&_log_site, level, fmt, ##__VA_ARGS__); \
+          else \
+              _logger_log_without_file_line(&_log_site, level, fmt, ##__VA_ARGS__); \
+      } while (0) \
       __pragma(warning(pop))
 #elif defined(__clang__)
   // Clang approach
   #pragma clang diagnostic push
   #pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
-  #define logger_log(level, fmt, ...) \
-      ((level) == LOG_TRACE || g_trace_all ? \
-        _logger_log_with_file_line(level, fmt, ##__VA_ARGS__) : \
-        _logger_log_without_file_line(level, fmt, ##__VA_ARGS__))
+  #define _logger_log_at(limit, interval_ms, level, fmt, ...) \
+      do { \
+          static LogCallSite_T _log_site = LOG_CALL_SITE_INIT_LIMITED(limit, interval_ms); \
+          if (!logger_level_enabled(level)) \
+              break; \
+          if ((level) == LOG_TRACE || g_trace_all) \
+              _logger_log_with_file_line(&_log_site, level, fmt, ##__VA_ARGS__); \
+          else \
+              _logger_log_without_file_line(&_log_site, level, fmt, ##__VA_ARGS__); \
+      } while (0)
   #pragma clang diagnostic pop
 #else
   // GCC and others
-  #define logger_log(level, fmt, ...) \
-      ((level) == LOG_TRACE || g_trace_all ? \
-        _logger_log_with_file_line(level, fmt, ##__VA_ARGS__) : \
-        _logger_log_without_file_line(level, fmt, ##__VA_ARGS__))
+  #define _logger_log_at(limit, interval_ms, level, fmt, ...) \
+      do { \
+          static LogCallSite_T _log_site = LOG_CALL_SITE_INIT_LIMITED(limit, interval_ms); \
+          if (!logger_level_enabled(level)) \
+              break; \
+          if ((level) == LOG_TRACE || g_trace_all) \
+              _logger_log_with_file_line(&_log_site, level, fmt, ##__VA_ARGS__); \
+          else \
+              _logger_log_without_file_line(&_log_site, level, fmt, ##__VA_ARGS__); \
+      } while (0)
 #endif
 
 #else
@@ -62,21 +97,51 @@
  * file/line info.
  */
 #if defined(_MSC_VER)
-  #define logger_log(level, fmt, ...) \
+  #define _logger_log_at(limit, interval_ms, level, fmt, ...) \
       __pragma(warning(push)) \
       __pragma(warning(disable:4003)) \
-      _logger_log(level, fmt, ##__VA_ARGS__) \
+      do { \
+          static LogCallSite_T _log_site = LOG_CALL_SITE_INIT_LIMITED(limit, interval_ms); \
+          if (logger_level_enabled(level)) \
+              _logger_log_site(&_log_site, level, fmt, ##__VA_ARGS__); \
+      } while (0) \
       __pragma(warning(pop))
 #elif defined(__clang__)
   #pragma clang diagnostic push
   #pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
-  #define logger_log(level, fmt, ...) \
-      _logger_log(level, fmt, ##__VA_ARGS__)
+  #define _logger_log_at(limit, interval_ms, level, fmt, ...) \
+      do { \
+          static LogCallSite_T _log_site = LOG_CALL_SITE_INIT_LIMITED(limit, interval_ms); \
+          if (logger_level_enabled(level)) \
+              _logger_log_site(&_log_site, level, fmt, ##__VA_ARGS__); \
+      } while (0)
   #pragma clang diagnostic pop
 #else
-  #define logger_log(level, fmt, ...) \
-      _logger_log(level, fmt, ##__VA_ARGS__)
+  #define _logger_log_at(limit, interval_ms, level, fmt, ...) \
+      do { \
+          static LogCallSite_T _log_site = LOG_CALL_SITE_INIT_LIMITED(limit, interval_ms); \
+          if (logger_level_enabled(level)) \
+              _logger_log_site(&_log_site, level, fmt, ##__VA_ARGS__); \
+      } while (0)
+#endif
+#endif
+
+#if defined(__clang__)
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wgnu-zero-variadic-macro-arguments"
 #endif
+
+#define logger_log(level, fmt, ...) \
+    _logger_log_at(0, 0, level, fmt, ##__VA_ARGS__)
+
+/**
+ * @brief logger_log with this site's own limit of limit entries per interval_ms.
+ */
+#define logger_log_limited(limit, interval_ms, level, fmt, ...) \
+    _logger_log_at(limit, interval_ms, level, fmt, ##__VA_ARGS__)
+
+#if defined(__clang__)
+#pragma clang diagnostic pop
 #endif
 
 #endif // LOGGER_MACROS_H
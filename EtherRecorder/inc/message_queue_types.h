@@ -2,6 +2,7 @@
 #define MESSAGE_QUEUE_TYPES_H
 
 #include <stdint.h>
+#include "platform_atomic.h"
 #include "platform_sync.h"
 
 #ifdef _MSC_VER
@@ -38,27 +39,91 @@ typedef struct {
 typedef struct {
     MessageType type;         ///< Message type identifier
     size_t content_size;   ///< Size of content in bytes
+    uint32_t payload;         ///< Pooled buffer holding the content, or 0 if it is inline
+    uint32_t payload_offset;  ///< Where the content starts in the pooled buffer
 } MessageHeader_T;
 
 /**
  * @brief Message structure for inter-thread communication
+ *
+ * Content is either inline, or in a buffer from payload_pool.h named by
+ * header.payload; message_content finds it either way.
  */
 typedef struct {
     MessageHeader_T header;  ///< Message header
     uint8_t content[MESSAGE_CONTENT_SIZE];  ///< Message content buffer
 } Message_T;
 
+#define MESSAGE_QUEUE_CACHE_LINE 64
+#define MESSAGE_BATCH_MAX 16  // Most messages a thread pops in one batch
+#define MESSAGE_QUEUE_DEFAULT_CAPACITY 1024
+#define MESSAGE_QUEUE_MAX_CAPACITY (1u << 20)
+#define MESSAGE_QUEUE_COMPACT_INLINE 96  // Content bytes a slot of a byte-capped queue holds
+
+/**
+ * @brief What message_queue_offer does with a message the queue has no room for.
+ */
+typedef enum {
+    QUEUE_OVERFLOW_BLOCK,        ///< Wait up to the queue's block timeout, then drop it
+    QUEUE_OVERFLOW_DROP_OLDEST,  ///< Drop the oldest queued message to make room
+    QUEUE_OVERFLOW_DROP_NEWEST,  ///< Drop the message offered
+    QUEUE_OVERFLOW_SAMPLE,       ///< Let 1 in sample_interval in over the oldest, drop the rest
+    QUEUE_OVERFLOW_POLICY_COUNT
+} QueueOverflowPolicy;
+
+/**
+ * @brief A message in a queue, with the sequence number that says whose turn it is.
+ *
+ * A slot at ring position p holds sequence p while free for the producer
+ * claiming p, p + 1 once that producer has published its message, and
+ * p + capacity once the consumer has taken it back out.
+ *
+ * Slots are slot_size bytes apart, with room for the queue's inline_size
+ * bytes of content.
+ */
+typedef struct {
+    PlatformAtomicUInt64 sequence;
+    MessageHeader_T header;
+    uint8_t content[];
+} MessageSlot_T;
+
 /**
- * @brief Queue structure for message storage
+ * @brief Bounded multi-producer, multi-consumer message queue.
+ *
+ * Producers claim a position by advancing tail, consumers by advancing head,
+ * each with one compare-exchange; the slot's sequence then orders the copy
+ * in against the copy out, so no lock is taken. tail and head sit on cache
+ * lines of their own. The events are only set when a waiter needs them.
+ *
+ * A queue given a byte cap has slots of MESSAGE_QUEUE_COMPACT_INLINE bytes
+ * of content; a message with more inline content is moved into a pooled
+ * payload buffer as it is pushed, so a slot takes little more than a
+ * message header.
  */
 typedef struct {
-    Message_T* entries;               ///< Array of messages
-    volatile int32_t head;           ///< Index of head (atomic access)
-    volatile int32_t tail;           ///< Index of tail (atomic access)
-    int32_t max_size;                ///< Maximum number of messages allowed
+    PlatformAtomicUInt64 tail;       ///< Next position a producer claims
+    char tail_pad[MESSAGE_QUEUE_CACHE_LINE - sizeof(PlatformAtomicUInt64)];
+    PlatformAtomicUInt64 head;       ///< Next position a consumer claims
+    char head_pad[MESSAGE_QUEUE_CACHE_LINE - sizeof(PlatformAtomicUInt64)];
+    PlatformAtomicUInt32 push_waiters; ///< Producers waiting for room
+    PlatformAtomicUInt32 pop_waiters;  ///< Consumers waiting for a message
+    uint8_t* slots;                  ///< Ring of capacity slots, slot_size bytes each
+    size_t slot_size;                ///< Bytes from one slot to the next
+    size_t inline_size;              ///< Content bytes a slot holds
+    uint64_t mask;                   ///< capacity - 1; capacity is a power of two
+    int32_t max_size;                ///< Maximum number of messages allowed (the capacity)
     PlatformEvent_T not_empty_event; ///< Event for signaling queue not empty
     PlatformEvent_T not_full_event;  ///< Event for signaling queue not full
     const char* owner_label;         ///< Label identifying the queue owner
+    QueueOverflowPolicy overflow_policy; ///< What message_queue_offer does when full
+    uint32_t block_timeout_ms;       ///< How long QUEUE_OVERFLOW_BLOCK waits
+    uint32_t sample_interval;        ///< n of QUEUE_OVERFLOW_SAMPLE's 1 in n
+    PlatformAtomicUInt32 overflows;  ///< Offers that found the queue full, for sampling
+    PlatformAtomicUInt64 dropped[QUEUE_OVERFLOW_POLICY_COUNT]; ///< Messages each policy dropped
+    Message_T* returned;             ///< MESSAGE_BATCH_MAX messages handed back, allocated on first use
+    uint32_t returned_first;         ///< First handed back message not yet popped again
+    uint32_t returned_end;           ///< One past the last
+    PlatformAtomicUInt32 returned_count; ///< returned_end - returned_first, for threads other than the consumer
 } MessageQueue_T;
 
 #endif // MESSAGE_QUEUE_TYPES_H
@@ -1,6 +1,8 @@
 #ifndef MESSAGE_TYPES_H
 #define MESSAGE_TYPES_H
 
+#include <stddef.h>
+
 #include "message_queue_types.h"
 
 #ifdef __cplusplus
@@ -8,9 +10,133 @@ extern "C" {
 #endif
 
 // Function declarations
+
+/**
+ * @brief Sets up an empty queue.
+ *
+ * @param queue Queue to set up
+ * @param max_size Messages it holds, rounded up to a power of two
+ * @param max_bytes Content bytes the queue is to hold, or 0. With a budget,
+ *                  slots hold MESSAGE_QUEUE_COMPACT_INLINE bytes of content
+ *                  and larger messages go in pooled buffers, which the pool
+ *                  is sized to hold max_bytes of (see payload_pool_init).
+ * @param owner_label Label of the owning thread, for messages
+ * @return true on success, false if memory or events could not be had
+ */
+bool message_queue_init(MessageQueue_T* queue, uint32_t max_size, size_t max_bytes, const char* owner_label);
+
+/**
+ * @brief Bytes the queue's slots take.
+ */
+size_t message_queue_memory(const MessageQueue_T* queue);
+
+/**
+ * @brief Messages in the queue, handed back ones included; a snapshot, as
+ * others may push or pop meanwhile.
+ */
+uint32_t message_queue_count(const MessageQueue_T* queue);
+
+/**
+ * @brief Frees what message_queue_init allocated. Nothing may use the queue after.
+ */
+void message_queue_destroy(MessageQueue_T* queue);
+
+/**
+ * @brief The message's content, inline or in its pooled buffer; header.content_size bytes.
+ */
+const uint8_t* message_content(const Message_T* message);
+
+/**
+ * @brief Releases the message's pooled buffer, if it has one.
+ *
+ * Call once done with a popped message. A message that failed to push is
+ * still the sender's to release.
+ */
+void message_release(Message_T* message);
+
 bool message_queue_push(MessageQueue_T* queue, const Message_T* message, uint32_t timeout_ms);
+
+/**
+ * @brief Pushes a message if there is room now, without waiting or logging.
+ *
+ * For a producer that drops what does not fit and counts it itself.
+ *
+ * @return true if queued; false if full, and the message is still the sender's
+ */
+bool message_queue_try_push(MessageQueue_T* queue, const Message_T* message);
 bool message_queue_pop(MessageQueue_T* queue, Message_T* message, uint32_t timeout_ms);
 
+/**
+ * @brief Hands popped messages back, to be popped again before any others.
+ *
+ * For a queue's only consumer, with messages it took but could not use,
+ * such as a send thread whose connection failed; they keep their pooled
+ * buffers. At most MESSAGE_BATCH_MAX are held back at once, so hand back no
+ * more than one pop took.
+ *
+ * @return The number taken back, from the start of messages; the rest are
+ *         still the caller's to release
+ */
+uint32_t message_queue_unpop(MessageQueue_T* queue, const Message_T* messages, uint32_t count);
+
+/**
+ * @brief Sets what message_queue_offer does when the queue is full.
+ *
+ * @param block_timeout_ms How long QUEUE_OVERFLOW_BLOCK waits for room
+ * @param sample_interval n for QUEUE_OVERFLOW_SAMPLE, which lets 1 in n in; 0 is taken as 1
+ */
+void message_queue_set_overflow(MessageQueue_T* queue, QueueOverflowPolicy policy, uint32_t block_timeout_ms,
+                                uint32_t sample_interval);
+
+/**
+ * @brief Pushes a message, applying the queue's overflow policy if it is full.
+ *
+ * Drops are counted against the policy rather than logged, so a live path
+ * can shed load without flooding the log; see message_queue_dropped. A
+ * message dropped to make room is released here.
+ *
+ * @return true if the message was queued; false if it was dropped, and is
+ *         still the sender's to release
+ */
+bool message_queue_offer(MessageQueue_T* queue, const Message_T* message);
+
+/**
+ * @brief How many messages a policy has dropped from or at the queue.
+ */
+uint64_t message_queue_dropped(const MessageQueue_T* queue, QueueOverflowPolicy policy);
+
+/**
+ * @brief Reads a policy's name: block, drop_oldest, drop_newest or sample_1_in_n.
+ * @return The policy, or default_policy if the name is not one of them
+ */
+QueueOverflowPolicy queue_overflow_policy_from_string(const char* name, QueueOverflowPolicy default_policy);
+
+/**
+ * @brief The name queue_overflow_policy_from_string reads.
+ */
+const char* queue_overflow_policy_to_string(QueueOverflowPolicy policy);
+
+/**
+ * @brief Pushes several messages, claiming their places with one update of
+ * the queue and setting the events at most once.
+ *
+ * Messages go in order, as many as there is room for, waiting for more
+ * room until the timeout runs out.
+ *
+ * @return The number pushed, from the start of messages
+ */
+uint32_t message_queue_push_batch(MessageQueue_T* queue, const Message_T* messages, uint32_t count,
+                                  uint32_t timeout_ms);
+
+/**
+ * @brief Pops up to max_count messages with one update of the queue,
+ * waiting up to timeout_ms for the first.
+ *
+ * @return The number popped into messages; 0 if none came
+ */
+uint32_t message_queue_pop_batch(MessageQueue_T* queue, Message_T* messages, uint32_t max_count,
+                                 uint32_t timeout_ms);
+
 #ifdef __cplusplus
 }
 #endif
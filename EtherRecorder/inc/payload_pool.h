@@ -0,0 +1,67 @@
+/**
+ * @file payload_pool.h
+ * @brief Reference-counted buffers that messages carry received data in.
+ *
+ * A relayed read is received straight into a pooled buffer, and the message
+ * queued for the send thread carries only the buffer's handle, so the data
+ * is never copied between threads. Whoever holds a reference releases it
+ * when done: pushing a message hands the sender's reference to the
+ * consumer, which releases it after use (see message_release).
+ *
+ * Buffers are taken from and returned to a lock-free free list; a buffer
+ * goes back on it when its last reference is released. A handle of
+ * PAYLOAD_NONE (0) names no buffer, so a zeroed message carries none.
+ */
+#ifndef PAYLOAD_POOL_H
+#define PAYLOAD_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PAYLOAD_BUFFER_SIZE 4096         // Bytes in each buffer; one socket read
+#define PAYLOAD_NONE 0
+
+typedef uint32_t PayloadHandle;
+
+/**
+ * @brief Allocates the pool.
+ *
+ * @param buffer_count Buffers in the pool; with 0, payload_acquire always fails
+ * @return true on success, false if the memory could not be had
+ */
+bool payload_pool_init(uint32_t buffer_count);
+
+/**
+ * @brief Buffers in the pool, in use or not.
+ */
+uint32_t payload_pool_count(void);
+
+/**
+ * @brief Frees the pool. No buffer may be in use.
+ */
+void payload_pool_cleanup(void);
+
+/**
+ * @brief Takes a free buffer, holding one reference to it.
+ * @return The buffer's handle, or PAYLOAD_NONE if all are in use
+ */
+PayloadHandle payload_acquire(void);
+
+/**
+ * @brief Adds a reference to a buffer, for a second holder.
+ */
+void payload_retain(PayloadHandle handle);
+
+/**
+ * @brief Drops a reference, returning the buffer to the pool with the last.
+ * PAYLOAD_NONE is ignored.
+ */
+void payload_release(PayloadHandle handle);
+
+/**
+ * @brief The PAYLOAD_BUFFER_SIZE bytes of a buffer.
+ */
+uint8_t* payload_data(PayloadHandle handle);
+
+#endif // PAYLOAD_POOL_H
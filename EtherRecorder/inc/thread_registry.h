@@ -55,11 +55,53 @@ bool thread_registry_is_registered(const ThreadConfig* thread);
 // Message queue operations
 ThreadRegistryError init_queue(const char* thread_label);
 ThreadRegistryError push_message(const char* thread_label, const Message_T* message, uint32_t timeout_ms);
+
+/**
+ * @brief Pushes a message only if the thread's queue has room now; never
+ * waits, and a full queue is not logged (see message_queue_try_push).
+ *
+ * @return THREAD_REG_SUCCESS, or THREAD_REG_QUEUE_FULL for the caller to count
+ */
+ThreadRegistryError try_push_message(const char* thread_label, const Message_T* message);
 ThreadRegistryError pop_message(const char* thread_label, Message_T* message, uint32_t timeout_ms);
 
+/**
+ * @brief Pops up to max_count messages from the calling thread's queue in one go.
+ *
+ * Looks the queue up once for the batch, and waits up to timeout_ms for
+ * the first message. Each message is the caller's to message_release.
+ *
+ * @param count Receives the number of messages popped
+ * @return THREAD_REG_SUCCESS, or THREAD_REG_QUEUE_EMPTY if none came
+ */
+ThreadRegistryError pop_message_batch(const char* thread_label, Message_T* messages, uint32_t max_count,
+                                      uint32_t* count, uint32_t timeout_ms);
+
+/**
+ * @brief Hands messages the calling thread popped but could not use back to
+ * the front of its queue (see message_queue_unpop).
+ *
+ * A queue still holding messages when its thread deregisters is kept for
+ * the next thread registered with the label, so a sender that reconnects
+ * picks up where the last one failed.
+ *
+ * @param count Number of messages, no more than one pop took
+ * @param returned Receives the number taken back; the rest are the caller's to release
+ * @return THREAD_REG_SUCCESS if all were taken back, THREAD_REG_QUEUE_FULL if not
+ */
+ThreadRegistryError unpop_message_batch(const char* thread_label, const Message_T* messages, uint32_t count,
+                                        uint32_t* returned);
+
 // Helper function for queue access
 MessageQueue_T* get_queue_by_label(const char* thread_label);
 
+/**
+ * @brief Payload buffers the byte budgets in [queues] call for: each
+ *        <label>.bytes in whole PAYLOAD_BUFFER_SIZE buffers, for the pool to
+ *        hold on top of the buffers receives use.
+ */
+uint32_t thread_registry_queue_payload_buffers(void);
+
 
 PlatformWaitResult thread_registry_wait_list(PlatformThreadId* thread_ids, uint32_t count, uint32_t timeout_ms);
 /**
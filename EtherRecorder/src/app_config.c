@@ -235,6 +235,21 @@ uint16_t get_config_uint16(const char* section, const char* key, uint16_t defaul
 /**
  * @copydoc free_config
  */
+/**
+ * @copydoc for_each_config_key
+ */
+void for_each_config_key(const char* section, ConfigKeyVisitor visit, void* context) {
+    if (!section || !visit) {
+        return;
+    }
+    for (ConfigEntry *entry = config_entries; entry; entry = entry->next) {
+        // A key given twice takes its last value, as get_config_string does
+        if (strcmp_nocase(entry->section, section) == 0 && find_config_entry(section, entry->key) == entry) {
+            visit(entry->key, entry->value, context);
+        }
+    }
+}
+
 void free_config(void) {
     ConfigEntry *entry = config_entries;
     while (entry) {
@@ -23,6 +23,7 @@
 
 #include "client_manager.h"
 #include "command_interface.h"
+#include "log_compactor.h"
 #include "log_queue.h"
 #include "logger.h"
 #include "server_manager.h"
@@ -70,6 +71,7 @@ ThreadRegistryError register_main_thread(void) {
         .label = "MAIN",
     };
     main_thread.thread_id = platform_thread_get_id();
+    set_thread_log_level_from_config(main_thread.label);
 
     // Register the main thread with its current handle
     ThreadRegistryError reg_result = thread_registry_register(&main_thread, false);
@@ -319,7 +321,8 @@ void start_threads(void) {
         { get_server_thread(), false },            // Server thread is not essential
         { get_client_thread(), false },            // Add client thread
         { get_command_interface_thread(), false }, // Command interface is not essential
-        { get_demo_heartbeat_thread(), false }
+        { get_demo_heartbeat_thread(), false },
+        { get_log_compactor_thread(), false }      // Compresses rotated log files
     };
     
     // Start each thread
@@ -355,8 +358,20 @@ static void* thread_wrapper(void* arg) {
     ThreadConfig thread_args = *(ThreadConfig*)arg;
     ThreadResult run_result = THREAD_SUCCESS;
 
+    // The creator stores the id only once platform_thread_create returns,
+    // which a thread that starts running first has not seen yet
+    thread_args.thread_id = platform_thread_get_id();
+
     // Set thread-specific data
     set_thread_label(thread_args.label);
+    set_thread_log_level_from_config(thread_args.label);
+
+    // Give the thread its own log queue; on failure it shares the global one.
+    // The logger publishes its own entries directly and would leave its
+    // queue empty for every merge to scan
+    if (strcmp(thread_args.label, "LOGGER") != 0) {
+        log_queue_attach_thread();
+    }
 
     // Register the thread
     ThreadRegistryError reg_result = thread_registry_register(&thread_args, true);
@@ -365,6 +380,7 @@ static void* thread_wrapper(void* arg) {
             thread_args.label, 
             app_error_get_message(THREAD_REGISTRY_DOMAIN, reg_result));
         
+        log_queue_detach_thread();
         return (void*)(THREAD_ERROR_REGISTRATION_FAILED);
     }
     
@@ -378,6 +394,7 @@ static void* thread_wrapper(void* arg) {
                   thread_args.label);
         thread_registry_update_state(thread_args.label, 
                                      THREAD_STATE_FAILED);
+        log_queue_detach_thread();
         return (void*)(THREAD_ERROR_INIT_FAILED);
     }
 
@@ -386,6 +403,7 @@ static void* thread_wrapper(void* arg) {
     if (wait_result != THREAD_SUCCESS) {
         thread_registry_update_state(thread_args.label, 
                                    THREAD_STATE_FAILED);
+        log_queue_detach_thread();
         return (void*)(uintptr_t)(wait_result);
     }
     
@@ -397,6 +415,7 @@ static void* thread_wrapper(void* arg) {
                       thread_args.label, init_result);
             thread_registry_update_state(thread_args.label, 
                                       THREAD_STATE_FAILED);
+            log_queue_detach_thread();
             return (void*)(uintptr_t)init_result;
         }
     }
@@ -429,7 +448,8 @@ static void* thread_wrapper(void* arg) {
             thread_args.label,
             app_error_get_message(THREAD_REGISTRY_DOMAIN, dereg_result));
     }
-    
+
+    log_queue_detach_thread();
     return (void*)(uintptr_t)(run_result);
 }
 
@@ -491,9 +511,9 @@ ThreadResult service_thread_queue(ThreadConfig* thread) {
     uint32_t start_time = get_time_ms();
     uint32_t messages_processed = 0;
     ThreadResult result = THREAD_SUCCESS;
-    Message_T message;
+    Message_T messages[MESSAGE_BATCH_MAX];
 
-    while (true) {
+    while (result == THREAD_SUCCESS) {
         // Check time limit
         if (thread->max_process_time_ms > 0) {
             uint32_t elapsed = get_time_ms() - start_time;
@@ -502,25 +522,38 @@ ThreadResult service_thread_queue(ThreadConfig* thread) {
             }
         }
 
-        // Check message batch limit
-        if (thread->msg_batch_size > 0 && messages_processed >= thread->msg_batch_size) {
-            break;
+        // Check message batch limit, and take no more than it allows
+        uint32_t wanted = MESSAGE_BATCH_MAX;
+        if (thread->msg_batch_size > 0) {
+            if (messages_processed >= thread->msg_batch_size) {
+                break;
+            }
+            if (thread->msg_batch_size - messages_processed < wanted) {
+                wanted = thread->msg_batch_size - messages_processed;
+            }
         }
 
-        // Try to get a message (non-blocking)
-        ThreadRegistryError queue_result = pop_message(thread->label, &message, 0);
+        // Try to get messages (non-blocking), one queue update for the lot
+        uint32_t count = 0;
+        ThreadRegistryError queue_result = pop_message_batch(thread->label, messages, wanted, &count, 0);
         
         if (queue_result == THREAD_REG_QUEUE_EMPTY) {
             break;
         }
         else if (queue_result == THREAD_REG_SUCCESS) {
-            result = thread->msg_processor(thread, &message);
-            messages_processed++;
-            
-            if (result != THREAD_SUCCESS) {
-                logger_log(LOG_ERROR, "Message processing failed in thread '%s': %d", 
-                          thread->label, result);
-                break;
+            // Popped messages are no longer in the queue, so a failure still
+            // lets the rest of the batch through; the first one ends the loop
+            for (uint32_t i = 0; i < count; i++) {
+                ThreadResult message_result = thread->msg_processor(thread, &messages[i]);
+                messages_processed++;
+                if (message_result != THREAD_SUCCESS) {
+                    logger_log(LOG_ERROR, "Message processing failed in thread '%s': %d", 
+                              thread->label, message_result);
+                    if (result == THREAD_SUCCESS) {
+                        result = message_result;
+                    }
+                }
+                message_release(&messages[i]);
             }
         }
         else {
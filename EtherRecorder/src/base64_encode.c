@@ -0,0 +1,202 @@
+/**
+ * @file base64_encode.c
+ * @brief Bytes to base64 text (RFC 4648, with padding), 12 or 24 bytes at a time.
+ *
+ * The vector encoders follow Wojciech Muła's layout: a byte shuffle spreads
+ * each 3 input bytes over a 32-bit lane, two multiplies move the four 6-bit
+ * fields into bytes of their own, and a second shuffle looks up the offset
+ * that takes each field to its character.
+ */
+#include "base64_encode.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define BASE64_ENCODE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define BASE64_ENCODE_SSSE3_TARGET
+#define BASE64_ENCODE_AVX2_TARGET
+#else
+#define BASE64_ENCODE_SSSE3_TARGET __attribute__((target("ssse3")))
+#define BASE64_ENCODE_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+enum {
+    BASE64_ENCODE_UNRESOLVED = 0,
+    BASE64_ENCODE_SCALAR,
+    BASE64_ENCODE_SSSE3,
+    BASE64_ENCODE_AVX2
+};
+
+static const char base64_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Resolved on the first call; every thread arrives at the same value
+static int base64_encode_level = BASE64_ENCODE_UNRESOLVED;
+
+/**
+ * Encodes whole groups of 3 bytes, then pads the 1 or 2 bytes left over.
+ */
+static size_t encode_scalar(const uint8_t* data, size_t length, char* out) {
+    size_t i = 0;
+    char* start = out;
+    for (; i + 3 <= length; i += 3) {
+        uint32_t group = ((uint32_t)data[i] << 16) | ((uint32_t)data[i + 1] << 8) | data[i + 2];
+        *out++ = base64_chars[(group >> 18) & 0x3F];
+        *out++ = base64_chars[(group >> 12) & 0x3F];
+        *out++ = base64_chars[(group >> 6) & 0x3F];
+        *out++ = base64_chars[group & 0x3F];
+    }
+    if (i < length) {
+        uint32_t group = (uint32_t)data[i] << 16;
+        if (i + 1 < length) {
+            group |= (uint32_t)data[i + 1] << 8;
+        }
+        *out++ = base64_chars[(group >> 18) & 0x3F];
+        *out++ = base64_chars[(group >> 12) & 0x3F];
+        *out++ = i + 1 < length ? base64_chars[(group >> 6) & 0x3F] : '=';
+        *out++ = '=';
+    }
+    return (size_t)(out - start);
+}
+
+#ifdef BASE64_ENCODE_X86
+
+/**
+ * 12 bytes in the low three quarters of a register to their 16 characters.
+ */
+BASE64_ENCODE_SSSE3_TARGET
+static inline __m128i encode_lane_ssse3(__m128i bytes) {
+    // Bytes b0 b1 b2 of each group to the lane as b1 b0 b2 b1
+    __m128i in = _mm_shuffle_epi8(bytes, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    // Fields a and c by a high multiply, b and d by a low one, each to a byte
+    __m128i ac = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+    __m128i bd = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(ac, bd);
+
+    // 0-25 pick 13 ('A'), 26-51 pick 0 ('a' - 26), 52-63 pick 1 to 12
+    __m128i offsets = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    offsets = _mm_or_si128(offsets, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+    const __m128i offset_table = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                               '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                               '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(indices, _mm_shuffle_epi8(offset_table, offsets));
+}
+
+BASE64_ENCODE_SSSE3_TARGET
+static size_t encode_ssse3(const uint8_t* data, size_t length, char* out) {
+    size_t done = 0;
+    // Each load reads 16 bytes to use 12
+    for (; done + 16 <= length; done += 12) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(data + done));
+        _mm_storeu_si128((__m128i*)(out + done / 3 * 4), encode_lane_ssse3(bytes));
+    }
+    return done;
+}
+
+BASE64_ENCODE_AVX2_TARGET
+static size_t encode_avx2(const uint8_t* data, size_t length, char* out) {
+    const __m256i spread = _mm256_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                                           10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m256i offset_table = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                  '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                                  '/' - 63, 'A', 0, 0,
+                                                  'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                  '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                                  '/' - 63, 'A', 0, 0);
+    size_t done = 0;
+    // 12 bytes to each 128-bit lane; the second load reads 16 bytes to use 12
+    for (; done + 28 <= length; done += 24) {
+        __m128i low = _mm_loadu_si128((const __m128i*)(data + done));
+        __m128i high = _mm_loadu_si128((const __m128i*)(data + done + 12));
+        __m256i bytes = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+
+        __m256i in = _mm256_shuffle_epi8(bytes, spread);
+        __m256i ac = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)),
+                                        _mm256_set1_epi32(0x04000040));
+        __m256i bd = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)),
+                                        _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(ac, bd);
+
+        __m256i offsets = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        offsets = _mm256_or_si256(offsets, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices),
+                                                            _mm256_set1_epi8(13)));
+        _mm256_storeu_si256((__m256i*)(out + done / 3 * 4),
+                            _mm256_add_epi8(indices, _mm256_shuffle_epi8(offset_table, offsets)));
+    }
+    return done;
+}
+
+static int detect_level(void) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    int has_ssse3 = (info[2] & (1 << 9)) != 0;
+    int os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+    if (max_leaf >= 7) {
+        __cpuidex(info, 7, 0);
+        if (os_saves_ymm && (info[1] & (1 << 5))) {
+            return BASE64_ENCODE_AVX2;
+        }
+    }
+    return has_ssse3 ? BASE64_ENCODE_SSSE3 : BASE64_ENCODE_SCALAR;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return BASE64_ENCODE_AVX2;
+    }
+    return __builtin_cpu_supports("ssse3") ? BASE64_ENCODE_SSSE3 : BASE64_ENCODE_SCALAR;
+#endif
+}
+
+#else
+
+static int detect_level(void) {
+    return BASE64_ENCODE_SCALAR;
+}
+
+#endif // BASE64_ENCODE_X86
+
+static int resolve_level(void) {
+    int level = base64_encode_level;
+    if (level == BASE64_ENCODE_UNRESOLVED) {
+        level = detect_level();
+        base64_encode_level = level;
+    }
+    return level;
+}
+
+/**
+ * @copydoc base64_encode
+ */
+size_t base64_encode(const uint8_t* data, size_t length, char* out) {
+    int level = resolve_level();
+
+    // The vector encoders take whole groups of 3 bytes, so their output
+    // joins the scalar encoder's without a seam
+    size_t done = 0;
+#ifdef BASE64_ENCODE_X86
+    if (level == BASE64_ENCODE_AVX2) {
+        done = encode_avx2(data, length, out);
+    }
+    if (level >= BASE64_ENCODE_SSSE3) {
+        done += encode_ssse3(data + done, length - done, out + done / 3 * 4);
+    }
+#else
+    (void)level;
+#endif
+    return done / 3 * 4 + encode_scalar(data + done, length - done, out + done / 3 * 4);
+}
+
+/**
+ * @copydoc base64_encode_variant
+ */
+const char* base64_encode_variant(void) {
+    switch (resolve_level()) {
+        case BASE64_ENCODE_AVX2: return "avx2";
+        case BASE64_ENCODE_SSSE3: return "ssse3";
+        default: return "scalar";
+    }
+}
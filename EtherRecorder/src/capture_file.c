@@ -0,0 +1,223 @@
+/**
+ * @file capture_file.c
+ * @brief Capture of received payloads.
+ */
+#include "capture_file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "base64_encode.h"
+#include "log_json.h"
+#include "platform_atomic.h"
+#include "platform_file.h"
+#include "platform_path.h"
+#include "platform_time.h"
+#include "utils.h"
+
+#define CAPTURE_BUFFER_SIZE (256 * 1024)
+#define CAPTURE_BUFFER_COUNT 4
+#define CAPTURE_NAME_ATTEMPTS 100
+#define CAPTURE_JSON_MAX_PAYLOAD (48 * 1024)  // larger reads take several records; a multiple of 3
+#define CAPTURE_JSON_RECORD_SIZE (BASE64_ENCODED_SIZE(CAPTURE_JSON_MAX_PAYLOAD) + 2048)
+
+struct CaptureFile {
+    PlatformFileWriterHandle writer;
+    bool failed;                         // a write failed; later reads are not captured
+    CaptureFormat format;
+    char path[MAX_PATH_LEN];
+    // JSON only
+    char connection_id[32];
+    char direction[2 * sizeof(((PlatformSocketAddress*)0)->host) + 16];
+    CaptureConnection_T connection;
+    char* record;                        // CAPTURE_JSON_RECORD_SIZE bytes, reused for every record
+};
+
+static PlatformAtomicUInt64 capture_connections = {0};
+
+/**
+ * @copydoc capture_file_open
+ */
+CaptureFile* capture_file_open(const char* directory, const char* label, CaptureFormat format,
+                               const CaptureConnection_T* connection) {
+    if (!directory || !label) {
+        return NULL;
+    }
+
+    CaptureFile* capture = calloc(1, sizeof(*capture));
+    if (!capture) {
+        return NULL;
+    }
+    capture->format = format;
+    if (format == CAPTURE_FORMAT_JSON) {
+        capture->record = malloc(CAPTURE_JSON_RECORD_SIZE);
+        if (!capture->record) {
+            free(capture);
+            return NULL;
+        }
+    }
+    create_directories(directory);
+
+    char stamp[32];
+    time_t seconds = time(NULL);
+    struct tm timeinfo;
+    platform_localtime(&seconds, &timeinfo);
+    strftime(stamp, sizeof(stamp), "%Y%m%d_%H%M%S", &timeinfo);
+
+    // A receive thread per connection can start several in one second
+    const char* extension = format == CAPTURE_FORMAT_JSON ? "jsonl" : "cap";
+    for (unsigned attempt = 1; attempt <= CAPTURE_NAME_ATTEMPTS; attempt++) {
+        if (attempt == 1) {
+            snprintf(capture->path, sizeof(capture->path), "%s%c%s_%s.%s", directory, PATH_SEPARATOR, label, stamp,
+                     extension);
+        } else {
+            snprintf(capture->path, sizeof(capture->path), "%s%c%s_%s_%u.%s", directory, PATH_SEPARATOR, label,
+                     stamp, attempt, extension);
+        }
+        FILE* existing = NULL;
+        if (platform_fopen(&existing, capture->path, "rb") != PLATFORM_ERROR_SUCCESS || !existing) {
+            break;
+        }
+        fclose(existing);
+    }
+
+    capture->writer = platform_file_writer_open(capture->path, true, CAPTURE_BUFFER_SIZE, CAPTURE_BUFFER_COUNT, NULL);
+    if (!capture->writer) {
+        free(capture->record);
+        free(capture);
+        return NULL;
+    }
+
+    if (format == CAPTURE_FORMAT_JSON) {
+        // What every record of the connection repeats
+        snprintf(capture->connection_id, sizeof(capture->connection_id), "conn-%llu",
+                 (unsigned long long)platform_atomic_fetch_add_uint64(&capture_connections, 1) + 1);
+        if (connection) {
+            capture->connection = *connection;
+        }
+        if (capture->connection.has_endpoints) {
+            snprintf(capture->direction, sizeof(capture->direction), "%s:%u->%s:%u",
+                     capture->connection.remote.host, (unsigned)capture->connection.remote.port,
+                     capture->connection.local.host, (unsigned)capture->connection.local.port);
+        } else {
+            snprintf(capture->direction, sizeof(capture->direction), "peer->%s", label);
+        }
+    } else {
+        char magic[CAPTURE_FILE_MAGIC_SIZE] = CAPTURE_FILE_MAGIC;
+        platform_file_writer_write(capture->writer, magic, sizeof(magic));
+    }
+    return capture;
+}
+
+/**
+ * @brief Formats one JSON payload record into the capture's record buffer.
+ * @return The record's length, or 0 if it did not fit.
+ */
+static size_t format_json_record(CaptureFile* capture, const struct timespec* now, const void* data,
+                                 size_t length) {
+    LogJsonWriter json;
+    log_json_init(&json, capture->record, CAPTURE_JSON_RECORD_SIZE);
+    log_json_begin_object(&json);
+    log_json_key(&json, "timestamp");
+    log_json_timestamp(&json, (int64_t)now->tv_sec, (uint32_t)now->tv_nsec, 9);
+    log_json_key(&json, "direction");
+    log_json_string(&json, capture->direction, strlen(capture->direction));
+    log_json_key(&json, "size");
+    log_json_uint(&json, length);
+    log_json_key(&json, "connection_id");
+    log_json_string(&json, capture->connection_id, strlen(capture->connection_id));
+    log_json_key(&json, "protocol");
+    log_json_string(&json, capture->connection.is_tcp ? "TCP" : "UDP", 3);
+    if (capture->connection.has_endpoints) {
+        const CaptureConnection_T* connection = &capture->connection;
+        log_json_key(&json, "metadata");
+        log_json_begin_object(&json);
+        log_json_key(&json, "source_ip");
+        log_json_string(&json, connection->remote.host, strnlen(connection->remote.host, sizeof(connection->remote.host)));
+        log_json_key(&json, "dest_ip");
+        log_json_string(&json, connection->local.host, strnlen(connection->local.host, sizeof(connection->local.host)));
+        log_json_key(&json, "source_port");
+        log_json_uint(&json, connection->remote.port);
+        log_json_key(&json, "dest_port");
+        log_json_uint(&json, connection->local.port);
+        log_json_end_object(&json);
+    }
+    log_json_key(&json, "content");
+    log_json_base64(&json, data, length);
+    log_json_end_object(&json);
+    return log_json_finish(&json);
+}
+
+/**
+ * @copydoc capture_file_write
+ */
+bool capture_file_write(CaptureFile* capture, const void* data, size_t length, uint64_t* offset) {
+    if (!capture || capture->failed) {
+        return false;
+    }
+
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+
+    if (offset) {
+        *offset = platform_file_writer_size(capture->writer);
+    }
+
+    if (capture->format == CAPTURE_FORMAT_JSON) {
+        const uint8_t* bytes = data;
+        do {
+            size_t part = length < CAPTURE_JSON_MAX_PAYLOAD ? length : CAPTURE_JSON_MAX_PAYLOAD;
+            size_t record_length = format_json_record(capture, &now, bytes, part);
+            if (record_length == 0 ||
+                platform_file_writer_write(capture->writer, capture->record, record_length) != PLATFORM_ERROR_SUCCESS) {
+                capture->failed = true;
+                return false;
+            }
+            bytes += part;
+            length -= part;
+        } while (length > 0);
+        return true;
+    }
+
+    CaptureRecordHeader_T header = {
+        .time_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec,
+        .length = (uint32_t)length,
+        .reserved = 0
+    };
+    if (platform_file_writer_write(capture->writer, &header, sizeof(header)) != PLATFORM_ERROR_SUCCESS ||
+        platform_file_writer_write(capture->writer, data, length) != PLATFORM_ERROR_SUCCESS) {
+        capture->failed = true;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @copydoc capture_file_flush
+ */
+void capture_file_flush(CaptureFile* capture) {
+    if (capture && !capture->failed) {
+        platform_file_writer_flush(capture->writer, false);
+    }
+}
+
+/**
+ * @copydoc capture_file_close
+ */
+void capture_file_close(CaptureFile* capture) {
+    if (!capture) {
+        return;
+    }
+    platform_file_writer_close(capture->writer);
+    free(capture->record);
+    free(capture);
+}
+
+/**
+ * @copydoc capture_file_path
+ */
+const char* capture_file_path(const CaptureFile* capture) {
+    return capture ? capture->path : "";
+}
@@ -5,22 +5,55 @@
 #include <string.h>
 
 #include "platform_error.h"
+#include "platform_path.h"
+#include "platform_string.h"
 #include "platform_threads.h"  // Make sure this includes wait definitions
 #include "thread_registry.h"
 #include "app_config.h"
+#include "capture_file.h"
+#include "hex_encode.h"
 #include "logger.h"
+#include "payload_pool.h"
+#include "utils.h"
 
+#define HEX_DUMP_MAX_ROW_BYTES 64        // 64 bytes take 128 digits and up to 64 spaces
 
 typedef struct HexDumpConfig {
+    bool enabled;                        // hex dump each read; otherwise one summary line
     int bytes_per_row;
     int bytes_per_col;
+    bool capture;                        // write each read to a capture file
+    CaptureFormat capture_format;
+    char capture_path[MAX_PATH_LEN];
 } HexDumpConfig;
 
 static HexDumpConfig g_hex_dump_config = {0};
 
 static void init_hex_dump_config(void) {
-    g_hex_dump_config.bytes_per_row = get_config_int("logger", "hex_dump_bytes_per_row", 32);
-    g_hex_dump_config.bytes_per_col = get_config_int("logger", "hex_dump_bytes_per_col", 4);
+    g_hex_dump_config.capture = get_config_bool("logger", "receive_capture", false);
+    const char* capture_path = get_config_string("logger", "receive_capture_path", "logs/capture");
+    strncpy(g_hex_dump_config.capture_path, capture_path, sizeof(g_hex_dump_config.capture_path) - 1);
+    const char* capture_format = get_config_string("logger", "receive_capture_format", "binary");
+    g_hex_dump_config.capture_format = strcmp_nocase(capture_format, "json") == 0 ? CAPTURE_FORMAT_JSON
+                                                                                  : CAPTURE_FORMAT_BINARY;
+    // A capture holds the bytes, so by default the dump gives way to it
+    g_hex_dump_config.enabled = get_config_bool("logger", "receive_hex_dump", !g_hex_dump_config.capture);
+
+    int bytes_per_col = get_config_int("logger", "hex_dump_bytes_per_col", 4);
+    int bytes_per_row = get_config_int("logger", "hex_dump_bytes_per_row", 32);
+    if (bytes_per_col < 1 || bytes_per_col > HEX_DUMP_MAX_ROW_BYTES) {
+        bytes_per_col = 4;
+    }
+    if (bytes_per_row > HEX_DUMP_MAX_ROW_BYTES) {
+        bytes_per_row = HEX_DUMP_MAX_ROW_BYTES;
+    }
+    // Rows hold whole columns
+    bytes_per_row -= bytes_per_row % bytes_per_col;
+    if (bytes_per_row < bytes_per_col) {
+        bytes_per_row = bytes_per_col;
+    }
+    g_hex_dump_config.bytes_per_row = bytes_per_row;
+    g_hex_dump_config.bytes_per_col = bytes_per_col;
 }
 
 static void cleanup_threads(PlatformThreadId* thread_ids, uint32_t count) {
@@ -163,39 +196,28 @@ static void log_buffered_data(const uint8_t* buffer, size_t length, int batch_by
     // Position within the current row
     static size_t row_position = 0;
 
-    // Character mapping for hex values
-    const char hex_chars[] = "0123456789ABCDEF";
-
     logger_log(LOG_INFO, "%d bytes received: top", batch_bytes);
 
     while (index < length) {
-        // Initialize the row with placeholder dots
-        char row[256] = {0};
-        for (uint32_t i = 0; i < cols_per_row; i++) {
-            uint32_t base = i * (bytes_per_col * 2 + 1); // 2 chars per byte + 1 space
-            for (uint32_t j = 0; j < bytes_per_col * 2; j++) {
-                row[base + j] = '.';
-            }
-            row[base + bytes_per_col * 2] = ' ';  // Space after each column
-        }
-        
         // Calculate how many bytes to place in this row
         size_t avail = (size_t)(bytes_per_row - row_position);
         size_t to_place = (length - index < avail) ? (length - index) : avail;
 
-        // Place the bytes into the row
-        for (size_t i = 0; i < to_place; i++) {
-            size_t pos = row_position + i;           // Position within the row
-            size_t col = pos / bytes_per_col;        // Column index (32-bit word)
-            size_t offset = pos % bytes_per_col;     // Offset within the word
-            
-            // Each byte takes 2 hexdigits in the output
-            size_t dest_index = col * (bytes_per_col * 2 + 1) + offset * 2;
-            
-            uint8_t byte = buffer[index + i];
-            row[dest_index] = hex_chars[byte >> 4];       // High nibble
-            row[dest_index + 1] = hex_chars[byte & 0x0F]; // Low nibble
+        // The row's digits in one run, with dots for bytes outside this read
+        char digits[HEX_DUMP_MAX_ROW_BYTES * 2];
+        memset(digits, '.', row_position * 2);
+        hex_encode(buffer + index, to_place, digits + row_position * 2);
+        memset(digits + (row_position + to_place) * 2, '.', (bytes_per_row - row_position - to_place) * 2);
+
+        // Split into columns, each followed by a space
+        char row[256];
+        char* out = row;
+        for (uint32_t i = 0; i < cols_per_row; i++) {
+            memcpy(out, digits + i * bytes_per_col * 2, bytes_per_col * 2);
+            out += bytes_per_col * 2;
+            *out++ = ' ';
         }
+        *out = '\0';
 
         // Update the row position
         row_position += to_place;
@@ -211,46 +233,73 @@ static void log_buffered_data(const uint8_t* buffer, size_t length, int batch_by
     logger_log(LOG_INFO, "%d bytes received: bottom", batch_bytes);
 }
 
-static bool process_relay_data(CommContext* context, const char* buffer, size_t bytes_received) {
+/**
+ * @brief The queue reads are relayed to, or NULL if there is none (yet).
+ */
+static MessageQueue_T* relay_queue(const CommContext* context) {
     if (!context->is_relay_enabled || context->foreign_queue_label[0] == '\0') {
-        return true;  // Not an error, just no relay needed
+        return NULL;  // Not an error, just no relay needed
     }
+    return get_queue_by_label(context->foreign_queue_label);
+}
 
-    MessageQueue_T* foreign_queue = get_queue_by_label(context->foreign_queue_label);
-    if (!foreign_queue) {
-        return true;  // Queue not available yet, ignore
+static void report_relay_drop(const MessageQueue_T* queue) {
+    QueueOverflowPolicy policy = queue->overflow_policy;
+    logger_log_limited(1, 10000, LOG_WARN, "Relay queue '%s' full, %llu messages dropped (%s)", queue->owner_label,
+                       (unsigned long long)message_queue_dropped(queue, policy),
+                       queue_overflow_policy_to_string(policy));
+}
+
+/**
+ * @brief Queues a read for the relay's send thread.
+ *
+ * A read received into a pooled buffer goes as that buffer's handle, its
+ * reference handed on to the send thread. Without one (the pool was used
+ * up), it is copied into messages of its own.
+ *
+ * A full queue is dealt with by its overflow policy ([queues] <label>.overflow),
+ * so a relay that may drop does not hold up the socket it reads from.
+ */
+static bool process_relay_data(MessageQueue_T* foreign_queue, PayloadHandle payload, const char* buffer,
+                               size_t bytes_received) {
+    if (payload != PAYLOAD_NONE) {
+        Message_T message = {0};
+        message.header.type = MSG_TYPE_RELAY;
+        message.header.content_size = bytes_received;
+        message.header.payload = payload;
+        if (!message_queue_offer(foreign_queue, &message)) {
+            payload_release(payload);
+            report_relay_drop(foreign_queue);
+            return false;
+        }
+        return true;
     }
 
     const size_t max_content_size = sizeof(((Message_T*)0)->content);
     const char* current_pos = buffer;
     size_t remaining = bytes_received;
 
-    int chunk_count = 0;
     while (remaining > 0) {
-        if (chunk_count >= 1) {
-            logger_log(LOG_ERROR, "Chunks in relay data %d", chunk_count);
-            return false;
-        }
         Message_T message = {0};
         message.header.type = MSG_TYPE_RELAY;
         message.header.content_size = (remaining > max_content_size) ? max_content_size : remaining;
         
         memcpy(message.content, current_pos, message.header.content_size);
         
-        if (!message_queue_push(foreign_queue, &message, DEFAULT_THREAD_WAIT_TIMEOUT_MS)) {
-            logger_log(LOG_ERROR, "Failed to relay message to foreign queue");
+        if (!message_queue_offer(foreign_queue, &message)) {
+            // The rest of the read would only add gaps to what was dropped
+            report_relay_drop(foreign_queue);
             return false;
         }
 
         current_pos += message.header.content_size;
         remaining -= message.header.content_size;
-        chunk_count++;
     }
 
     return true;
 }
 
-static bool handle_receive(CommContext* context, char* buffer, size_t buffer_size) {
+static bool handle_receive(CommContext* context, char* buffer, size_t buffer_size, CaptureFile** capture) {
     if (!context || !buffer) {
         return false;
     }
@@ -267,7 +316,9 @@ static bool handle_receive(CommContext* context, char* buffer, size_t buffer_siz
                 logger_log(LOG_ERROR, "Socket read timed out 10 times in a row");
                 return false;
             }
-            logger_log(LOG_INFO, "Socket read timed out");
+            logger_log_limited(1, 10000, LOG_INFO, "Socket read timed out");
+            // Nothing arriving: let the capture reach the disk
+            capture_file_flush(*capture);
             return true;  // Timeout is not an error condition
         }
         // Any other error should close the connection
@@ -275,21 +326,50 @@ static bool handle_receive(CommContext* context, char* buffer, size_t buffer_siz
         return false;
     }
 
+    // A read to relay is received straight into a pooled buffer, which the
+    // send thread then sends from
+    MessageQueue_T* foreign_queue = relay_queue(context);
+    PayloadHandle payload = foreign_queue ? payload_acquire() : PAYLOAD_NONE;
+    if (payload != PAYLOAD_NONE) {
+        buffer = (char*)payload_data(payload);
+        buffer_size = PAYLOAD_BUFFER_SIZE;
+    } else if (foreign_queue) {
+        logger_log_limited(1, 10000, LOG_WARN, "Payload pool used up, relaying by copy");
+    }
+
     size_t bytes_received;
     PlatformErrorCode err = platform_socket_receive(context->socket,
                                                     buffer,
                                                     buffer_size,
                                                     &bytes_received);
     if (err != PLATFORM_ERROR_SUCCESS) {
+        payload_release(payload);
         comm_context_close(context);
         return false;
     }
 
-    // Log the received data in hex format
-    log_buffered_data((const uint8_t*)buffer, bytes_received, (int)bytes_received);
+    // Capture the received data, or log it in hex format, or both
+    if (*capture && bytes_received > 0) {
+        uint64_t offset = 0;
+        if (capture_file_write(*capture, buffer, bytes_received, &offset)) {
+            logger_log(LOG_INFO, "%zu bytes received, captured at offset %llu", bytes_received,
+                       (unsigned long long)offset);
+        } else {
+            logger_log(LOG_ERROR, "Failed to write capture file %s, capture stopped", capture_file_path(*capture));
+            capture_file_close(*capture);
+            *capture = NULL;
+        }
+    }
+    if (g_hex_dump_config.enabled && logger_level_enabled(LOG_INFO)) {
+        log_buffered_data((const uint8_t*)buffer, bytes_received, (int)bytes_received);
+    } else if (!*capture) {
+        logger_log(LOG_INFO, "%zu bytes received", bytes_received);
+    }
 
     // Handle relay if enabled
-    if (!process_relay_data(context, buffer, bytes_received)) {
+    if (!foreign_queue || bytes_received == 0) {
+        payload_release(payload);
+    } else if (!process_relay_data(foreign_queue, payload, buffer, bytes_received)) {
         // a false return means an issue with the relay, not the receive
         // and it will have been reported on already
         ;
@@ -375,14 +455,29 @@ void* comm_receive_thread(void* arg) {
 
     logger_log(LOG_INFO, "Receive thread started");
 
-    char buffer[4096];
+    CaptureFile* capture = NULL;
+    if (g_hex_dump_config.capture) {
+        CaptureConnection_T connection = { .is_tcp = context->is_tcp };
+        connection.has_endpoints = platform_socket_get_endpoints(context->socket, &connection.local,
+                                                                 &connection.remote) == PLATFORM_ERROR_SUCCESS;
+        capture = capture_file_open(g_hex_dump_config.capture_path, thread_config->label,
+                                    g_hex_dump_config.capture_format, &connection);
+        if (capture) {
+            logger_log(LOG_INFO, "Capturing received data to %s", capture_file_path(capture));
+        } else {
+            logger_log(LOG_ERROR, "Failed to create a capture file in %s", g_hex_dump_config.capture_path);
+        }
+    }
+
+    char buffer[PAYLOAD_BUFFER_SIZE];
 
     while (!comm_context_is_closed(context) && !shutdown_signalled()) {
-        if (!handle_receive(context, buffer, sizeof(buffer))) {
+        if (!handle_receive(context, buffer, sizeof(buffer), &capture)) {
             break;  
         }
     }
 
+    capture_file_close(capture);
     logger_log(LOG_INFO, "Receive thread exiting");
     printf("Receive thread Out of here\n");
     fflush(stdout);
@@ -419,6 +514,45 @@ void* comm_receive_thread(void* arg) {
 //     return (err == PLATFORM_ERROR_SUCCESS) ? THREAD_SUCCESS : THREAD_ERROR;
 // }
 
+/**
+ * @brief Sends a message's content, retrying partial sends, from the pooled
+ * buffer it was received into if it has one.
+ *
+ * @return true once all is sent. On false, the message is left holding
+ *         only what was not sent, for a later connection to send.
+ */
+static bool send_message(CommContext* context, Message_T* message) {
+    const uint8_t* content = message_content(message);
+    size_t total_sent = 0;
+    while (total_sent < message->header.content_size) {
+        size_t bytes_sent = 0;
+        PlatformErrorCode result = platform_socket_send(
+            context->socket,
+            content + total_sent,
+            message->header.content_size - total_sent,
+            &bytes_sent
+        );
+
+        if (result == PLATFORM_ERROR_SUCCESS) {
+            total_sent += bytes_sent;
+        }
+        else if (result != PLATFORM_ERROR_TIMEOUT) {  // Retry on timeout
+            break;
+        }
+    }
+    if (total_sent == message->header.content_size) {
+        return true;
+    }
+
+    if (message->header.payload != PAYLOAD_NONE) {
+        message->header.payload_offset += (uint32_t)total_sent;
+    } else {
+        memmove(message->content, message->content + total_sent, message->header.content_size - total_sent);
+    }
+    message->header.content_size -= total_sent;
+    return false;
+}
+
 void* comm_send_thread(void* arg) {
     ThreadConfig* thread_config = (ThreadConfig*)arg;
     CommContext* context = (CommContext*)thread_config->data;
@@ -428,13 +562,18 @@ void* comm_send_thread(void* arg) {
 
     logger_log(LOG_INFO, "Send thread started");
 
-    Message_T message;
+    uint32_t batch_size = thread_config->msg_batch_size;
+    if (batch_size == 0 || batch_size > MESSAGE_BATCH_MAX) {
+        batch_size = MESSAGE_BATCH_MAX;
+    }
+
+    Message_T messages[MESSAGE_BATCH_MAX];
     while (!comm_context_is_closed(context) && !shutdown_signalled()) {
-        // Simple non-blocking message pop
-        ThreadRegistryError queue_result = pop_message(thread_config->label, &message, 0);
+        // Wait briefly for messages, taking what has queued up in one go
+        uint32_t count = 0;
+        ThreadRegistryError queue_result = pop_message_batch(thread_config->label, messages, batch_size, &count, 10);
         
         if (queue_result == THREAD_REG_QUEUE_EMPTY) {
-            sleep_ms(10);
             continue;
         }
         
@@ -443,29 +582,41 @@ void* comm_send_thread(void* arg) {
             break;
         }
 
-        // Send complete message with retry on partial sends
-        size_t total_sent = 0;
-        while (total_sent < message.header.content_size) {
-            size_t bytes_sent = 0;
-            PlatformErrorCode result = platform_socket_send(
-                context->socket,
-                message.content + total_sent,
-                message.header.content_size - total_sent,
-                &bytes_sent
-            );
-
-            if (result == PLATFORM_ERROR_SUCCESS) {
-                total_sent += bytes_sent;
+        // Messages go in order until one fails or the time allowed for a
+        // pass runs out; the rest go back to the front of the queue, for the
+        // next pass or, after a failure, the next connection's send thread
+        uint32_t batch_start = get_time_ms();
+        uint32_t sent = 0;
+        bool send_error = false;
+        while (sent < count) {
+            if (sent > 0 && thread_config->max_process_time_ms > 0 &&
+                get_time_ms() - batch_start >= thread_config->max_process_time_ms) {
+                break;
             }
-            else if (result == PLATFORM_ERROR_TIMEOUT) {
-                continue;  // Retry on timeout
+            if (!send_message(context, &messages[sent])) {
+                send_error = true;
+                break;
             }
-            else {
-                logger_log(LOG_ERROR, "Send error occurred");
-                comm_context_close(context);
-                return NULL;
+            message_release(&messages[sent]);
+            sent++;
+        }
+
+        if (sent < count) {
+            uint32_t returned = 0;
+            unpop_message_batch(thread_config->label, messages + sent, count - sent, &returned);
+            for (uint32_t i = sent + returned; i < count; i++) {
+                message_release(&messages[i]);
+            }
+            if (returned < count - sent) {
+                logger_log(LOG_ERROR, "%u unsent messages could not be requeued", count - sent - returned);
             }
         }
+
+        if (send_error) {
+            logger_log(LOG_ERROR, "Send error occurred");
+            comm_context_close(context);
+            return NULL;
+        }
     }
 
     logger_log(LOG_INFO, "Send thread shutting down");
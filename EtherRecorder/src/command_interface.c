@@ -8,6 +8,7 @@
 
 #include "logger.h"
 #include "app_thread.h"
+#include "command_processor.h"
 #include "thread_registry.h"
 
 #define START_MARKER 0xDEADBEEF
@@ -40,11 +41,6 @@ typedef struct {
     CommandState current_state;
 } CommandContext;
 
-static void process_command(const char* command) {
-    logger_log(LOG_INFO, "Processing command: %s", command);
-    // TODO: Implement command processing logic
-}
-
 static ProcessResult process_wait_for_start(PlatformSocketHandle sock, CommandContext* ctx) {
     (void)sock;  // Unused parameter
     if (ctx->buffer_length < 4) {
@@ -109,6 +105,7 @@ static ProcessResult process_wait_for_message(PlatformSocketHandle sock, Command
     memcpy(message_body, ctx->buffer + 8, body_length);
     message_body[body_length] = '\0';
 
+    logger_log(LOG_INFO, "Processing command: %s", message_body);
     process_command(message_body);
     free(message_body);
 
@@ -171,9 +168,12 @@ static void handle_client_connection(PlatformSocketHandle client_sock) {
         .current_state = WAIT_FOR_START
     };
 
+    // A packet may hold a whole command, so only receive when a state needs more
+    bool need_data = true;
+
     while (!shutdown_signalled()) {
         // Receive data
-        if (ctx.buffer_length < MAX_BUFFER_SIZE) {
+        if (need_data && ctx.buffer_length < MAX_BUFFER_SIZE) {
             size_t bytes_received = 0;
             PlatformErrorCode result = platform_socket_receive(
                 client_sock,
@@ -212,9 +212,7 @@ static void handle_client_connection(PlatformSocketHandle client_sock) {
         if (result == PROCESS_FAIL) {
             break;
         }
-        else if (result == PROCESS_NEED_MORE_DATA) {
-            continue;
-        }
+        need_data = (result == PROCESS_NEED_MORE_DATA);
     }
 }
 
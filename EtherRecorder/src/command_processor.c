@@ -6,6 +6,7 @@
 
 #include "platform_string.h"
 #include "logger.h"
+#include "log_metrics.h"
 #include "utils.h"
 
 
@@ -37,6 +38,35 @@ static char* trim_whitespace(char* str) {
     return str;
 }
 
+static const LogLevelMap* find_log_level(const char* value) {
+    size_t table_size = sizeof(log_level_table) / sizeof(log_level_table[0]);
+    for (size_t i = 0; i < table_size; i++) {
+        if (strcmp_nocase(value, log_level_table[i].name) == 0) {
+            return &log_level_table[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Handles log_level.<label> = <level>, where label may be PARENT.*
+ */
+static void process_thread_log_level_command(const char* label, const char* value) {
+    const LogLevelMap* level = find_log_level(value);
+    if (!level) {
+        logger_log(LOG_WARN, "Unknown log level: %s", value);
+        return;
+    }
+
+    int changed = logger_set_thread_level(label, level->level);
+    if (changed > 0) {
+        logger_log(LOG_INFO, "Log level of %s changed to %s (%d thread label%s)",
+                   label, level->name, changed, changed == 1 ? "" : "s");
+    } else {
+        logger_log(LOG_WARN, "No thread label matches %s", label);
+    }
+}
+
 static void process_log_level_command(const char* value) {
     bool found = false;
     size_t table_size = sizeof(log_level_table) / sizeof(log_level_table[0]);
@@ -80,9 +110,20 @@ void process_command(const char* command) {
             process_log_level_command(right);
             return;
         }
+        if (strncmp_nocase(left, "log_level.", 10) == 0 && left[10] != '\0') {
+            process_thread_log_level_command(left + 10, right);
+            return;
+        }
     }
 
-    if (strcmp(trimmed, "SOME_COMMAND") == 0) {
+    if (strcmp_nocase(trimmed, "metrics") == 0) {
+        if (g_log_metrics_enabled) {
+            log_metrics_request_report();
+        } else {
+            logger_log(LOG_WARN, "Log metrics are off; set [logger] metrics = true");
+        }
+    }
+    else if (strcmp(trimmed, "SOME_COMMAND") == 0) {
         logger_log(LOG_INFO, "Processing SOME_COMMAND");
     }
     else {
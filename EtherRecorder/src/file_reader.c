@@ -125,6 +125,31 @@ static PlatformErrorCode thread_reader_init_config(FileReaderConfig* config) {
     return PLATFORM_ERROR_SUCCESS;
 }
 
+/**
+ * @brief Waits until the target queue holds fewer than max_queue_size messages.
+ *
+ * max_queue_size caps the reader's share of a queue that relayed data
+ * shares too; 0 leaves it to the queue's own capacity. Waiting is polled,
+ * as the queue's events belong to its producers and consumer.
+ *
+ * @return true if there is room; false if not, once block_when_full has
+ *         waited queue_timeout_ms, or straight away without it
+ */
+static bool wait_for_queue_room(const FileReaderConfig* config) {
+    if (config->max_queue_size == 0) {
+        return true;
+    }
+    MessageQueue_T* queue = get_queue_by_label(config->foreign_thread_label);
+    uint32_t start = get_time_ms();
+    while (queue && message_queue_count(queue) >= config->max_queue_size) {
+        if (!config->block_when_full || get_time_ms() - start >= config->queue_timeout_ms || shutdown_signalled()) {
+            return false;
+        }
+        sleep_ms(1);
+    }
+    return true;
+}
+
 void* file_reader_thread_function(void* arg) {
     ThreadConfig* thread_config = (ThreadConfig*)arg;
     if (!thread_config || !thread_config->data) {
@@ -169,6 +194,7 @@ void* file_reader_thread_function(void* arg) {
     // Read and send file contents in chunks
     size_t bytes_read;
     size_t total_bytes = 0;
+    uint64_t dropped_chunks = 0;
     uint32_t last_progress = get_time_ms();
 
     while (!shutdown_signalled()) {
@@ -200,13 +226,19 @@ void* file_reader_thread_function(void* arg) {
 
         memcpy(message.content, buffer, bytes_read);
 
-        ThreadRegistryError send_result = push_message(
-            config->foreign_thread_label,
-            &message,
-            config->queue_timeout_ms
-        );
+        // Without block_when_full, a chunk the target has no room for is
+        // dropped and only counted; a drop is not an error to log
+        ThreadRegistryError send_result = THREAD_REG_QUEUE_FULL;
+        if (wait_for_queue_room(config)) {
+            send_result = config->block_when_full ?
+                push_message(config->foreign_thread_label, &message, config->queue_timeout_ms) :
+                try_push_message(config->foreign_thread_label, &message);
+        }
 
-        if (send_result != THREAD_REG_SUCCESS) {
+        if (send_result == THREAD_REG_QUEUE_FULL && !config->block_when_full) {
+            dropped_chunks++;
+        } else if (send_result != THREAD_REG_SUCCESS) {
+            logger_log(LOG_ERROR, "File reader could not queue to '%s'", config->foreign_thread_label);
             platform_file_close(file);
             return (void*)THREAD_ERROR_QUEUE_FULL;
         }
@@ -217,9 +249,10 @@ void* file_reader_thread_function(void* arg) {
         if (config->log_progress) {
             uint32_t now = get_time_ms();
             if (now - last_progress >= config->progress_interval_ms) {
-                logger_log(LOG_INFO, "Read %zu of %zu bytes (%.1f%%)",
+                logger_log(LOG_INFO, "Read %zu of %zu bytes (%.1f%%), %llu chunks dropped",
                     total_bytes, (size_t)file_size,
-                    (float)total_bytes * 100 / file_size);
+                    (float)total_bytes * 100 / file_size,
+                    (unsigned long long)dropped_chunks);
                 last_progress = now;
             }
         }
@@ -231,6 +264,11 @@ void* file_reader_thread_function(void* arg) {
 
     platform_file_close(file);
 
+    if (dropped_chunks > 0) {
+        logger_log(LOG_WARN, "File reader dropped %llu chunks with '%s' full",
+            (unsigned long long)dropped_chunks, config->foreign_thread_label);
+    }
+
     // Handle different read modes
     if (config->read_mode == FILE_READ_LOOP) {
         sleep_ms(config->reload_delay_ms);
@@ -0,0 +1,149 @@
+/**
+ * @file hex_encode.c
+ * @brief Bytes to hexadecimal text, 16 or 32 bytes at a time.
+ */
+#include "hex_encode.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define HEX_ENCODE_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define HEX_ENCODE_AVX2_TARGET
+#else
+#define HEX_ENCODE_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+enum {
+    HEX_ENCODE_UNRESOLVED = 0,
+    HEX_ENCODE_SCALAR,
+    HEX_ENCODE_SSE2,
+    HEX_ENCODE_AVX2
+};
+
+// Resolved on the first call; every thread arrives at the same value
+static int hex_encode_level = HEX_ENCODE_UNRESOLVED;
+
+static void encode_scalar(const uint8_t* data, size_t length, char* out) {
+    static const char hex_chars[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < length; i++) {
+        out[2 * i] = hex_chars[data[i] >> 4];
+        out[2 * i + 1] = hex_chars[data[i] & 0x0F];
+    }
+}
+
+#ifdef HEX_ENCODE_X86
+
+/**
+ * Nibbles of 0 to 15 to their digits: '0' is added to each, and a further
+ * 7 to those above 9, which carries them from ':' on to 'A'.
+ */
+static inline __m128i nibbles_to_digits_sse2(__m128i nibbles) {
+    __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8(7));
+    return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+}
+
+static size_t encode_sse2(const uint8_t* data, size_t length, char* out) {
+    const __m128i low_mask = _mm_set1_epi8(0x0F);
+    size_t done = 0;
+    for (; done + 16 <= length; done += 16) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(data + done));
+        __m128i high = nibbles_to_digits_sse2(_mm_and_si128(_mm_srli_epi16(bytes, 4), low_mask));
+        __m128i low = nibbles_to_digits_sse2(_mm_and_si128(bytes, low_mask));
+        // Interleaved, each byte's high digit ahead of its low digit
+        _mm_storeu_si128((__m128i*)(out + 2 * done), _mm_unpacklo_epi8(high, low));
+        _mm_storeu_si128((__m128i*)(out + 2 * done + 16), _mm_unpackhi_epi8(high, low));
+    }
+    return done;
+}
+
+HEX_ENCODE_AVX2_TARGET
+static size_t encode_avx2(const uint8_t* data, size_t length, char* out) {
+    const __m256i low_mask = _mm256_set1_epi8(0x0F);
+    const __m256i nine = _mm256_set1_epi8(9);
+    const __m256i seven = _mm256_set1_epi8(7);
+    const __m256i zero_digit = _mm256_set1_epi8('0');
+    size_t done = 0;
+    for (; done + 32 <= length; done += 32) {
+        __m256i bytes = _mm256_loadu_si256((const __m256i*)(data + done));
+        __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), low_mask);
+        __m256i low = _mm256_and_si256(bytes, low_mask);
+        high = _mm256_add_epi8(_mm256_add_epi8(high, zero_digit),
+                               _mm256_and_si256(_mm256_cmpgt_epi8(high, nine), seven));
+        low = _mm256_add_epi8(_mm256_add_epi8(low, zero_digit),
+                              _mm256_and_si256(_mm256_cmpgt_epi8(low, nine), seven));
+        // The unpacks work within each 128-bit lane: bytes 0-7 and 16-23
+        // come out of the first, 8-15 and 24-31 out of the second
+        __m256i first = _mm256_unpacklo_epi8(high, low);
+        __m256i second = _mm256_unpackhi_epi8(high, low);
+        _mm256_storeu_si256((__m256i*)(out + 2 * done), _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i*)(out + 2 * done + 32), _mm256_permute2x128_si256(first, second, 0x31));
+    }
+    return done;
+}
+
+static int detect_level(void) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        int os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+        __cpuidex(info, 7, 0);
+        if (os_saves_ymm && (info[1] & (1 << 5))) {
+            return HEX_ENCODE_AVX2;
+        }
+    }
+    return HEX_ENCODE_SSE2;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? HEX_ENCODE_AVX2 : HEX_ENCODE_SSE2;
+#endif
+}
+
+#else
+
+static int detect_level(void) {
+    return HEX_ENCODE_SCALAR;
+}
+
+#endif // HEX_ENCODE_X86
+
+static int resolve_level(void) {
+    int level = hex_encode_level;
+    if (level == HEX_ENCODE_UNRESOLVED) {
+        level = detect_level();
+        hex_encode_level = level;
+    }
+    return level;
+}
+
+/**
+ * @copydoc hex_encode
+ */
+void hex_encode(const uint8_t* data, size_t length, char* out) {
+    int level = resolve_level();
+
+    size_t done = 0;
+#ifdef HEX_ENCODE_X86
+    if (level == HEX_ENCODE_AVX2) {
+        done = encode_avx2(data, length, out);
+    }
+    done += encode_sse2(data + done, length - done, out + 2 * done);
+#else
+    (void)level;
+#endif
+    encode_scalar(data + done, length - done, out + 2 * done);
+}
+
+/**
+ * @copydoc hex_encode_variant
+ */
+const char* hex_encode_variant(void) {
+    switch (resolve_level()) {
+        case HEX_ENCODE_AVX2: return "avx2";
+        case HEX_ENCODE_SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
@@ -0,0 +1,189 @@
+/**
+ * @file log_binary.c
+ * @brief Encoding and decoding of the binary log file format.
+ */
+#include "log_binary.h"
+
+#include <string.h>
+
+/**
+ * @copydoc log_binary_put_varint
+ */
+size_t log_binary_put_varint(uint8_t *out, uint64_t value) {
+    size_t count = 0;
+    while (value >= 0x80) {
+        out[count++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    out[count++] = (uint8_t)value;
+    return count;
+}
+
+/**
+ * Reads an unsigned LEB128 varint. Returns false if it runs past end or is
+ * longer than a uint64_t can hold.
+ */
+static bool get_varint(const uint8_t **cursor, const uint8_t *end, uint64_t *value) {
+    const uint8_t *p = *cursor;
+    uint64_t result = 0;
+    for (unsigned shift = 0; shift < 7 * LOG_BINARY_VARINT_MAX; shift += 7) {
+        if (p >= end) {
+            return false;
+        }
+        uint8_t byte = *p++;
+        result |= (uint64_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            *cursor = p;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Writes a value as eight little-endian bytes.
+ */
+static void put_u64(uint8_t *out, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/**
+ * @copydoc log_binary_encode_header
+ */
+size_t log_binary_encode_header(uint8_t *out, uint8_t fraction_digits, uint8_t index_width,
+                                uint64_t label_count) {
+    size_t pos = 0;
+    memcpy(out, LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_LENGTH);
+    pos += LOG_BINARY_MAGIC_LENGTH;
+    out[pos++] = LOG_BINARY_VERSION;
+    out[pos++] = fraction_digits;
+    out[pos++] = index_width;
+    out[pos++] = 0;  // Reserved
+    pos += log_binary_put_varint(out + pos, label_count);
+    return pos;
+}
+
+/**
+ * @copydoc log_binary_encode_label
+ */
+size_t log_binary_encode_label(uint8_t *out, uint16_t thread_id, const char *label, size_t length) {
+    size_t pos = 0;
+    out[pos++] = LOG_BINARY_RECORD_LABEL;
+    pos += log_binary_put_varint(out + pos, thread_id);
+    pos += log_binary_put_varint(out + pos, length);
+    memcpy(out + pos, label, length);
+    return pos + length;
+}
+
+/**
+ * @copydoc log_binary_encode_entry
+ */
+size_t log_binary_encode_entry(uint8_t *out, uint64_t index_delta, uint64_t timestamp_ns, uint8_t level,
+                               uint16_t thread_id, const char *message, size_t length) {
+    size_t pos = 0;
+    out[pos++] = LOG_BINARY_RECORD_ENTRY;
+    pos += log_binary_put_varint(out + pos, index_delta);
+    put_u64(out + pos, timestamp_ns);
+    pos += 8;
+    out[pos++] = level;
+    pos += log_binary_put_varint(out + pos, thread_id);
+    pos += log_binary_put_varint(out + pos, length);
+    memcpy(out + pos, message, length);
+    return pos + length;
+}
+
+/**
+ * Reads the length-prefixed text that ends label and entry records.
+ */
+static LogBinaryStatus get_text(const uint8_t **cursor, const uint8_t *end, LogBinaryRecord_T *record) {
+    uint64_t length;
+    if (!get_varint(cursor, end, &length)) {
+        return LOG_BINARY_TRUNCATED;
+    }
+    if (length > (uint64_t)(end - *cursor)) {
+        return LOG_BINARY_TRUNCATED;
+    }
+    record->text = (const char *)*cursor;
+    record->length = (size_t)length;
+    *cursor += length;
+    return LOG_BINARY_OK;
+}
+
+/**
+ * @copydoc log_binary_decode_record
+ */
+LogBinaryStatus log_binary_decode_record(const uint8_t **cursor, const uint8_t *end, LogBinaryRecord_T *record) {
+    const uint8_t *p = *cursor;
+    uint64_t value;
+
+    // A zero type byte is the unused, preallocated tail of a segment file
+    if (p >= end || *p == 0) {
+        return LOG_BINARY_END;
+    }
+    memset(record, 0, sizeof(*record));
+    record->type = (LogBinaryRecordType)*p;
+
+    switch (record->type) {
+        case LOG_BINARY_RECORD_SEGMENT:
+            if ((size_t)(end - p) < LOG_BINARY_MAGIC_LENGTH + 4) {
+                return LOG_BINARY_TRUNCATED;
+            }
+            if (memcmp(p, LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_LENGTH) != 0) {
+                return LOG_BINARY_INVALID;
+            }
+            p += LOG_BINARY_MAGIC_LENGTH;
+            if (*p++ != LOG_BINARY_VERSION) {
+                return LOG_BINARY_INVALID;
+            }
+            record->fraction_digits = *p++;
+            record->index_width = *p++;
+            p++;  // Reserved
+            if (!get_varint(&p, end, &record->label_count)) {
+                return LOG_BINARY_TRUNCATED;
+            }
+            break;
+
+        case LOG_BINARY_RECORD_LABEL: {
+            p++;
+            if (!get_varint(&p, end, &value)) {
+                return LOG_BINARY_TRUNCATED;
+            }
+            record->thread_id = (uint16_t)value;
+            LogBinaryStatus status = get_text(&p, end, record);
+            if (status != LOG_BINARY_OK) {
+                return status;
+            }
+            break;
+        }
+
+        case LOG_BINARY_RECORD_ENTRY: {
+            p++;
+            if (!get_varint(&p, end, &record->index_delta) || end - p < 9) {
+                return LOG_BINARY_TRUNCATED;
+            }
+            for (int i = 0; i < 8; i++) {
+                record->timestamp_ns |= (uint64_t)p[i] << (8 * i);
+            }
+            p += 8;
+            record->level = *p++;
+            if (!get_varint(&p, end, &value)) {
+                return LOG_BINARY_TRUNCATED;
+            }
+            record->thread_id = (uint16_t)value;
+            LogBinaryStatus status = get_text(&p, end, record);
+            if (status != LOG_BINARY_OK) {
+                return status;
+            }
+            break;
+        }
+
+        default:
+            return LOG_BINARY_INVALID;
+    }
+
+    *cursor = p;
+    return LOG_BINARY_OK;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file log_compactor.c
+ * @brief Background compression of rotated log files.
+ */
+#include "log_compactor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "platform_atomic.h"
+#include "platform_mutex.h"
+#include "platform_path.h"
+#include "platform_string.h"
+#include "platform_threads.h"
+
+#include "app_config.h"
+#include "log_lz.h"
+#include "logger.h"
+#include "thread_status_errors.h"
+
+#define LOG_COMPACTOR_QUEUE_SIZE 64   // Rotated files waiting for compression
+#define LOG_COMPACTOR_POLL_MS 250     // How often an idle compactor looks for work
+
+extern const ThreadConfig ThreadConfigTemplate;
+
+static PlatformMutex_T pending_mutex;
+static char pending_files[LOG_COMPACTOR_QUEUE_SIZE][MAX_PATH_LEN];
+static unsigned pending_head = 0;     // Next slot to fill
+static unsigned pending_count = 0;
+static PlatformAtomicBool compactor_running = {0};
+
+/**
+ * @copydoc log_compactor_submit
+ */
+bool log_compactor_submit(const char* file_name) {
+    if (!platform_atomic_load_bool(&compactor_running)) {
+        return false;
+    }
+
+    bool queued = false;
+    lock_mutex(&pending_mutex);
+    if (pending_count < LOG_COMPACTOR_QUEUE_SIZE) {
+        char* slot = pending_files[pending_head];
+        slot[0] = '\0';
+        platform_strcat(slot, file_name, MAX_PATH_LEN);
+        pending_head = (pending_head + 1) % LOG_COMPACTOR_QUEUE_SIZE;
+        pending_count++;
+        queued = true;
+    }
+    unlock_mutex(&pending_mutex);
+    return queued;
+}
+
+/**
+ * @brief Takes the oldest queued file.
+ * @return false if nothing is queued.
+ */
+static bool take_pending_file(char* file_name) {
+    bool taken = false;
+    lock_mutex(&pending_mutex);
+    if (pending_count > 0) {
+        unsigned tail = (pending_head + LOG_COMPACTOR_QUEUE_SIZE - pending_count) % LOG_COMPACTOR_QUEUE_SIZE;
+        memcpy(file_name, pending_files[tail], MAX_PATH_LEN);
+        pending_count--;
+        taken = true;
+    }
+    unlock_mutex(&pending_mutex);
+    return taken;
+}
+
+/**
+ * @brief Replaces a rotated log file with its compressed copy.
+ */
+static void compact_file(const char* file_name, size_t block_size) {
+    char compressed_name[MAX_PATH_LEN];
+    if (snprintf(compressed_name, sizeof(compressed_name), "%s" LOG_LZ_FILE_SUFFIX, file_name) >=
+        (int)sizeof(compressed_name)) {
+        logger_log(LOG_WARN, "Log file name too long to compress: %s", file_name);
+        return;
+    }
+
+    if (!log_lz_compress_file(file_name, compressed_name, block_size, shutdown_signalled)) {
+        if (!shutdown_signalled()) {
+            logger_log(LOG_WARN, "Failed to compress rotated log file %s", file_name);
+        }
+        return;
+    }
+
+    struct stat raw_status;
+    struct stat compressed_status;
+    if (stat(file_name, &raw_status) == 0 && stat(compressed_name, &compressed_status) == 0) {
+        logger_log(LOG_INFO, "Compressed %s: %lld to %lld bytes", file_name,
+                   (long long)raw_status.st_size, (long long)compressed_status.st_size);
+    }
+    if (remove(file_name) != 0) {
+        logger_log(LOG_WARN, "Failed to remove %s after compressing it", file_name);
+    }
+}
+
+static void* log_compactor_function(void* arg) {
+    (void)arg;
+
+    if (!get_config_bool("logger", "compress_rotated_logs", false)) {
+        logger_log(LOG_INFO, "Compression of rotated log files is off");
+        return (void*)THREAD_SUCCESS;
+    }
+    int block_size = get_config_int("logger", "compress_block_size", LOG_LZ_DEFAULT_BLOCK_SIZE);
+    if (block_size <= 0) {
+        block_size = LOG_LZ_DEFAULT_BLOCK_SIZE;
+    }
+
+    // Only run on cycles nothing else wants
+    if (platform_thread_set_priority(platform_thread_get_handle(), PLATFORM_THREAD_PRIORITY_LOWEST) !=
+        PLATFORM_ERROR_SUCCESS) {
+        logger_log(LOG_WARN, "Log compactor could not lower its priority");
+    }
+
+    platform_atomic_store_bool(&compactor_running, true);
+    logger_log(LOG_INFO, "Log compactor started");
+
+    char file_name[MAX_PATH_LEN];
+    while (!shutdown_signalled()) {
+        if (take_pending_file(file_name)) {
+            compact_file(file_name, (size_t)block_size);
+        } else {
+            sleep_ms(LOG_COMPACTOR_POLL_MS);
+        }
+    }
+
+    // Files still queued stay uncompressed; they are complete log files
+    platform_atomic_store_bool(&compactor_running, false);
+    logger_log(LOG_INFO, "Log compactor shutting down");
+    return (void*)THREAD_SUCCESS;
+}
+
+ThreadConfig* get_log_compactor_thread(void) {
+    static ThreadConfig log_compactor_thread;
+    static bool initialized = false;
+
+    if (!initialized) {
+        init_mutex(&pending_mutex);
+        log_compactor_thread = ThreadConfigTemplate;
+        log_compactor_thread.label = "LOG_COMPACTOR";
+        log_compactor_thread.func = log_compactor_function;
+        initialized = true;
+    }
+    return &log_compactor_thread;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file log_flight.c
+ * @brief Flight recorder: the most recent log entries in a memory-mapped ring.
+ */
+#include "log_flight.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_format.h"
+#include "platform_file.h"
+#include "platform_path.h"
+#include "platform_time.h"
+
+_Static_assert(sizeof(LogFlightHeader_T) == LOG_FLIGHT_HEADER_SIZE, "flight header size");
+_Static_assert(sizeof(LogFlightRecord_T) == LOG_FLIGHT_RECORD_SIZE, "flight record size");
+
+static PlatformFileMappingHandle flight_mapping = NULL;
+static LogFlightHeader_T *flight_header = NULL;   // Set only while the ring is mapped
+static LogFlightRecord_T *flight_records = NULL;
+static uint32_t flight_record_count = 0;
+static PlatformHighResTimestamp_T flight_created;
+
+/**
+ * @copydoc log_flight_open
+ */
+bool log_flight_open(const char *file_name, uint32_t record_count) {
+    if (flight_header || !file_name || record_count == 0) {
+        return false;
+    }
+
+    // Keep the last run's ring; it is the one to read after a crash
+    char previous[MAX_PATH_LEN];
+    snprintf(previous, sizeof(previous), "%s.prev", file_name);
+    remove(previous);
+    rename(file_name, previous);
+
+    size_t size = LOG_FLIGHT_HEADER_SIZE + (size_t)record_count * LOG_FLIGHT_RECORD_SIZE;
+    void *address = NULL;
+    PlatformFileMappingHandle mapping = platform_file_map_create(file_name, size, &address, NULL);
+    if (!mapping) {
+        return false;
+    }
+
+    // The mapping starts zeroed: every record reads as never written
+    LogFlightHeader_T *header = address;
+    memcpy(header->magic, LOG_FLIGHT_MAGIC, sizeof(header->magic));
+    header->version = LOG_FLIGHT_VERSION;
+    header->record_size = LOG_FLIGHT_RECORD_SIZE;
+    header->record_count = record_count;
+    header->state = LOG_FLIGHT_STATE_RUNNING;
+
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    platform_get_high_res_timestamp(&flight_created);
+    header->created_time_ns = (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+    platform_atomic_init_uint64(&header->next_sequence, 0);
+
+    flight_mapping = mapping;
+    flight_records = (LogFlightRecord_T *)((char *)address + LOG_FLIGHT_HEADER_SIZE);
+    flight_record_count = record_count;
+    flight_header = header;
+    return true;
+}
+
+/**
+ * @copydoc log_flight_record
+ */
+void log_flight_record(const LogEntry_T *entry) {
+    LogFlightHeader_T *header = flight_header;
+    if (!header) {
+        return;
+    }
+
+    uint64_t sequence = platform_atomic_fetch_add_uint64(&header->next_sequence, 1);
+    LogFlightRecord_T *record = &flight_records[sequence % flight_record_count];
+
+    // Claimed from an older lap, so a record cut short by a crash is not
+    // taken as complete. A newer sequence or a busy slot means this writer
+    // was lapped, and the entry is dropped rather than mixed with another.
+    uint64_t previous = platform_atomic_load_uint64(&record->sequence);
+    do {
+        if (previous == LOG_FLIGHT_SEQUENCE_BUSY || previous > sequence) {
+            return;
+        }
+    } while (!platform_atomic_compare_exchange_uint64(&record->sequence, &previous, LOG_FLIGHT_SEQUENCE_BUSY));
+
+    uint64_t elapsed_ns = 0;
+    platform_timestamp_elapsed(&flight_created, &entry->timestamp, PLATFORM_TIME_GRANULARITY_NS, &elapsed_ns);
+    record->elapsed_ns = elapsed_ns;
+    record->level = (uint8_t)entry->level;
+    size_t label_length = 0;
+    while (label_length < sizeof(record->thread_label) - 1 && entry->thread_label[label_length] != '\0') {
+        label_length++;
+    }
+    memcpy(record->thread_label, entry->thread_label, label_length);
+    record->thread_label[label_length] = '\0';
+
+    // A deferred entry is kept packed, as long as its format fits alongside
+    size_t format_length = entry->site ? strlen(entry->site->format) : 0;
+    if (entry->site && format_length + 1 + entry->message_length <= sizeof(record->data)) {
+        memcpy(record->data, entry->site->format, format_length + 1);
+        memcpy(record->data + format_length + 1, entry->message, entry->message_length);
+        record->deferred = 1;
+        record->format_length = (uint16_t)format_length;
+        record->length = (uint16_t)(format_length + 1 + entry->message_length);
+    } else if (entry->site) {
+        log_format_render(entry->site, entry->message, record->data, sizeof(record->data));
+        record->deferred = 0;
+        record->format_length = 0;
+        record->length = (uint16_t)strlen(record->data);
+    } else {
+        size_t length = entry->message_length < sizeof(record->data) ? entry->message_length
+                                                                      : sizeof(record->data);
+        memcpy(record->data, entry->message, length);
+        record->deferred = 0;
+        record->format_length = 0;
+        record->length = (uint16_t)length;
+    }
+
+    platform_atomic_store_uint64(&record->sequence, sequence + 1);
+}
+
+/**
+ * @copydoc log_flight_close
+ */
+void log_flight_close(void) {
+    LogFlightHeader_T *header = flight_header;
+    if (!header) {
+        return;
+    }
+    // Threads that log after this find the recorder stopped. One already
+    // part way through a record may still be writing, so the ring stays
+    // mapped until the process exits.
+    flight_header = NULL;
+    header->state = LOG_FLIGHT_STATE_CLOSED;
+    platform_file_map_sync(flight_mapping, 0, LOG_FLIGHT_HEADER_SIZE);
+}
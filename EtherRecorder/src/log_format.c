@@ -0,0 +1,237 @@
+/**
+ * @file log_format.c
+ * @brief Deferred formatting of log messages.
+ */
+#include "log_format.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "platform_atomic.h"
+
+// Results of parse_conversion besides a LogArgKind
+#define CONVERSION_PERCENT     (-1)  // "%%", consumes no argument
+#define CONVERSION_UNSUPPORTED (-2)  // '*', %n, wide strings, ... format eagerly
+
+#define MAX_SPEC_LENGTH 32
+
+/**
+ * Parses one conversion specification. On entry *cursor points just past the
+ * '%'; on return it points past the conversion character and spec holds the
+ * complete "%..." text for snprintf.
+ */
+static int parse_conversion(const char **cursor, char *spec, size_t spec_size) {
+    const char *p = *cursor;
+    bool has_precision = false;
+
+    while (*p && strchr("-+ #0", *p)) p++;
+    while (*p >= '0' && *p <= '9') p++;
+    if (*p == '.') {
+        has_precision = true;
+        p++;
+        while (*p >= '0' && *p <= '9') p++;
+    }
+    if (*p == '*') {
+        return CONVERSION_UNSUPPORTED;
+    }
+
+    enum { LEN_NONE, LEN_HH, LEN_H, LEN_L, LEN_LL, LEN_J, LEN_Z, LEN_T, LEN_BIG_L } length = LEN_NONE;
+    switch (*p) {
+        case 'h': p++; length = LEN_H; if (*p == 'h') { p++; length = LEN_HH; } break;
+        case 'l': p++; length = LEN_L; if (*p == 'l') { p++; length = LEN_LL; } break;
+        case 'j': p++; length = LEN_J; break;
+        case 'z': p++; length = LEN_Z; break;
+        case 't': p++; length = LEN_T; break;
+        case 'L': p++; length = LEN_BIG_L; break;
+        default: break;
+    }
+
+    char conversion = *p;
+    if (conversion == '\0') {
+        return CONVERSION_UNSUPPORTED;
+    }
+    p++;
+
+    size_t spec_length = (size_t)(p - *cursor) + 1;
+    if (spec_length >= spec_size) {
+        return CONVERSION_UNSUPPORTED;
+    }
+    spec[0] = '%';
+    memcpy(spec + 1, *cursor, spec_length - 1);
+    spec[spec_length] = '\0';
+    *cursor = p;
+
+    switch (conversion) {
+        case '%':
+            return spec_length == 2 ? CONVERSION_PERCENT : CONVERSION_UNSUPPORTED;
+        case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+            switch (length) {
+                case LEN_NONE: case LEN_HH: case LEN_H: return LOG_ARG_INT;
+                case LEN_L:     return LOG_ARG_LONG;
+                case LEN_LL:    return LOG_ARG_LLONG;
+                case LEN_J:     return LOG_ARG_INTMAX;
+                case LEN_Z:     return LOG_ARG_SIZE;
+                case LEN_T:     return LOG_ARG_PTRDIFF;
+                default:        return CONVERSION_UNSUPPORTED;
+            }
+        case 'c':
+            return length == LEN_NONE ? LOG_ARG_INT : CONVERSION_UNSUPPORTED;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            if (length == LEN_NONE || length == LEN_L) return LOG_ARG_DOUBLE;
+            return length == LEN_BIG_L ? LOG_ARG_LDOUBLE : CONVERSION_UNSUPPORTED;
+        case 'p':
+            return length == LEN_NONE ? LOG_ARG_PTR : CONVERSION_UNSUPPORTED;
+        case 's':
+            // A precision lets the caller pass an unterminated buffer we could
+            // not safely measure, so leave those to vsnprintf.
+            return (length == LEN_NONE && !has_precision) ? LOG_ARG_STRING : CONVERSION_UNSUPPORTED;
+        default:
+            return CONVERSION_UNSUPPORTED;
+    }
+}
+
+/**
+ * @copydoc log_format_prepare_site
+ */
+bool log_format_prepare_site(LogCallSite_T *site, const char *format) {
+    if (!site || !format) {
+        return false;
+    }
+
+    uint32_t state = platform_atomic_load_uint32(&site->state);
+    if (state == LOG_SITE_UNPARSED) {
+        uint32_t expected = LOG_SITE_UNPARSED;
+        if (!platform_atomic_compare_exchange_uint32(&site->state, &expected, LOG_SITE_PARSING)) {
+            return false;  // Another thread is parsing; format this call eagerly
+        }
+
+        uint32_t result = LOG_SITE_DEFERRED;
+        uint8_t count = 0;
+        char spec[MAX_SPEC_LENGTH];
+        for (const char *p = format; *p; ) {
+            if (*p++ != '%') {
+                continue;
+            }
+            int kind = parse_conversion(&p, spec, sizeof(spec));
+            if (kind == CONVERSION_PERCENT) {
+                continue;
+            }
+            if (kind == CONVERSION_UNSUPPORTED || count >= LOG_DEFERRED_MAX_ARGS) {
+                result = LOG_SITE_EAGER;
+                break;
+            }
+            site->arg_kinds[count++] = (uint8_t)kind;
+        }
+        site->arg_count = count;
+        site->format = format;
+        platform_atomic_store_uint32(&site->state, result);
+        state = result;
+    }
+
+    // The debug file:line prefix gives one site two formats; only the parsed one is deferred
+    return state == LOG_SITE_DEFERRED && site->format == format;
+}
+
+/**
+ * @copydoc log_format_pack_args
+ */
+bool log_format_pack_args(const LogCallSite_T *site, char *buffer, size_t size, va_list args,
+                          size_t *packed_size) {
+    size_t pos = 0;
+
+#define PACK_VALUE(type) do {                                   \
+        type value = va_arg(args, type);                        \
+        if (pos + sizeof(value) > size) return false;           \
+        memcpy(buffer + pos, &value, sizeof(value));            \
+        pos += sizeof(value);                                   \
+    } while (0)
+
+    for (uint8_t i = 0; i < site->arg_count; i++) {
+        switch ((LogArgKind)site->arg_kinds[i]) {
+            case LOG_ARG_INT:     PACK_VALUE(int); break;
+            case LOG_ARG_LONG:    PACK_VALUE(long); break;
+            case LOG_ARG_LLONG:   PACK_VALUE(long long); break;
+            case LOG_ARG_INTMAX:  PACK_VALUE(intmax_t); break;
+            case LOG_ARG_SIZE:    PACK_VALUE(size_t); break;
+            case LOG_ARG_PTRDIFF: PACK_VALUE(ptrdiff_t); break;
+            case LOG_ARG_DOUBLE:  PACK_VALUE(double); break;
+            case LOG_ARG_LDOUBLE: PACK_VALUE(long double); break;
+            case LOG_ARG_PTR:     PACK_VALUE(void*); break;
+            case LOG_ARG_STRING: {
+                const char *value = va_arg(args, const char*);
+                if (!value) value = "(null)";
+                if (pos >= size) return false;
+                // Strings are truncated to the space left, as vsnprintf would
+                size_t length = strlen(value);
+                if (length > size - pos - 1) length = size - pos - 1;
+                memcpy(buffer + pos, value, length);
+                buffer[pos + length] = '\0';
+                pos += length + 1;
+                break;
+            }
+        }
+    }
+
+#undef PACK_VALUE
+    *packed_size = pos;
+    return true;
+}
+
+/**
+ * @copydoc log_format_render
+ */
+void log_format_render(const LogCallSite_T *site, const char *packed, char *out, size_t size) {
+    size_t pos = 0;
+    size_t offset = 0;
+    char spec[MAX_SPEC_LENGTH];
+
+    if (size == 0) {
+        return;
+    }
+
+#define RENDER_VALUE(type) do {                                         \
+        type value;                                                     \
+        memcpy(&value, packed + offset, sizeof(value));                 \
+        offset += sizeof(value);                                        \
+        written = snprintf(out + pos, size - pos, spec, value);         \
+    } while (0)
+
+    for (const char *p = site->format; *p && pos < size - 1; ) {
+        if (*p != '%') {
+            out[pos++] = *p++;
+            continue;
+        }
+        p++;
+        int kind = parse_conversion(&p, spec, sizeof(spec));
+        int written = 0;
+        switch (kind) {
+            case CONVERSION_PERCENT: out[pos++] = '%'; break;
+            case LOG_ARG_INT:     RENDER_VALUE(int); break;
+            case LOG_ARG_LONG:    RENDER_VALUE(long); break;
+            case LOG_ARG_LLONG:   RENDER_VALUE(long long); break;
+            case LOG_ARG_INTMAX:  RENDER_VALUE(intmax_t); break;
+            case LOG_ARG_SIZE:    RENDER_VALUE(size_t); break;
+            case LOG_ARG_PTRDIFF: RENDER_VALUE(ptrdiff_t); break;
+            case LOG_ARG_DOUBLE:  RENDER_VALUE(double); break;
+            case LOG_ARG_LDOUBLE: RENDER_VALUE(long double); break;
+            case LOG_ARG_PTR:     RENDER_VALUE(void*); break;
+            case LOG_ARG_STRING: {
+                const char *value = packed + offset;
+                offset += strlen(value) + 1;
+                written = snprintf(out + pos, size - pos, spec, value);
+                break;
+            }
+            default:
+                break;  // Not reachable for a site that parsed as deferred
+        }
+        if (written > 0) {
+            pos += (size_t)written;
+            if (pos > size - 1) pos = size - 1;
+        }
+    }
+
+#undef RENDER_VALUE
+    out[pos] = '\0';
+}
@@ -0,0 +1,277 @@
+/**
+ * @file log_json.c
+ * @brief Streaming JSON writer into a caller's buffer.
+ */
+#include "log_json.h"
+
+#include <string.h>
+
+#include "base64_encode.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define LOG_JSON_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#define LOG_JSON_TIMESTAMP_SIZE 33       // "YYYY-MM-DDTHH:MM:SS.nnnnnnnnnZ" and a spare
+
+/**
+ * @brief Room for a number of bytes, marking the writer overflowed if there is none.
+ */
+static bool reserve(LogJsonWriter* writer, size_t length) {
+    if (writer->overflowed || writer->capacity - writer->length < length) {
+        writer->overflowed = true;
+        return false;
+    }
+    return true;
+}
+
+static void put_char(LogJsonWriter* writer, char c) {
+    if (reserve(writer, 1)) {
+        writer->out[writer->length++] = c;
+    }
+}
+
+/**
+ * @brief The separator due before a member.
+ */
+static void begin_member(LogJsonWriter* writer) {
+    if (writer->need_comma) {
+        put_char(writer, ',');
+    }
+    writer->need_comma = true;
+}
+
+/**
+ * @copydoc log_json_init
+ */
+void log_json_init(LogJsonWriter* writer, char* buffer, size_t capacity) {
+    writer->out = buffer;
+    writer->capacity = capacity;
+    writer->length = 0;
+    writer->need_comma = false;
+    writer->overflowed = false;
+}
+
+void log_json_begin_object(LogJsonWriter* writer) {
+    put_char(writer, '{');
+    writer->need_comma = false;
+}
+
+void log_json_end_object(LogJsonWriter* writer) {
+    put_char(writer, '}');
+    writer->need_comma = true;
+}
+
+/**
+ * @copydoc log_json_key
+ */
+void log_json_key(LogJsonWriter* writer, const char* key) {
+    begin_member(writer);
+    size_t length = strlen(key);
+    if (reserve(writer, length + 3)) {
+        char* out = writer->out + writer->length;
+        out[0] = '"';
+        memcpy(out + 1, key, length);
+        out[length + 1] = '"';
+        out[length + 2] = ':';
+        writer->length += length + 3;
+    }
+    // The value follows the colon, not a comma
+    writer->need_comma = false;
+}
+
+/**
+ * @brief Escapes one byte that cannot appear in a JSON string as it is.
+ * @return The number of characters written.
+ */
+static size_t escape_char(unsigned char c, char* out) {
+    static const char hex_chars[] = "0123456789abcdef";
+    out[0] = '\\';
+    switch (c) {
+        case '"':  out[1] = '"';  return 2;
+        case '\\': out[1] = '\\'; return 2;
+        case '\b': out[1] = 'b';  return 2;
+        case '\f': out[1] = 'f';  return 2;
+        case '\n': out[1] = 'n';  return 2;
+        case '\r': out[1] = 'r';  return 2;
+        case '\t': out[1] = 't';  return 2;
+        default:
+            out[1] = 'u';
+            out[2] = '0';
+            out[3] = '0';
+            out[4] = hex_chars[c >> 4];
+            out[5] = hex_chars[c & 0x0F];
+            return 6;
+    }
+}
+
+static inline bool needs_escape(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+/**
+ * @copydoc log_json_string
+ */
+void log_json_string(LogJsonWriter* writer, const char* text, size_t length) {
+    begin_member(writer);
+    writer->need_comma = true;
+    // Sized for the worst case up front, so the copy below needs no checks
+    if (!reserve(writer, LOG_JSON_STRING_SIZE(length))) {
+        return;
+    }
+
+    char* out = writer->out + writer->length;
+    *out++ = '"';
+    size_t i = 0;
+#ifdef LOG_JSON_SSE2
+    // 16 bytes at a time are stored as they are; the first that needs
+    // escaping ends the run, and the loop picks up after it
+    const __m128i control_max = _mm_set1_epi8(0x1F);
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    while (i + 16 <= length) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i control = _mm_cmpeq_epi8(_mm_max_epu8(chunk, control_max), control_max);
+        __m128i special = _mm_or_si128(control, _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                                             _mm_cmpeq_epi8(chunk, backslash)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(special);
+        _mm_storeu_si128((__m128i*)out, chunk);
+        if (mask == 0) {
+            out += 16;
+            i += 16;
+            continue;
+        }
+        unsigned run = 0;
+        while (!(mask & (1u << run))) {
+            run++;
+        }
+        out += run;
+        i += run;
+        out += escape_char((unsigned char)text[i], out);
+        i++;
+    }
+#endif
+    for (; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        if (needs_escape(c)) {
+            out += escape_char(c, out);
+        } else {
+            *out++ = (char)c;
+        }
+    }
+    *out++ = '"';
+    writer->length = (size_t)(out - writer->out);
+}
+
+/**
+ * @brief Writes a value in decimal.
+ * @return The number of characters written, at most 20.
+ */
+static size_t format_uint(char* out, uint64_t value) {
+    char digits[20];
+    size_t count = 0;
+    do {
+        digits[count++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = digits[count - 1 - i];
+    }
+    return count;
+}
+
+void log_json_uint(LogJsonWriter* writer, uint64_t value) {
+    begin_member(writer);
+    writer->need_comma = true;
+    if (reserve(writer, 20)) {
+        writer->length += format_uint(writer->out + writer->length, value);
+    }
+}
+
+static inline void put_two_digits(char* out, unsigned value) {
+    out[0] = (char)('0' + value / 10);
+    out[1] = (char)('0' + value % 10);
+}
+
+/**
+ * @copydoc log_json_timestamp
+ */
+void log_json_timestamp(LogJsonWriter* writer, int64_t seconds, uint32_t nanoseconds, int fraction_digits) {
+    begin_member(writer);
+    writer->need_comma = true;
+    if (!reserve(writer, LOG_JSON_TIMESTAMP_SIZE)) {
+        return;
+    }
+
+    // Days to a civil date (Howard Hinnant's algorithm), so no gmtime and no locale
+    int64_t days = seconds >= 0 ? seconds / 86400 : (seconds - 86399) / 86400;
+    unsigned second_of_day = (unsigned)(seconds - days * 86400);
+    days += 719468;
+    int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    unsigned day_of_era = (unsigned)(days - era * 146097);
+    unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    unsigned month_index = (5 * day_of_year + 2) / 153;
+    unsigned day = day_of_year - (153 * month_index + 2) / 5 + 1;
+    unsigned month = month_index < 10 ? month_index + 3 : month_index - 9;
+    int64_t year = (int64_t)year_of_era + era * 400 + (month <= 2);
+    if (year < 0 || year > 9999) {
+        year = 0;                        // outside what RFC 3339 can write
+    }
+
+    char* out = writer->out + writer->length;
+    out[0] = '"';
+    put_two_digits(out + 1, (unsigned)(year / 100));
+    put_two_digits(out + 3, (unsigned)(year % 100));
+    out[5] = '-';
+    put_two_digits(out + 6, month);
+    out[8] = '-';
+    put_two_digits(out + 9, day);
+    out[11] = 'T';
+    put_two_digits(out + 12, second_of_day / 3600);
+    out[14] = ':';
+    put_two_digits(out + 15, second_of_day / 60 % 60);
+    out[17] = ':';
+    put_two_digits(out + 18, second_of_day % 60);
+    size_t pos = 20;
+    if (fraction_digits > 0) {
+        out[pos++] = '.';
+        uint32_t fraction = nanoseconds;
+        for (int i = fraction_digits; i < 9; i++) {
+            fraction /= 10;
+        }
+        for (int i = fraction_digits - 1; i >= 0; i--) {
+            out[pos + (size_t)i] = (char)('0' + fraction % 10);
+            fraction /= 10;
+        }
+        pos += (size_t)fraction_digits;
+    }
+    out[pos++] = 'Z';
+    out[pos++] = '"';
+    writer->length += pos;
+}
+
+/**
+ * @copydoc log_json_base64
+ */
+void log_json_base64(LogJsonWriter* writer, const void* data, size_t length) {
+    begin_member(writer);
+    writer->need_comma = true;
+    if (!reserve(writer, BASE64_ENCODED_SIZE(length) + 2)) {
+        return;
+    }
+    char* out = writer->out + writer->length;
+    out[0] = '"';
+    size_t encoded = base64_encode((const uint8_t*)data, length, out + 1);
+    out[encoded + 1] = '"';
+    writer->length += encoded + 2;
+}
+
+/**
+ * @copydoc log_json_finish
+ */
+size_t log_json_finish(LogJsonWriter* writer) {
+    put_char(writer, '\n');
+    return writer->overflowed ? 0 : writer->length;
+}
@@ -0,0 +1,389 @@
+/**
+ * @file log_lz.c
+ * @brief Built-in LZ compression of rotated log files.
+ */
+#include "log_lz.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform_path.h"
+
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 0xFFFF
+#define LZ_HASH_BITS 14
+#define LZ_LAST_LITERALS 5        // Bytes at the end never start or extend a match
+#define LZ_SKIP_SHIFT 6           // Step further through data that does not compress
+
+#define LZ_FILE_HEADER_SIZE 12    // Magic, version, two reserved bytes, block size
+#define LZ_BLOCK_HEADER_SIZE 8    // Raw length and stored length
+#define LZ_INDEX_ENTRY_SIZE 16    // Block offset and raw offset
+#define LZ_TRAILER_SIZE 24        // Index offset, block count and trailer magic
+
+static uint32_t read_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t read_u64(const uint8_t *p) {
+    return (uint64_t)read_u32(p) | (uint64_t)read_u32(p + 4) << 32;
+}
+
+static void write_u32(uint8_t *p, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static void write_u64(uint8_t *p, uint64_t value) {
+    write_u32(p, (uint32_t)value);
+    write_u32(p + 4, (uint32_t)(value >> 32));
+}
+
+static uint32_t hash_sequence(const uint8_t *p) {
+    uint32_t sequence;
+    memcpy(&sequence, p, sizeof(sequence));
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/**
+ * Writes a length that did not fit its 4-bit token field as a run of 255s
+ * and a final byte.
+ */
+static bool put_length(uint8_t *destination, size_t capacity, size_t *out, size_t length) {
+    while (length >= 255) {
+        if (*out >= capacity) return false;
+        destination[(*out)++] = 255;
+        length -= 255;
+    }
+    if (*out >= capacity) return false;
+    destination[(*out)++] = (uint8_t)length;
+    return true;
+}
+
+/**
+ * Writes one sequence: token, literals and, unless it is the last, the match.
+ */
+static bool put_sequence(uint8_t *destination, size_t capacity, size_t *out,
+                         const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length) {
+    size_t match_code = match_length ? match_length - LZ_MIN_MATCH : 0;
+    if (*out >= capacity) return false;
+    destination[(*out)++] = (uint8_t)((literal_length < 15 ? literal_length : 15) << 4 |
+                                      (match_code < 15 ? match_code : 15));
+    if (literal_length >= 15 && !put_length(destination, capacity, out, literal_length - 15)) return false;
+
+    if (literal_length > capacity - *out) return false;
+    memcpy(destination + *out, literals, literal_length);
+    *out += literal_length;
+
+    if (match_length == 0) {
+        return true;
+    }
+    if (capacity - *out < 2) return false;
+    destination[(*out)++] = (uint8_t)offset;
+    destination[(*out)++] = (uint8_t)(offset >> 8);
+    return match_code < 15 || put_length(destination, capacity, out, match_code - 15);
+}
+
+/**
+ * @copydoc log_lz_compress
+ */
+size_t log_lz_compress(const uint8_t *source, size_t length, uint8_t *destination, size_t capacity) {
+    uint32_t table[1 << LZ_HASH_BITS];  // Position + 1 of the last sequence with each hash
+    size_t in = 0;
+    size_t anchor = 0;
+    size_t out = 0;
+
+    memset(table, 0, sizeof(table));
+    if (length > LZ_LAST_LITERALS + LZ_MIN_MATCH) {
+        size_t limit = length - LZ_LAST_LITERALS;
+        while (in + LZ_MIN_MATCH <= limit) {
+            uint32_t hash = hash_sequence(source + in);
+            size_t candidate = table[hash];
+            table[hash] = (uint32_t)(in + 1);
+
+            if (candidate == 0 || in - (candidate - 1) > LZ_MAX_OFFSET ||
+                memcmp(source + candidate - 1, source + in, LZ_MIN_MATCH) != 0) {
+                in += 1 + ((in - anchor) >> LZ_SKIP_SHIFT);
+                continue;
+            }
+
+            size_t reference = candidate - 1;
+            size_t match_length = LZ_MIN_MATCH;
+            while (in + match_length < limit && source[reference + match_length] == source[in + match_length]) {
+                match_length++;
+            }
+            if (!put_sequence(destination, capacity, &out, source + anchor, in - anchor,
+                              in - reference, match_length)) {
+                return 0;
+            }
+            in += match_length;
+            anchor = in;
+            // Remember a position inside the match too; log lines repeat at short distances
+            table[hash_sequence(source + in - 2)] = (uint32_t)(in - 2 + 1);
+        }
+    }
+
+    if (!put_sequence(destination, capacity, &out, source + anchor, length - anchor, 0, 0)) {
+        return 0;
+    }
+    return out;
+}
+
+/**
+ * Reads a length continued past its 4-bit token field.
+ */
+static bool get_length(const uint8_t *source, size_t length, size_t *in, size_t *value) {
+    uint8_t byte;
+    do {
+        if (*in >= length) return false;
+        byte = source[(*in)++];
+        *value += byte;
+    } while (byte == 255);
+    return true;
+}
+
+/**
+ * @copydoc log_lz_decompress
+ */
+bool log_lz_decompress(const uint8_t *source, size_t length, uint8_t *destination, size_t raw_length) {
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < length) {
+        uint8_t token = source[in++];
+
+        size_t literal_length = token >> 4;
+        if (literal_length == 15 && !get_length(source, length, &in, &literal_length)) return false;
+        if (literal_length > length - in || literal_length > raw_length - out) return false;
+        memcpy(destination + out, source + in, literal_length);
+        in += literal_length;
+        out += literal_length;
+
+        if (in == length) {
+            break;  // The last sequence has no match
+        }
+
+        if (length - in < 2) return false;
+        size_t offset = (size_t)source[in] | (size_t)source[in + 1] << 8;
+        in += 2;
+        size_t match_length = token & 15;
+        if (match_length == 15 && !get_length(source, length, &in, &match_length)) return false;
+        match_length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > out || match_length > raw_length - out) return false;
+
+        // Byte by byte: a match may overlap the bytes it is copying
+        const uint8_t *match = destination + out - offset;
+        for (size_t i = 0; i < match_length; i++) {
+            destination[out + i] = match[i];
+        }
+        out += match_length;
+    }
+    return out == raw_length;
+}
+
+/**
+ * Appends one block, stored raw if it does not compress.
+ */
+static bool write_block(FILE *out, const uint8_t *raw, size_t raw_length, uint8_t *scratch, size_t scratch_size) {
+    size_t stored_length = log_lz_compress(raw, raw_length, scratch, scratch_size);
+    const uint8_t *stored = scratch;
+    if (stored_length == 0 || stored_length >= raw_length) {
+        stored = raw;
+        stored_length = raw_length;
+    }
+
+    uint8_t header[LZ_BLOCK_HEADER_SIZE];
+    write_u32(header, (uint32_t)raw_length);
+    write_u32(header + 4, (uint32_t)stored_length);
+    return fwrite(header, 1, sizeof(header), out) == sizeof(header) &&
+           fwrite(stored, 1, stored_length, out) == stored_length;
+}
+
+/**
+ * @copydoc log_lz_compress_file
+ */
+bool log_lz_compress_file(const char *source_file, const char *destination_file, size_t block_size,
+                          LogLzCancel_T cancel) {
+    char temporary_file[MAX_PATH_LEN];
+    if (block_size == 0 || block_size > UINT32_MAX ||
+        snprintf(temporary_file, sizeof(temporary_file), "%s.tmp", destination_file) >= (int)sizeof(temporary_file)) {
+        return false;
+    }
+
+    FILE *in = NULL;
+    FILE *out = NULL;
+    if (platform_fopen(&in, source_file, "rb") != PLATFORM_ERROR_SUCCESS || !in) {
+        return false;
+    }
+    if (platform_fopen(&out, temporary_file, "wb") != PLATFORM_ERROR_SUCCESS || !out) {
+        fclose(in);
+        return false;
+    }
+
+    size_t scratch_size = LOG_LZ_COMPRESS_BOUND(block_size);
+    uint8_t *block = malloc(block_size);
+    uint8_t *scratch = malloc(scratch_size);
+    uint8_t *index = NULL;
+    size_t index_capacity = 0;
+    uint64_t block_count = 0;
+    uint64_t raw_offset = 0;
+    bool ok = block && scratch;
+
+    uint8_t header[LZ_FILE_HEADER_SIZE] = {0};
+    memcpy(header, LOG_LZ_MAGIC, LOG_LZ_MAGIC_LENGTH);
+    header[LOG_LZ_MAGIC_LENGTH] = LOG_LZ_VERSION;
+    write_u32(header + 8, (uint32_t)block_size);
+    ok = ok && fwrite(header, 1, sizeof(header), out) == sizeof(header);
+
+    size_t filled = 0;
+    bool at_end = false;
+    while (ok && !(at_end && filled == 0)) {
+        if (cancel && cancel()) {
+            ok = false;
+            break;
+        }
+        if (!at_end) {
+            size_t read = fread(block + filled, 1, block_size - filled, in);
+            filled += read;
+            at_end = filled < block_size;
+            if (at_end && ferror(in)) {
+                ok = false;
+                break;
+            }
+        }
+        if (filled == 0) {
+            break;
+        }
+
+        // Cut after the last line break so every block starts on a whole line
+        size_t cut = filled;
+        if (!at_end) {
+            while (cut > 0 && block[cut - 1] != '\n') {
+                cut--;
+            }
+            if (cut == 0) {
+                cut = filled;  // One line longer than a block
+            }
+        }
+
+        if (block_count * LZ_INDEX_ENTRY_SIZE >= index_capacity) {
+            size_t capacity = index_capacity ? index_capacity * 2 : 64 * LZ_INDEX_ENTRY_SIZE;
+            uint8_t *grown = realloc(index, capacity);
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            index = grown;
+            index_capacity = capacity;
+        }
+        long position = ftell(out);
+        write_u64(index + block_count * LZ_INDEX_ENTRY_SIZE, (uint64_t)position);
+        write_u64(index + block_count * LZ_INDEX_ENTRY_SIZE + 8, raw_offset);
+        block_count++;
+        raw_offset += cut;
+
+        ok = position >= 0 && write_block(out, block, cut, scratch, scratch_size);
+        memmove(block, block + cut, filled - cut);
+        filled -= cut;
+    }
+
+    if (ok) {
+        long index_offset = ftell(out);
+        uint8_t trailer[LZ_TRAILER_SIZE];
+        write_u64(trailer, (uint64_t)index_offset);
+        write_u64(trailer + 8, block_count);
+        memcpy(trailer + 16, LOG_LZ_TRAILER_MAGIC, 8);
+        ok = index_offset >= 0 &&
+             fwrite(index, 1, (size_t)block_count * LZ_INDEX_ENTRY_SIZE, out) == block_count * LZ_INDEX_ENTRY_SIZE &&
+             fwrite(trailer, 1, sizeof(trailer), out) == sizeof(trailer);
+    }
+
+    free(index);
+    free(scratch);
+    free(block);
+    fclose(in);
+    if (fclose(out) != 0) {
+        ok = false;
+    }
+
+    if (ok) {
+        remove(destination_file);  // rename will not replace a file on Windows
+        ok = rename(temporary_file, destination_file) == 0;
+    }
+    if (!ok) {
+        remove(temporary_file);
+    }
+    return ok;
+}
+
+/**
+ * @copydoc log_lz_is_compressed
+ */
+bool log_lz_is_compressed(const uint8_t *data, size_t size) {
+    return size >= LZ_FILE_HEADER_SIZE + LZ_TRAILER_SIZE &&
+           memcmp(data, LOG_LZ_MAGIC, LOG_LZ_MAGIC_LENGTH) == 0 &&
+           memcmp(data + size - 8, LOG_LZ_TRAILER_MAGIC, 8) == 0;
+}
+
+/**
+ * @copydoc log_lz_decompress_file
+ */
+uint8_t *log_lz_decompress_file(const uint8_t *data, size_t size, uint64_t first_block, uint64_t count,
+                               size_t *raw_size) {
+    if (!log_lz_is_compressed(data, size) || data[LOG_LZ_MAGIC_LENGTH] != LOG_LZ_VERSION) {
+        return NULL;
+    }
+
+    const uint8_t *trailer = data + size - LZ_TRAILER_SIZE;
+    uint64_t index_offset = read_u64(trailer);
+    uint64_t block_count = read_u64(trailer + 8);
+    if (index_offset > size - LZ_TRAILER_SIZE ||
+        block_count > (size - LZ_TRAILER_SIZE - index_offset) / LZ_INDEX_ENTRY_SIZE ||
+        first_block > block_count) {
+        return NULL;
+    }
+    uint64_t last_block = block_count;
+    if (count > 0 && count < block_count - first_block) {
+        last_block = first_block + count;
+    }
+    const uint8_t *index = data + index_offset;
+
+    // Size the output from the block headers, checking each lies within the file
+    uint64_t total = 0;
+    for (uint64_t i = first_block; i < last_block; i++) {
+        uint64_t offset = read_u64(index + i * LZ_INDEX_ENTRY_SIZE);
+        if (offset > index_offset || index_offset - offset < LZ_BLOCK_HEADER_SIZE) {
+            return NULL;
+        }
+        uint32_t stored_length = read_u32(data + offset + 4);
+        if (stored_length > index_offset - offset - LZ_BLOCK_HEADER_SIZE) {
+            return NULL;
+        }
+        total += read_u32(data + offset);
+    }
+    if (total > SIZE_MAX - 1) {
+        return NULL;
+    }
+
+    uint8_t *raw = malloc((size_t)total + 1);
+    if (!raw) {
+        return NULL;
+    }
+    size_t out = 0;
+    for (uint64_t i = first_block; i < last_block; i++) {
+        const uint8_t *block = data + read_u64(index + i * LZ_INDEX_ENTRY_SIZE);
+        uint32_t raw_length = read_u32(block);
+        uint32_t stored_length = read_u32(block + 4);
+        bool ok = stored_length == raw_length ?
+                  (memcpy(raw + out, block + LZ_BLOCK_HEADER_SIZE, raw_length), true) :
+                  log_lz_decompress(block + LZ_BLOCK_HEADER_SIZE, stored_length, raw + out, raw_length);
+        if (!ok) {
+            free(raw);
+            return NULL;
+        }
+        out += raw_length;
+    }
+    *raw_size = out;
+    return raw;
+}
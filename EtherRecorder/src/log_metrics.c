@@ -0,0 +1,238 @@
+/**
+ * @file log_metrics.c
+ * @brief Counters and histograms of the logging pipeline.
+ */
+#include "log_metrics.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "utils.h"
+
+#define METRICS_LINE_SIZE 1024
+
+bool g_log_metrics_enabled = false;
+
+static PlatformAtomicBool report_requested = {0};
+
+// Logger thread only
+static uint64_t drained_total = 0;
+static uint32_t second_start_ms = 0;
+static uint32_t drained_this_second = 0;
+static double fill_this_second = 0.0;
+static uint32_t drain_history[LOG_METRICS_HISTORY_SECONDS];     // Entries drained per second
+static uint8_t fill_history[LOG_METRICS_HISTORY_SECONDS];       // Peak fill per second, percent
+static unsigned history_next = 0;
+static unsigned history_count = 0;
+static uint32_t drain_peak = 0;
+static double fill_peak = 0.0;
+static uint64_t depth_samples[LOG_METRICS_DEPTH_BUCKETS];
+static uint64_t dropped_total[LOG_METRICS_LEVELS];
+static uint64_t suppressed_total = 0;
+
+static const char *level_names[LOG_METRICS_LEVELS] = {
+    "TRACE", "DEBUG", "INFO", "NOTICE", "WARN", "ERROR", "CRITICAL", "FATAL"
+};
+
+/**
+ * @copydoc log_metrics_add_queue_stats
+ */
+void log_metrics_add_queue_stats(LogQueueStats_T *total, const LogQueueStats_T *stats) {
+    total->submitted.value += platform_atomic_load_uint64(&stats->submitted);
+    total->overflows.value += platform_atomic_load_uint64(&stats->overflows);
+    for (unsigned i = 0; i < LOG_METRICS_LATENCY_BUCKETS; i++) {
+        total->latency[i].value += platform_atomic_load_uint64(&stats->latency[i]);
+    }
+}
+
+/**
+ * @copydoc log_metrics_latency_bucket
+ */
+unsigned log_metrics_latency_bucket(uint64_t latency_ns) {
+    unsigned bucket = 0;
+    while (latency_ns != 0 && bucket < LOG_METRICS_LATENCY_BUCKETS - 1) {
+        latency_ns >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * Closes the current second into the history, along with any seconds the
+ * logger spent parked with nothing to drain.
+ */
+static void roll_seconds(uint32_t now) {
+    if (second_start_ms == 0) {
+        second_start_ms = now;
+        return;
+    }
+
+    while (now - second_start_ms >= 1000) {
+        drain_history[history_next] = drained_this_second;
+        fill_history[history_next] = (uint8_t)(fill_this_second * 100.0 + 0.5);
+        history_next = (history_next + 1) % LOG_METRICS_HISTORY_SECONDS;
+        if (history_count < LOG_METRICS_HISTORY_SECONDS) {
+            history_count++;
+        }
+        if (drained_this_second > drain_peak) {
+            drain_peak = drained_this_second;
+        }
+        drained_this_second = 0;
+        fill_this_second = 0.0;
+
+        // A long park leaves nothing worth recording second by second
+        if (now - second_start_ms >= 1000 * LOG_METRICS_HISTORY_SECONDS) {
+            second_start_ms = now - 1000;
+        }
+        second_start_ms += 1000;
+    }
+}
+
+/**
+ * @copydoc log_metrics_note_drain
+ */
+void log_metrics_note_drain(uint32_t drained, double fill) {
+    roll_seconds(get_time_ms());
+
+    drained_total += drained;
+    drained_this_second += drained;
+    if (fill > fill_this_second) {
+        fill_this_second = fill;
+    }
+    if (fill > fill_peak) {
+        fill_peak = fill;
+    }
+    unsigned bucket = (unsigned)(fill * LOG_METRICS_DEPTH_BUCKETS);
+    depth_samples[bucket < LOG_METRICS_DEPTH_BUCKETS ? bucket : LOG_METRICS_DEPTH_BUCKETS - 1]++;
+}
+
+/**
+ * @copydoc log_metrics_note_dropped
+ */
+void log_metrics_note_dropped(const uint64_t counts[LOG_METRICS_LEVELS]) {
+    for (unsigned i = 0; i < LOG_METRICS_LEVELS; i++) {
+        dropped_total[i] += counts[i];
+    }
+}
+
+/**
+ * @copydoc log_metrics_note_suppressed
+ */
+void log_metrics_note_suppressed(uint64_t count) {
+    suppressed_total += count;
+}
+
+/**
+ * @copydoc log_metrics_request_report
+ */
+void log_metrics_request_report(void) {
+    platform_atomic_store_bool(&report_requested, true);
+}
+
+/**
+ * @copydoc log_metrics_take_report_request
+ */
+bool log_metrics_take_report_request(void) {
+    if (!platform_atomic_load_bool(&report_requested)) {
+        return false;
+    }
+    bool expected = true;
+    return platform_atomic_compare_exchange_bool(&report_requested, &expected, false);
+}
+
+/**
+ * Upper bound in nanoseconds of the bucket the given fraction of latencies falls in.
+ */
+static uint64_t latency_percentile(const LogQueueStats_T *queues, uint64_t total, double fraction) {
+    uint64_t wanted = (uint64_t)((double)total * fraction);
+    if (wanted >= total) {
+        wanted = total - 1;
+    }
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < LOG_METRICS_LATENCY_BUCKETS; i++) {
+        seen += queues->latency[i].value;
+        if (seen > wanted) {
+            return i == 0 ? 0 : (1ULL << i) - 1;
+        }
+    }
+    return (1ULL << (LOG_METRICS_LATENCY_BUCKETS - 1)) - 1;
+}
+
+/**
+ * @copydoc log_metrics_report
+ */
+void log_metrics_report(const LogQueueStats_T *queues, void (*emit)(const char *line)) {
+    char line[METRICS_LINE_SIZE];
+    int pos;
+
+    roll_seconds(get_time_ms());
+
+    // Throughput and losses
+    uint64_t dropped = 0;
+    for (unsigned i = 0; i < LOG_METRICS_LEVELS; i++) {
+        dropped += dropped_total[i];
+    }
+    pos = snprintf(line, sizeof(line),
+                   "Log metrics: %llu submitted, %llu drained, %llu queue overflows, %llu dropped",
+                   (unsigned long long)queues->submitted.value, (unsigned long long)drained_total,
+                   (unsigned long long)queues->overflows.value, (unsigned long long)dropped);
+    const char *separator = " (";
+    for (unsigned i = 0; i < LOG_METRICS_LEVELS && pos < (int)sizeof(line); i++) {
+        if (dropped_total[i] > 0) {
+            pos += snprintf(line + pos, sizeof(line) - (size_t)pos, "%s%s %llu", separator, level_names[i],
+                            (unsigned long long)dropped_total[i]);
+            separator = ", ";
+        }
+    }
+    if (pos < (int)sizeof(line)) {
+        snprintf(line + pos, sizeof(line) - (size_t)pos, "%s, %llu suppressed by rate limits",
+                 dropped > 0 ? ")" : "", (unsigned long long)suppressed_total);
+    }
+    emit(line);
+
+    // Enqueue latency
+    uint64_t samples = 0;
+    for (unsigned i = 0; i < LOG_METRICS_LATENCY_BUCKETS; i++) {
+        samples += queues->latency[i].value;
+    }
+    if (samples > 0) {
+        pos = snprintf(line, sizeof(line),
+                       "Log metrics: enqueue latency p50 <= %llu ns, p90 <= %llu ns, p99 <= %llu ns, "
+                       "max <= %llu ns; by bucket:",
+                       (unsigned long long)latency_percentile(queues, samples, 0.50),
+                       (unsigned long long)latency_percentile(queues, samples, 0.90),
+                       (unsigned long long)latency_percentile(queues, samples, 0.99),
+                       (unsigned long long)latency_percentile(queues, samples, 1.0));
+        for (unsigned i = 0; i < LOG_METRICS_LATENCY_BUCKETS && pos < (int)sizeof(line); i++) {
+            if (queues->latency[i].value > 0) {
+                pos += snprintf(line + pos, sizeof(line) - (size_t)pos, " <%llu:%llu",
+                                (unsigned long long)(1ULL << i), (unsigned long long)queues->latency[i].value);
+            }
+        }
+        emit(line);
+    }
+
+    // Drain rate, oldest second first
+    pos = snprintf(line, sizeof(line), "Log metrics: drained per second peak %u; last %u s:",
+                   drain_peak, history_count);
+    for (unsigned i = 0; i < history_count && pos < (int)sizeof(line); i++) {
+        unsigned slot = (history_next + LOG_METRICS_HISTORY_SECONDS - history_count + i) % LOG_METRICS_HISTORY_SECONDS;
+        pos += snprintf(line + pos, sizeof(line) - (size_t)pos, " %u", drain_history[slot]);
+    }
+    emit(line);
+
+    // Queue depth
+    pos = snprintf(line, sizeof(line), "Log metrics: fullest queue peak %.0f%%; passes by fill:", fill_peak * 100.0);
+    for (unsigned i = 0; i < LOG_METRICS_DEPTH_BUCKETS && pos < (int)sizeof(line); i++) {
+        pos += snprintf(line + pos, sizeof(line) - (size_t)pos, " %u%%:%llu", i * 10,
+                        (unsigned long long)depth_samples[i]);
+    }
+    if (pos < (int)sizeof(line)) {
+        pos += snprintf(line + pos, sizeof(line) - (size_t)pos, "; per second peak %% last %u s:", history_count);
+    }
+    for (unsigned i = 0; i < history_count && pos < (int)sizeof(line); i++) {
+        unsigned slot = (history_next + LOG_METRICS_HISTORY_SECONDS - history_count + i) % LOG_METRICS_HISTORY_SECONDS;
+        pos += snprintf(line + pos, sizeof(line) - (size_t)pos, " %u", fill_history[slot]);
+    }
+    emit(line);
+}
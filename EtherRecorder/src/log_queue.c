@@ -1,16 +1,17 @@
 #include "log_queue.h"
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 
-#include "platform_random.h"
-#include "platform_mutex.h"
 #include "platform_atomic.h"
+#include "platform_sync.h"
+#include "platform_threads.h"
+#include "platform_time.h"
 
 #include "logger.h"
+#include "app_thread.h"
 
-extern void log_immediately(const LogEntry_T* entry);
-
-extern PlatformMutex_T logging_mutex; // Mutex for thread safety
 LogQueue_T global_log_queue; // Define the log queue
 
 
@@ -19,30 +20,112 @@ LogQueue_T global_log_queue; // Define the log queue
 
 bool console_logging_suspended = false;
 
+// Per-thread queues, published for the logger thread to merge
+static PlatformAtomicPtr thread_queues[MAX_THREADS];
+static PlatformAtomicUInt32 thread_queue_high_water = {0};  // Slots in use are all below this
+static THREAD_LOCAL LogQueue_T *this_thread_queue = NULL;
+
+// Overflow handling
+static LogOverflowPolicy overflow_policy = LOG_OVERFLOW_BLOCK;
+static LogQueue_T spill_log_queue;              // Shared by all producers under LOG_OVERFLOW_SPILL_TO_DISK
+static bool spill_enabled = false;
+static THREAD_LOCAL uint64_t spilled_until = 0;  // Spill position just past this thread's last spilled entry
+static PlatformAtomicBool consumer_closed = {0};
+static PlatformAtomicUInt64 dropped_entries[LOG_QUEUE_LEVELS];
+
+// Metrics, logger thread only
+static LogQueueStats_T freed_queue_stats;  // Counters of thread queues already freed
+static double last_fill = 0.0;
+
+#define LOG_RECORD_CLAIMED 0x80000000u  // Size bit held while a record is consumed or evicted
+
+/**
+ * Header state of a published record. The position, in units of
+ * LOG_RECORD_ALIGN, tells the record apart from a later one at the same
+ * offset of the ring.
+ */
+static uint64_t record_state(uint64_t position, uint64_t size) {
+    return ((position / LOG_RECORD_ALIGN) << 32) | size;
+}
+
+// Parking of the logger thread when every queue is empty
+static PlatformEvent_T logger_wakeup_event = NULL;
+static PlatformAtomicBool logger_parked = {0};  // Set while the logger is, or is about to be, asleep
+
+static void init_ring(LogQueue_T *queue, uint8_t *buffer, uint64_t capacity, bool single_producer) {
+    queue->buffer = buffer;
+    queue->capacity = capacity;
+    queue->mask = capacity - 1;
+    queue->single_producer = single_producer;
+    queue->cached_tail = 0;
+    platform_atomic_init_uint64(&queue->head, 0);
+    platform_atomic_init_uint64(&queue->tail, 0);
+    platform_atomic_init_bool(&queue->retired, false);
+    memset(&queue->stats, 0, sizeof(queue->stats));
+}
+
 /**
  * @copydoc log_queue_init
  */
-void log_queue_init(LogQueue_T *queue) {
-    queue->head.value = 0;
-    queue->tail.value = 0;
-    // Initialize all slot states to empty (0)
-    memset(queue->slot_states, 0, LOG_QUEUE_SIZE * sizeof(uint32_t));
+bool log_queue_init(LogQueue_T *queue, uint64_t capacity, bool single_producer) {
+    // Zeroed memory reads as "not yet published" everywhere
+    uint8_t *buffer = calloc(1, capacity + LOG_RECORD_MAX_SIZE);
+    if (!buffer) {
+        return false;
+    }
+    init_ring(queue, buffer, capacity, single_producer);
+    queue->mapping = NULL;
+    return true;
 }
 
-static double get_queue_capacity(const LogQueue_T* queue) {
-    uint32_t head = platform_atomic_load_uint32(&queue->head);
-    uint32_t tail = platform_atomic_load_uint32(&queue->tail);
-    
-    uint32_t used;
-    if (head >= tail) {
-        used = head - tail;
+/**
+ * @copydoc log_queue_init_mapped
+ */
+bool log_queue_init_mapped(LogQueue_T *queue, uint64_t capacity, const char *file_name) {
+    void *buffer = NULL;
+    // A new mapping is zero filled, just like calloc
+    PlatformFileMappingHandle mapping = platform_file_map_create(file_name, capacity + LOG_RECORD_MAX_SIZE,
+                                                                 &buffer, NULL);
+    if (!mapping) {
+        return false;
+    }
+    init_ring(queue, buffer, capacity, false);
+    queue->mapping = mapping;
+    return true;
+}
+
+/**
+ * @copydoc log_queue_destroy
+ */
+void log_queue_destroy(LogQueue_T *queue) {
+    if (queue->mapping) {
+        platform_file_map_close(queue->mapping);
+        queue->mapping = NULL;
     } else {
-        used = LOG_QUEUE_SIZE - (tail - head);
+        free(queue->buffer);
     }
-    
-    return (double)used / LOG_QUEUE_SIZE;
+    queue->buffer = NULL;
+    queue->capacity = 0;
+}
+
+static double get_queue_capacity(const LogQueue_T* queue) {
+    uint64_t head = platform_atomic_load_uint64(&queue->head);
+    uint64_t tail = platform_atomic_load_uint64(&queue->tail);
+
+    // Producers may briefly overshoot head past a full ring, clamp it
+    uint64_t used = head - tail;
+    if (used > queue->capacity) {
+        used = queue->capacity;
+    }
+
+    return (double)used / (double)queue->capacity;
 }
 
+/**
+ * Suspends console output when a queue nears capacity and resumes it once
+ * the backlog has drained. Runs on the consumer so producers never block or
+ * touch the console here.
+ */
 static void handle_queue_capacity_state(double capacity) {
     // If we hit high watermark, suspend console logging
     if (capacity >= QUEUE_HIGH_WATERMARK && !console_logging_suspended) {
@@ -50,10 +133,6 @@ static void handle_queue_capacity_state(double capacity) {
         LogEntry_T warning;
         create_log_entry(&warning, LOG_WARN, "Queue near capacity - suspending console output");
         log_now(&warning);  // Direct log to avoid recursion
-        fflush(stdout);
-        fflush(stderr);
-        console_logging_suspended = true;
-        sleep_ms(100);
     }
     // If we drop below low watermark, resume console logging
     else if (capacity <= QUEUE_LOW_WATERMARK && console_logging_suspended) {
@@ -64,191 +143,549 @@ static void handle_queue_capacity_state(double capacity) {
     }
 }
 
+static LogRecordHeader_T *record_at(const LogQueue_T *queue, uint64_t position) {
+    return (LogRecordHeader_T *)(queue->buffer + (position & queue->mask));
+}
+
+static bool evict_oldest(LogQueue_T *queue);
+
 /**
- * Helper function for exponential backoff
+ * Gives up a reservation that overshot a full ring, by moving head back.
+ *
+ * The bytes reserved may still hold records the consumer has not read, so
+ * no skip record can be written there. Only the latest reservation can be
+ * given up; later ones overshoot further, so they are given up first.
+ * @return false if a later reservation is still in place.
  */
-static void backoff_delay(int attempt) {
-    if (attempt <= 0) return;
-    
-    // Exponential backoff with a cap
-    int delay = (1 << (attempt > 10 ? 10 : attempt)); // Cap at 2^10
-    
-    // Add some randomness to avoid thundering herd problem
-    delay = delay + (int)platform_random_range(0, delay);
-    
-    sleep_ms(delay);
+static bool release_reservation(LogQueue_T *queue, uint64_t position, uint64_t size) {
+    uint64_t end = position + size;
+    return platform_atomic_compare_exchange_uint64(&queue->head, &end, position);
 }
 
 /**
- * @copydoc log_queue_push
+ * Pushes a record and, on success, reports the byte position it ends at.
  */
-bool log_queue_push(LogQueue_T *log_queue, const LogEntry_T *entry) {
+static bool push_record(LogQueue_T *log_queue, const LogEntry_T *entry, uint64_t *end_position) {
     if (!entry || entry->thread_label[0] == '\0') {
         return false;
     }
 
-    // Check queue capacity and deal with any issues
-    handle_queue_capacity_state(get_queue_capacity(log_queue));
-
-    #define MAX_RETRY_ATTEMPTS 100
-    int attempt = 0;
-    
-    while (attempt < MAX_RETRY_ATTEMPTS) {
-        uint32_t head = platform_atomic_load_uint32(&log_queue->head);
-        uint32_t tail = platform_atomic_load_uint32(&log_queue->tail);
-        uint32_t next_head = (head + 1) % LOG_QUEUE_SIZE;
-
-        // Check if next slot would be tail
-        if (next_head == tail) {
-            // Handle overflow - we must acquire the mutex for this
-            lock_mutex(&logging_mutex);
-            
-            // After acquiring mutex, reread indices and recheck if full
-            head = platform_atomic_load_uint32(&log_queue->head);
-            tail = platform_atomic_load_uint32(&log_queue->tail);
-            
-            if ((head + 1) % LOG_QUEUE_SIZE == tail) {
-                // Queue is still full, need to purge some entries
-                int purge_count = LOG_QUEUE_SIZE/10;
-                LogEntry_T entry_1;
-                char msg[LOG_MSG_BUFFER_SIZE];
-                snprintf(msg, sizeof(msg), "Log queue overflow. Publishing oldest %d log entries immediately", purge_count);
-                create_log_entry(&entry_1, LOG_ERROR, msg);
-                // note: log_immediately does not acquire the mutex, log_now does.
-                log_immediately(&entry_1);
-                
-                while (purge_count > 0) {
-                    head = platform_atomic_load_uint32(&log_queue->head);
-                    tail = platform_atomic_load_uint32(&log_queue->tail);
-                    
-                    if (head == tail) break;
-                    
-                    LogEntry_T popped_entry;
-                    // Pop entries directly (not using log_queue_pop to avoid potential mutex deadlock)
-                    popped_entry = log_queue->entries[tail];
-                    uint32_t next_tail = (tail + 1) % LOG_QUEUE_SIZE;
-                    if (!platform_atomic_compare_exchange_uint32(&log_queue->tail, &tail, next_tail)) {
-                        // CAS failed - another thread modified tail
-                        // We should retry this iteration
-                        continue;
-                    }
-                    
-                    // Log the popped entry immediately
-                    log_immediately(&popped_entry);
-                    purge_count--;
-                }
-                
-                LogEntry_T entry_2;
-                create_log_entry(&entry_2, LOG_ERROR, "Log queue overflow. Purged complete");
-                log_immediately(&entry_2);
-                
-                unlock_mutex(&logging_mutex);
-            } else {
-                // Queue is no longer full, release mutex and try again
-                unlock_mutex(&logging_mutex);
+    size_t label_length = strnlen(entry->thread_label, THREAD_LABEL_SIZE - 1);
+    size_t message_length = entry->message_length < LOG_MSG_BUFFER_SIZE ?
+                            entry->message_length : LOG_MSG_BUFFER_SIZE - 1;
+    uint64_t size = (sizeof(LogRecordHeader_T) + label_length + message_length + LOG_RECORD_ALIGN - 1)
+                    & ~(uint64_t)(LOG_RECORD_ALIGN - 1);
+
+    uint64_t position;
+    if (log_queue->single_producer) {
+        // Only this thread moves head, so no read-modify-write is needed and
+        // tail is only re-read when the ring looks full.
+        position = platform_atomic_load_uint64(&log_queue->head);
+        if (position + size - log_queue->cached_tail > log_queue->capacity) {
+            log_queue->cached_tail = platform_atomic_load_uint64(&log_queue->tail);
+            if (position + size - log_queue->cached_tail > log_queue->capacity) {
+                return false;
             }
-            
-            // Try again from the beginning
-            attempt++; // Increment attempt counter
-            backoff_delay(attempt);
-            continue;
         }
+        platform_atomic_store_uint64(&log_queue->head, position + size);
+    } else {
+        // Refuse rather than reserve space the consumer has not released
+        uint64_t head = platform_atomic_load_uint64(&log_queue->head);
+        uint64_t tail = platform_atomic_load_uint64(&log_queue->tail);
+        if (head + size - tail > log_queue->capacity) {
+            return false;
+        }
+        position = platform_atomic_fetch_add_uint64(&log_queue->head, size);
 
-        // Check if current slot is already reserved or written
-        uint8_t state = platform_atomic_load_uint8(&log_queue->slot_states[head]);
-        if (state == SLOT_RESERVED || state == SLOT_WRITTEN) {
-            // Slot is either reserved or written, move to next slot
-            head = next_head;
-            attempt++; // Increment attempt counter
-            backoff_delay(attempt);
-            continue;
+        // Several producers can pass the check above together and overshoot by
+        // a few records. Only under LOG_OVERFLOW_BLOCK do they wait for the
+        // consumer to release the space; otherwise they make room themselves
+        // or give the space back, and the caller drops or spills the entry.
+        while (position + size - platform_atomic_load_uint64(&log_queue->tail) > log_queue->capacity) {
+            bool closed = platform_atomic_load_bool(&consumer_closed);
+            if (overflow_policy == LOG_OVERFLOW_DROP_OLDEST && !closed) {
+                if (!evict_oldest(log_queue)) {
+                    platform_thread_yield();
+                }
+                continue;
+            }
+            if ((overflow_policy != LOG_OVERFLOW_BLOCK || closed) &&
+                release_reservation(log_queue, position, size)) {
+                return false;
+            }
+            platform_thread_yield();
         }
+    }
 
-        // Try to reserve the slot with atomic compare-exchange
-        uint8_t expected_state = SLOT_EMPTY;
-        if (!platform_atomic_compare_exchange_uint8(
-                &log_queue->slot_states[head],
-                &expected_state,
-                SLOT_RESERVED)) {
-            // Another thread modified the state, try again
-            attempt++; // Increment attempt counter
-            backoff_delay(attempt);
-            continue;
+    LogRecordHeader_T *record = record_at(log_queue, position);
+    uint8_t *body = (uint8_t *)(record + 1);
+    record->level = (uint8_t)entry->level;
+    record->label_length = (uint8_t)label_length;
+    record->message_length = (uint16_t)message_length;
+    record->timestamp = entry->timestamp;
+    record->site = entry->site;
+    record->route = entry->route;
+    memcpy(body, entry->thread_label, label_length);
+    memcpy(body + label_length, entry->message, message_length);
+
+    // Publishing the size makes the record visible to the consumer
+    platform_atomic_store_uint64(&record->state, record_state(position, size));
+
+    // Only the push that finds the logger parked pays for waking it
+    if (platform_atomic_load_bool(&logger_parked)) {
+        bool parked = true;
+        if (platform_atomic_compare_exchange_bool(&logger_parked, &parked, false)) {
+            platform_event_set(logger_wakeup_event);
         }
-        
-        // Try to claim the slot
-        if (platform_atomic_compare_exchange_uint32(&log_queue->head, &head, next_head)) {
-            // Write entry
-            log_queue->entries[head] = *entry;
-            // Mark as fully written
-            platform_atomic_store_uint8(&log_queue->slot_states[head], SLOT_WRITTEN);
+    }
+
+    if (end_position) {
+        *end_position = position + size;
+    }
+    return true;
+}
+
+/**
+ * @copydoc log_queue_push
+ */
+bool log_queue_push(LogQueue_T *log_queue, const LogEntry_T *entry) {
+    return push_record(log_queue, entry, NULL);
+}
+
+/**
+ * Returns the record at the front of the queue without consuming it, or NULL
+ * if the queue is empty or the front record is still being written.
+ */
+static const LogRecordHeader_T *log_queue_peek(const LogQueue_T *queue) {
+    uint64_t tail = platform_atomic_load_uint64(&queue->tail);
+    const LogRecordHeader_T *record = record_at(queue, tail);
+
+    uint32_t size = (uint32_t)platform_atomic_load_uint64(&record->state);
+    if (size == 0 || (size & LOG_RECORD_CLAIMED)) {
+        return NULL;
+    }
+    return record;
+}
+
+/**
+ * Takes sole hold of the record at tail so it can be consumed or evicted.
+ * Needed under LOG_OVERFLOW_DROP_OLDEST, where producers advance tail too;
+ * whoever holds the front record is the only one who may advance it.
+ *
+ * Between reading tail and claiming, the record may be evicted and its bytes
+ * reused by a later record, or by the middle of one. The claim compares the
+ * position and size in one exchange, so it only ever marks the very record
+ * tail pointed at, and that record cannot have been passed by tail.
+ */
+static LogRecordHeader_T *claim_front(LogQueue_T *queue, uint64_t *tail, uint32_t *size) {
+    uint64_t position = platform_atomic_load_uint64(&queue->tail);
+    LogRecordHeader_T *record = record_at(queue, position);
+
+    uint64_t state = platform_atomic_load_uint64(&record->state);
+    uint32_t current = (uint32_t)state;
+    if (current == 0 || (current & LOG_RECORD_CLAIMED) || state != record_state(position, current)) {
+        return NULL;
+    }
+    if (!platform_atomic_compare_exchange_uint64(&record->state, &state, state | LOG_RECORD_CLAIMED)) {
+        return NULL;
+    }
+
+    *tail = position;
+    *size = current;
+    return record;
+}
+
+static void count_dropped(LogLevel level) {
+    uint32_t index = (uint32_t)level < LOG_QUEUE_LEVELS ? (uint32_t)level : LOG_FATAL;
+    platform_atomic_fetch_add_uint64(&dropped_entries[index], 1);
+}
+
+/**
+ * Discards the oldest record of a queue to make room for a new one.
+ * Returns false if the front record is still being written or consumed.
+ */
+static bool evict_oldest(LogQueue_T *queue) {
+    uint64_t tail;
+    uint32_t size;
+    LogRecordHeader_T *record = claim_front(queue, &tail, &size);
+    if (!record) {
+        return false;
+    }
+    count_dropped((LogLevel)record->level);
+    memset(record, 0, size);
+    platform_atomic_store_uint64(&queue->tail, tail + size);
+    return true;
+}
+
+/**
+ * @copydoc log_queue_set_overflow_policy
+ */
+bool log_queue_set_overflow_policy(LogOverflowPolicy policy, const char *spill_file, uint64_t spill_size) {
+    overflow_policy = policy;
+    if (policy != LOG_OVERFLOW_SPILL_TO_DISK || spill_enabled) {
+        return true;
+    }
+    spill_enabled = log_queue_init_mapped(&spill_log_queue, spill_size, spill_file);
+    return spill_enabled;
+}
+
+/**
+ * Adds to a counter of a queue's stats. A thread's own queue has only its
+ * owner writing, so a plain load and store do without a locked add.
+ */
+static void add_stat(const LogQueue_T *queue, PlatformAtomicUInt64 *counter, uint64_t value) {
+    if (queue->single_producer) {
+        platform_atomic_store_uint64(counter, platform_atomic_load_uint64(counter) + value);
+    } else {
+        platform_atomic_fetch_add_uint64(counter, value);
+    }
+}
+
+/**
+ * Pushes an entry, applying the overflow policy if the queue is full.
+ */
+static bool submit_entry(LogQueue_T *log_queue, const LogEntry_T *entry) {
+
+    // Once a thread has spilled it stays on the spill queue until the logger
+    // has taken all of it, or its own queue could overtake what it spilled
+    if (spilled_until != 0) {
+        if (platform_atomic_load_uint64(&spill_log_queue.tail) < spilled_until) {
+            if (!push_record(&spill_log_queue, entry, &spilled_until)) {
+                count_dropped(entry->level);
+            }
             return true;
         }
-        // If CAS failed, reset state and retry
-        platform_atomic_store_uint8(&log_queue->slot_states[head], SLOT_EMPTY);
-        attempt++; // Increment attempt counter
-        backoff_delay(attempt);
-    }
-    
-    // If we've reached here, we've failed after MAX_RETRY_ATTEMPTS
-    // Fall back to a guaranteed approach using the mutex
-    lock_mutex(&logging_mutex);
-    
-    // After acquiring mutex, check if we can now add to the queue
-    uint32_t head = platform_atomic_load_uint32(&log_queue->head);
-    uint32_t tail = platform_atomic_load_uint32(&log_queue->tail);
-    
-    if ((head + 1) % LOG_QUEUE_SIZE == tail) {
-        // Queue is still full, log directly
-        log_immediately(entry);
-        unlock_mutex(&logging_mutex);
+        spilled_until = 0;
+    }
+
+    if (log_queue_push(log_queue, entry)) {
         return true;
+    }
+
+    if (g_log_metrics_enabled) {
+        add_stat(log_queue, &log_queue->stats.overflows, 1);
+    }
+
+    switch (overflow_policy) {
+        case LOG_OVERFLOW_BLOCK:
+            while (!log_queue_push(log_queue, entry)) {
+                if (platform_atomic_load_bool(&consumer_closed)) {
+                    return false;
+                }
+                platform_thread_yield();
+            }
+            return true;
+
+        case LOG_OVERFLOW_DROP_OLDEST:
+            // A long entry may need more than one record evicted
+            while (!log_queue_push(log_queue, entry)) {
+                if (platform_atomic_load_bool(&consumer_closed)) {
+                    return false;
+                }
+                if (!evict_oldest(log_queue)) {
+                    platform_thread_yield();
+                }
+            }
+            return true;
+
+        case LOG_OVERFLOW_SPILL_TO_DISK:
+            if (spill_enabled && push_record(&spill_log_queue, entry, &spilled_until)) {
+                return true;
+            }
+            break;  // Spill file full too
+
+        case LOG_OVERFLOW_DROP_NEWEST:
+        default:
+            break;
+    }
+
+    count_dropped(entry->level);
+    return true;
+}
+
+/**
+ * @copydoc log_queue_submit
+ */
+bool log_queue_submit(LogQueue_T *log_queue, const LogEntry_T *entry) {
+    if (!entry || entry->thread_label[0] == '\0' || platform_atomic_load_bool(&consumer_closed)) {
+        return false;
+    }
+
+    if (!submit_entry(log_queue, entry)) {
+        return false;
+    }
+
+    if (g_log_metrics_enabled) {
+        // From the entry's timestamp, so formatting on the caller is included
+        PlatformHighResTimestamp_T queued;
+        uint64_t latency_ns = 0;
+        platform_get_high_res_timestamp(&queued);
+        platform_timestamp_elapsed(&entry->timestamp, &queued, PLATFORM_TIME_GRANULARITY_NS, &latency_ns);
+        add_stat(log_queue, &log_queue->stats.submitted, 1);
+        add_stat(log_queue, &log_queue->stats.latency[log_metrics_latency_bucket(latency_ns)], 1);
+    }
+    return true;
+}
+
+/**
+ * @copydoc log_queue_collect_stats
+ */
+void log_queue_collect_stats(LogQueueStats_T *total) {
+    memset(total, 0, sizeof(*total));
+    log_metrics_add_queue_stats(total, &freed_queue_stats);
+    log_metrics_add_queue_stats(total, &global_log_queue.stats);
+    if (spill_enabled) {
+        log_metrics_add_queue_stats(total, &spill_log_queue.stats);
+    }
+    uint32_t high_water = platform_atomic_load_uint32(&thread_queue_high_water);
+    for (uint32_t i = 0; i < high_water; i++) {
+        LogQueue_T *queue = platform_atomic_load_ptr(&thread_queues[i]);
+        if (queue) {
+            log_metrics_add_queue_stats(total, &queue->stats);
+        }
+    }
+}
+
+/**
+ * @copydoc log_queue_last_fill
+ */
+double log_queue_last_fill(void) {
+    return last_fill;
+}
+
+/**
+ * @copydoc log_queue_close_consumer
+ */
+void log_queue_close_consumer(void) {
+    platform_atomic_store_bool(&consumer_closed, true);
+}
+
+/**
+ * @copydoc log_queue_take_dropped
+ */
+uint64_t log_queue_take_dropped(uint64_t counts[LOG_QUEUE_LEVELS]) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < LOG_QUEUE_LEVELS; i++) {
+        counts[i] = platform_atomic_exchange_uint64(&dropped_entries[i], 0);
+        total += counts[i];
+    }
+    return total;
+}
+
+/**
+ * @copydoc log_queue_pop
+ */
+bool log_queue_pop(LogQueue_T *queue, LogEntry_T *entry) {
+    if (!entry) {
+        return false;
+    }
+
+    uint64_t tail;
+    uint32_t size;
+    LogRecordHeader_T *record;
+    if (overflow_policy == LOG_OVERFLOW_DROP_OLDEST) {
+        record = claim_front(queue, &tail, &size);
+        if (!record) {
+            return false;
+        }
     } else {
-        // Queue has space now, add entry with mutex held
-        uint32_t new_head = (head + 1) % LOG_QUEUE_SIZE;
-        
-        // Write the entry
-        log_queue->entries[head] = *entry;
-        
-        // Mark as written
-        platform_atomic_store_uint8(&log_queue->slot_states[head], SLOT_WRITTEN);
-        
-        // Update head pointer
-        platform_atomic_store_uint32(&log_queue->head, new_head);
-        
-        unlock_mutex(&logging_mutex);
+        // Only the consumer writes tail
+        tail = platform_atomic_load_uint64(&queue->tail);
+        record = record_at(queue, tail);
+        size = (uint32_t)platform_atomic_load_uint64(&record->state);
+        if (size == 0) {
+            return false;
+        }
+    }
+
+    const uint8_t *body = (const uint8_t *)(record + 1);
+    entry->level = (LogLevel)record->level;
+    entry->timestamp = record->timestamp;
+    entry->site = record->site;
+    entry->route = record->route;
+    memcpy(entry->thread_label, body, record->label_length);
+    entry->thread_label[record->label_length] = '\0';
+    memcpy(entry->message, body + record->label_length, record->message_length);
+    entry->message[record->message_length] = '\0';
+    entry->message_length = record->message_length;
+
+    // Leave the space zeroed so unpublished headers read as empty next lap
+    memset(record, 0, size);
+    platform_atomic_store_uint64(&queue->tail, tail + size);
+    return true;
+}
+
+/**
+ * @copydoc log_queue_attach_thread
+ */
+bool log_queue_attach_thread(void) {
+    if (this_thread_queue) {
         return true;
     }
+
+    LogQueue_T *queue = malloc(sizeof(LogQueue_T));
+    if (!queue) {
+        return false;
+    }
+    if (!log_queue_init(queue, LOG_THREAD_QUEUE_SIZE, true)) {
+        free(queue);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < MAX_THREADS; i++) {
+        void *expected = NULL;
+        if (platform_atomic_compare_exchange_ptr(&thread_queues[i], &expected, queue)) {
+            // Raise the high-water mark so the logger scans this slot
+            uint32_t high_water = platform_atomic_load_uint32(&thread_queue_high_water);
+            while (high_water <= i &&
+                   !platform_atomic_compare_exchange_uint32(&thread_queue_high_water, &high_water, i + 1)) {
+            }
+            this_thread_queue = queue;
+            return true;
+        }
+    }
+
+    // No free slot, keep using the global queue
+    log_queue_destroy(queue);
+    free(queue);
+    return false;
+}
+
+/**
+ * @copydoc log_queue_detach_thread
+ */
+void log_queue_detach_thread(void) {
+    if (!this_thread_queue) {
+        return;
+    }
+    LogQueue_T *queue = this_thread_queue;
+    this_thread_queue = NULL;
+    // From here on the logger owns the queue
+    platform_atomic_store_bool(&queue->retired, true);
 }
 
+/**
+ * @copydoc log_queue_for_thread
+ */
+LogQueue_T *log_queue_for_thread(void) {
+    return this_thread_queue ? this_thread_queue : &global_log_queue;
+}
 
-bool log_queue_pop(LogQueue_T *queue, LogEntry_T *entry) {
+/**
+ * Offers the front record of one queue to the merge. Returns false if the
+ * queue has a record reserved but not yet published at its front: that
+ * record may be older than every other front, so nothing may be popped yet.
+ */
+static bool merge_candidate(LogQueue_T *queue, LogQueue_T **oldest_queue, uint64_t *oldest_timestamp,
+                            double *fullest) {
+    const LogRecordHeader_T *front = log_queue_peek(queue);
+    if (!front) {
+        return platform_atomic_load_uint64(&queue->head) == platform_atomic_load_uint64(&queue->tail);
+    }
+
+    double used = get_queue_capacity(queue);
+    if (used > *fullest) {
+        *fullest = used;
+    }
+    if (!*oldest_queue || front->timestamp.counter < *oldest_timestamp) {
+        *oldest_queue = queue;
+        *oldest_timestamp = front->timestamp.counter;
+    }
+    return true;
+}
+
+/**
+ * @copydoc log_queue_pop_merged
+ */
+bool log_queue_pop_merged(LogEntry_T *entry) {
     if (!entry) {
         return false;
     }
 
-    while (true) {
-        uint32_t tail = platform_atomic_load_uint32(&queue->tail);
-        uint32_t head = platform_atomic_load_uint32(&queue->head);
+    LogQueue_T *oldest_queue = NULL;
+    uint64_t oldest_timestamp = 0;
+    double fullest = 0.0;
 
-        if (tail == head) {
-            return false;
+    // Queues are looked at one after another, so a record stamped after this
+    // may have a predecessor from the same thread that was not yet visible
+    // in a queue already looked at. Only records stamped before now are taken.
+    PlatformHighResTimestamp_T now;
+    platform_get_high_res_timestamp(&now);
+
+    bool settled = merge_candidate(&global_log_queue, &oldest_queue, &oldest_timestamp, &fullest);
+    if (spill_enabled) {
+        settled &= merge_candidate(&spill_log_queue, &oldest_queue, &oldest_timestamp, &fullest);
+    }
+
+    uint32_t high_water = platform_atomic_load_uint32(&thread_queue_high_water);
+    for (uint32_t i = 0; i < high_water; i++) {
+        LogQueue_T *queue = platform_atomic_load_ptr(&thread_queues[i]);
+        if (!queue) {
+            continue;
         }
 
-        // Only read if state is written 
-        if (platform_atomic_load_uint8(&queue->slot_states[tail]) != SLOT_WRITTEN) {
+        // Read retired before peeking: once set, every push has completed
+        bool retired = platform_atomic_load_bool(&queue->retired);
+        if (retired && !log_queue_peek(queue)) {
+            platform_atomic_store_ptr(&thread_queues[i], NULL);
+            log_metrics_add_queue_stats(&freed_queue_stats, &queue->stats);
+            log_queue_destroy(queue);
+            free(queue);
             continue;
         }
+        settled &= merge_candidate(queue, &oldest_queue, &oldest_timestamp, &fullest);
+    }
+
+    handle_queue_capacity_state(fullest);
+    last_fill = fullest;
+
+    return settled && oldest_queue && oldest_timestamp <= now.counter && log_queue_pop(oldest_queue, entry);
+}
 
-        uint32_t next_tail = (tail + 1) % LOG_QUEUE_SIZE;
-        if (platform_atomic_compare_exchange_uint32(&queue->tail, &tail, next_tail)) {
-            // Copy the entry
-            *entry = queue->entries[tail];
-            // Mark as available using the constant instead of 0
-            platform_atomic_store_uint8(&queue->slot_states[tail], SLOT_EMPTY);
+/**
+ * Returns true if any queue has a record published at its front.
+ */
+static bool log_queue_any_pending(void) {
+    if (log_queue_peek(&global_log_queue) || (spill_enabled && log_queue_peek(&spill_log_queue))) {
+        return true;
+    }
+    uint32_t high_water = platform_atomic_load_uint32(&thread_queue_high_water);
+    for (uint32_t i = 0; i < high_water; i++) {
+        LogQueue_T *queue = platform_atomic_load_ptr(&thread_queues[i]);
+        if (queue && log_queue_peek(queue)) {
             return true;
         }
     }
+    return false;
+}
+
+/**
+ * @copydoc log_queue_init_wakeup
+ */
+bool log_queue_init_wakeup(void) {
+    if (logger_wakeup_event) {
+        return true;
+    }
+    platform_atomic_init_bool(&logger_parked, false);
+    return platform_event_create(&logger_wakeup_event, false, false) == PLATFORM_ERROR_SUCCESS;
+}
+
+/**
+ * @copydoc log_queue_park
+ */
+void log_queue_park(uint32_t timeout_ms) {
+    if (!logger_wakeup_event) {
+        sleep_ms(1);
+        return;
+    }
+
+    // Announce the park before the last look at the queues. A producer that
+    // published after that look is bound to see the flag and set the event.
+    platform_atomic_store_bool(&logger_parked, true);
+    if (!log_queue_any_pending()) {
+        platform_event_wait(logger_wakeup_event, timeout_ms);
+    }
+    platform_atomic_store_bool(&logger_parked, false);
 }
 
 bool is_console_logging_suspended(void) {
@@ -15,14 +15,21 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <stdbool.h>
-#include <math.h>
 #include <errno.h>
 
 #include "platform_time.h"
 #include "log_queue.h"
+#include "log_format.h"
+#include "log_binary.h"
+#include "log_compactor.h"
+#include "log_lz.h"
+#include "log_metrics.h"
+#include "log_flight.h"
+#include "log_json.h"
 #include "platform_threads.h"
 #include "platform_atomic.h"
 #include "platform_path.h"
+#include "platform_file.h"
 #include "platform_mutex.h"
 #include "platform_string.h"
 #include "platform_time.h"
@@ -52,18 +59,39 @@ extern const ThreadConfig ThreadConfigTemplate;
 
 extern bool console_logging_suspended;
 
+// Formatted lines waiting to be written to one destination in a single write
+typedef struct LogStaging {
+    char *data;
+    size_t used;
+    size_t capacity;
+} LogStaging;
+
 // New structure to manage unique file pointers
 typedef struct LogFile {
     char file_name[MAX_PATH_LEN];
     FILE *fp;
     bool first_open;
     int ref_count;
+    LogStaging staging;
+    uint64_t bytes_written;  // size of the file, counted as lines are staged
+    uint64_t total_bytes;    // bytes written across every rotation, for the metrics report
+    bool rotate_pending;     // reached g_log_file_size, rotated by the next housekeeping pass
+    bool segment_pending;    // binary format: a segment header is due before the next record
+    unsigned long long last_index;                    // binary format: index of the segment's last entry
+    uint8_t labels_sent[LOG_BINARY_MAX_THREADS / 8];  // binary format: thread ids defined in the segment
+    PlatformFileMappingHandle mapping;  // mmap writer: the mapped segment, used instead of fp
+    char *segment;                      // mmap writer: start of the mapping
+    uint64_t segment_size;              // mmap writer: bytes mapped and preallocated
+    uint64_t synced_bytes;              // mmap and async writers: bytes already handed over to be synced
+    PlatformFileWriterHandle writer;    // async writer: used instead of fp and staging
 } LogFile;
 
 // Table of unique log files
 static LogFile log_files[MAX_THREADS];
 static int g_log_file_count = 0;
 
+static LogStaging console_staging;  // Lines waiting for stderr
+
 // Modified existing structure to reference LogFile
 typedef struct ThreadLogFile {
     char thread_label[MAX_PATH_LEN];
@@ -82,6 +110,12 @@ typedef enum LogTimestampGranularity {
     LOG_TS_SECOND      = 1           // 1/1
 } LogTimestampGranularity;
 
+typedef enum LogFileFormat {
+    LOG_FILE_FORMAT_TEXT,    // one line per entry, as on the console
+    LOG_FILE_FORMAT_BINARY,  // log_binary.h records, decoded by etherlog-dump
+    LOG_FILE_FORMAT_JSON     // one JSON object per line, as in docs/LOG_FORMAT_SPEC.md
+} LogFileFormat;
+
 #ifdef _DEBUG
 // only relevant in debug builds
 bool g_trace_all = false;
@@ -94,14 +128,35 @@ static ThreadLogFile thread_log_files[MAX_THREADS + 1]; // +1 for the main appli
 static THREAD_LOCAL int g_timestamp_initialised = 0;
 
 static LogTimestampGranularity g_log_timestamp_granularity = LOG_TS_NANOSECOND;  // Default
+static int g_log_fraction_digits = 9;  // Digits after the seconds, follows the granularity
 
 
 #ifdef _DEBUG
-static LogLevel g_log_level = LOG_DEBUG;
+#define LOG_DEFAULT_LEVEL LOG_DEBUG
 #else
-static LogLevel g_log_level = LOG_INFO;
+#define LOG_DEFAULT_LEVEL LOG_INFO
 #endif
 
+#define CONFIG_LOG_LEVELS_SECTION "log_levels"  // per thread label levels, e.g. CLIENT.* = debug
+
+/**
+ * @brief The level of one thread label.
+ *
+ * Slot 0 is the global level, followed by every label without a
+ * [log_levels] entry. Slots are never moved or freed, so each thread keeps
+ * a pointer to its own in g_thread_log_level.
+ */
+typedef struct LogLevelSlot {
+    char label[THREAD_LABEL_SIZE];
+    bool pinned;             // set by [log_levels] or a command, so logger_set_level leaves it alone
+    volatile uint8_t level;  // LogLevel, read without the mutex by logger_log
+} LogLevelSlot;
+
+static LogLevelSlot log_level_slots[MAX_THREADS + 1] = { { "", false, LOG_DEFAULT_LEVEL } };
+static int g_log_level_slot_count = 1;
+
+THREAD_LOCAL const volatile uint8_t *g_thread_log_level = &log_level_slots[0].level;
+
 static LogOutput g_log_output = LOG_OUTPUT_BOTH; // Log output destination
 int g_log_leading_zeros = 12;
 
@@ -119,7 +174,50 @@ static off_t g_log_file_size = 10485760;                  // Log file size befor
 
 static PlatformThreadHandle log_thread; // Logging thread
 static bool logging_thread_started = false; // indicate whether the logger thread has started
+static THREAD_LOCAL bool is_logger_thread = false; // the queue consumer must never wait on its own queue
+static THREAD_LOCAL uint16_t this_thread_route = APP_LOG_FILE_INDEX; // thread_log_files index for this thread's entries
 static bool g_purge_logs_on_restart = false;
+static bool g_log_deferred_formatting = true; // format on the logger thread where the call site allows
+static uint32_t g_log_flush_interval_ms = 5;  // longest a line may wait in a staging buffer
+static size_t g_log_flush_bytes = 65536;      // staging buffer size, written out when full
+static bool g_log_park_when_idle = true;      // sleep until woken once the queues stay empty
+static LogOverflowPolicy g_log_overflow_policy = LOG_OVERFLOW_BLOCK; // what a producer does when its queue is full
+static char g_log_spill_file_name[MAX_PATH_LEN] = "log_spill.bin"; // overflow file for spill_to_disk
+static uint64_t g_log_spill_size = 0x1000000;                     // bytes in the spill ring
+static LogFileFormat g_log_file_format = LOG_FILE_FORMAT_TEXT;     // layout of the log files (the console is always text)
+static uint32_t g_log_rate_limit = 0;             // entries per call site per interval, 0 for no limit
+static uint32_t g_log_rate_interval_ms = 1000;    // interval the rate limit applies to
+static PlatformAtomicPtr suppressed_sites = {0};  // LogCallSite_T list, sites with entries to report
+static bool g_log_mmap_segments = false;        // write log files through preallocated memory-mapped segments
+static uint32_t g_log_mmap_sync_interval_ms = 1000;  // how often mapped segments are handed to the OS to write out
+static bool g_log_async_writes = false;           // write log files through platform file writers (io_uring on Linux)
+static unsigned g_log_async_write_buffers = 4;    // flush_bytes sized buffers per file, written while the next fills
+static uint32_t g_log_async_sync_interval_ms = 1000;  // how often async written files are fsynced, 0 for never
+
+// Binary format thread ids: the labels seen so far. Once full, the last id is relabelled as needed
+static char binary_thread_labels[LOG_BINARY_MAX_THREADS][THREAD_LABEL_SIZE];
+static int g_binary_thread_count = 0;
+
+#define LOG_DRAIN_BATCH 256  // entries the logger thread publishes per hold of the mutex
+
+// Idle logger thread: empty polls spent spinning, then yielding, before it parks
+#define LOG_IDLE_SPIN_POLLS 64
+#define LOG_IDLE_YIELD_POLLS 64
+#define LOG_PARK_TIMEOUT_MS 100  // upper bound on noticing shutdown while parked
+
+#define LOG_DECIMAL_MAX_DIGITS 24  // widest index format_decimal will pad to
+#define LOG_LINE_BUFFER_SIZE (LOG_MSG_BUFFER_SIZE + THREAD_LABEL_SIZE + 128)  // message plus prefix
+
+// A JSON record: every character of the message and label escaped, plus the other members
+#define LOG_JSON_RECORD_SIZE \
+    (LOG_JSON_STRING_SIZE(LOG_MSG_BUFFER_SIZE) + LOG_JSON_STRING_SIZE(THREAD_LABEL_SIZE) + 128)
+
+// Most bytes one entry can add to a log file: a text line, a JSON record, or a
+// binary entry that also starts a segment defining every thread label
+#define LOG_SEGMENT_RESERVE \
+    (LOG_LINE_BUFFER_SIZE + LOG_JSON_RECORD_SIZE + LOG_BINARY_HEADER_MAX_SIZE + \
+     (LOG_BINARY_MAX_THREADS + 1) * (LOG_BINARY_RECORD_OVERHEAD + THREAD_LABEL_SIZE) + \
+     LOG_BINARY_RECORD_OVERHEAD + LOG_MSG_BUFFER_SIZE)
  
 void init_logger_mutex(void) {
     /* Initialise the mutex, vital this is down before any logging */
@@ -210,11 +308,279 @@ void init_logger_mutex(void) {
  }
  
  /**
-  * @brief Publishes a log entry to the appropriate destination (file or console).
+  * @brief Writes out everything staged for a destination with one write.
+  */
+ static void flush_staging(LogStaging* staging, FILE* log_output) {
+     if (staging->used == 0 || !log_output) {
+         return;
+     }
+     platform_write(log_output, staging->data, staging->used);
+     fflush(log_output);
+     staging->used = 0;
+ }
+
+ /**
+  * @brief Appends a formatted line to a destination's staging buffer.
+  *
+  * The buffer is written out first if the line does not fit. If no buffer
+  * can be had the line is written straight through.
+  */
+ static void stage_log_line(LogStaging* staging, FILE* log_output, const char* line, size_t length) {
+     if (!staging->data) {
+         staging->data = malloc(g_log_flush_bytes);
+         staging->capacity = staging->data ? g_log_flush_bytes : 0;
+         staging->used = 0;
+     }
+     if (staging->used + length > staging->capacity) {
+         flush_staging(staging, log_output);
+     }
+     if (length > staging->capacity) {
+         platform_write(log_output, line, length);
+         fflush(log_output);
+         return;
+     }
+     memcpy(staging->data + staging->used, line, length);
+     staging->used += length;
+ }
+
+ /**
+  * @brief Writes out the staging buffers of every destination. Caller holds the logging mutex.
+  */
+ static void flush_log_output(void) {
+     for (int i = 0; i < g_log_file_count; i++) {
+         if (log_files[i].writer) {
+             platform_file_writer_flush(log_files[i].writer, false);  // does not wait for the disk
+         } else {
+             flush_staging(&log_files[i].staging, log_files[i].fp);
+         }
+     }
+     flush_staging(&console_staging, stderr);
+ }
+
+ /**
+  * @brief Writes a value in decimal, zero padded to at least width digits.
+  * @return The number of characters written (at most LOG_DECIMAL_MAX_DIGITS).
+  */
+ static size_t format_decimal(char* out, unsigned long long value, int width) {
+     static const char digit_pairs[] =
+         "00010203040506070809"
+         "10111213141516171819"
+         "20212223242526272829"
+         "30313233343536373839"
+         "40414243444546474849"
+         "50515253545556575859"
+         "60616263646566676869"
+         "70717273747576777879"
+         "80818283848586878889"
+         "90919293949596979899";
+     char digits[LOG_DECIMAL_MAX_DIGITS];
+     size_t count = 0;
+
+     // Two digits at a time, least significant first
+     while (value >= 100) {
+         size_t pair = (size_t)(value % 100) * 2;
+         value /= 100;
+         digits[count++] = digit_pairs[pair + 1];
+         digits[count++] = digit_pairs[pair];
+     }
+     if (value >= 10) {
+         size_t pair = (size_t)value * 2;
+         digits[count++] = digit_pairs[pair + 1];
+         digits[count++] = digit_pairs[pair];
+     } else {
+         digits[count++] = (char)('0' + value);
+     }
+     while ((int)count < width && count < sizeof(digits)) {
+         digits[count++] = '0';
+     }
+
+     for (size_t i = 0; i < count; i++) {
+         out[i] = digits[count - 1 - i];
+     }
+     return count;
+ }
+
+ /**
+  * @brief Renders the "YYYY-mm-dd HH:MM:SS" part of a timestamp.
+  *
+  * localtime and strftime only run when the second changes; every other line
+  * reuses the cached text. Caller holds the logging mutex.
+  * @return The length of the text.
+  */
+ static size_t format_timestamp_seconds(time_t seconds, char* out) {
+     static time_t cached_second = (time_t)-1;
+     static char cached_text[32];
+     static size_t cached_length = 0;
+
+     if (seconds != cached_second) {
+         struct tm timeinfo;
+         platform_localtime(&seconds, &timeinfo);
+         cached_length = strftime(cached_text, sizeof(cached_text), "%Y-%m-%d %H:%M:%S", &timeinfo);
+         cached_second = seconds;
+     }
+     memcpy(out, cached_text, cached_length);
+     return cached_length;
+ }
+
+ /**
+  * @brief Stages bytes for a log file and counts them towards its rotation size.
+  *
+  * With the mmap writer the bytes are copied into the mapped segment instead,
+  * which costs no system call.
+  */
+ static void stage_log_file_bytes(LogFile* log_file, const void* data, size_t length) {
+     if (log_file->mapping) {
+         // Straight into the segment; make_segment_room left space for the whole entry
+         if (log_file->bytes_written + length > log_file->segment_size) {
+             return;
+         }
+         memcpy(log_file->segment + log_file->bytes_written, data, length);
+     } else if (log_file->writer) {
+         platform_file_writer_write(log_file->writer, data, length);
+     } else {
+         stage_log_line(&log_file->staging, log_file->fp, data, length);
+     }
+     log_file->bytes_written += length;
+     log_file->total_bytes += length;
+     if (log_file->bytes_written >= (uint64_t)g_log_file_size) {
+         log_file->rotate_pending = true;
+     }
+ }
+
+ /**
+  * @brief Finds the binary format thread id for a label, adding it if it is new.
+  *
+  * Once every id is taken, labels share the last one, and any file that has
+  * it defined as another label gets it redefined. Caller holds the logging mutex.
+  */
+ static uint16_t binary_thread_id(const char* label) {
+     static uint16_t last_id = 0;
+
+     // Consecutive entries mostly come from the same thread
+     if (last_id < g_binary_thread_count && strcmp(binary_thread_labels[last_id], label) == 0) {
+         return last_id;
+     }
+     for (int id = 0; id < g_binary_thread_count; id++) {
+         if (strcmp(binary_thread_labels[id], label) == 0) {
+             last_id = (uint16_t)id;
+             return last_id;
+         }
+     }
+
+     if (g_binary_thread_count < LOG_BINARY_MAX_THREADS) {
+         last_id = (uint16_t)g_binary_thread_count++;
+     } else {
+         last_id = LOG_BINARY_MAX_THREADS - 1;
+         for (int i = 0; i < g_log_file_count; i++) {
+             log_files[i].labels_sent[last_id / 8] &= (uint8_t)~(1u << (last_id % 8));
+         }
+     }
+     binary_thread_labels[last_id][0] = '\0';
+     platform_strcat(binary_thread_labels[last_id], label, sizeof(binary_thread_labels[last_id]));
+     return last_id;
+ }
+
+ /**
+  * @brief Stages an entry for a binary format log file.
+  *
+  * Starts a segment first if the file was just opened, and defines the
+  * entry's thread label if the segment has not seen it yet.
+  */
+ static void stage_binary_entry(LogFile* log_file, const LogEntry_T* entry, unsigned long long index,
+                                uint64_t timestamp_ns) {
+     uint8_t record[LOG_BINARY_RECORD_OVERHEAD + LOG_MSG_BUFFER_SIZE];
+
+     if (log_file->segment_pending) {
+         size_t length = log_binary_encode_header(record, (uint8_t)g_log_fraction_digits,
+                                                  (uint8_t)(g_log_leading_zeros >= 0 ? g_log_leading_zeros : 12),
+                                                  (uint64_t)g_binary_thread_count);
+         stage_log_file_bytes(log_file, record, length);
+         memset(log_file->labels_sent, 0, sizeof(log_file->labels_sent));
+         for (int id = 0; id < g_binary_thread_count; id++) {
+             length = log_binary_encode_label(record, (uint16_t)id, binary_thread_labels[id],
+                                              strlen(binary_thread_labels[id]));
+             stage_log_file_bytes(log_file, record, length);
+             log_file->labels_sent[id / 8] |= (uint8_t)(1u << (id % 8));
+         }
+         log_file->last_index = 0;
+         log_file->segment_pending = false;
+     }
+
+     uint16_t thread_id = binary_thread_id(entry->thread_label);
+     uint8_t bit = (uint8_t)(1u << (thread_id % 8));
+     if (!(log_file->labels_sent[thread_id / 8] & bit)) {
+         size_t length = log_binary_encode_label(record, thread_id, binary_thread_labels[thread_id],
+                                                 strlen(binary_thread_labels[thread_id]));
+         stage_log_file_bytes(log_file, record, length);
+         log_file->labels_sent[thread_id / 8] |= bit;
+     }
+
+     size_t message_length = strnlen(entry->message, sizeof(entry->message));
+     size_t length = log_binary_encode_entry(record, index - log_file->last_index, timestamp_ns,
+                                             (uint8_t)entry->level, thread_id, entry->message, message_length);
+     stage_log_file_bytes(log_file, record, length);
+     log_file->last_index = index;
+ }
+
+ /**
+  * @brief Names a level for a JSON record, without the text layout's padding.
+  */
+ static const char* json_level_name(LogLevel level) {
+     switch (level) {
+         case LOG_TRACE:    return "TRACE";
+         case LOG_DEBUG:    return "DEBUG";
+         case LOG_INFO:     return "INFO";
+         case LOG_NOTICE:   return "NOTICE";
+         case LOG_WARN:     return "WARN";
+         case LOG_ERROR:    return "ERROR";
+         case LOG_CRITICAL: return "CRITICAL";
+         case LOG_FATAL:    return "FATAL";
+         default:           return "UNKNOWN";
+     }
+ }
+
+ /**
+  * @brief Stages an entry for a JSON format log file, one object per line.
+  */
+ static void stage_json_entry(LogFile* log_file, const LogEntry_T* entry, unsigned long long index,
+                              time_t seconds, int64_t nanoseconds) {
+     char record[LOG_JSON_RECORD_SIZE];
+     LogJsonWriter json;
+     log_json_init(&json, record, sizeof(record));
+
+     log_json_begin_object(&json);
+     log_json_key(&json, "index");
+     log_json_uint(&json, index);
+     log_json_key(&json, "timestamp");
+     log_json_timestamp(&json, (int64_t)seconds, (uint32_t)nanoseconds, g_log_fraction_digits);
+     log_json_key(&json, "level");
+     const char* level_name = json_level_name(entry->level);
+     log_json_string(&json, level_name, strlen(level_name));
+     log_json_key(&json, "thread");
+     log_json_string(&json, entry->thread_label, strnlen(entry->thread_label, sizeof(entry->thread_label)));
+     log_json_key(&json, "message");
+     log_json_string(&json, entry->message, strnlen(entry->message, sizeof(entry->message)));
+     log_json_end_object(&json);
+
+     size_t length = log_json_finish(&json);
+     if (length > 0) {
+         stage_log_file_bytes(log_file, record, length);
+     }
+ }
+
+ /**
+  * @brief Publishes a log entry to the appropriate destinations.
+  *
+  * The line is formatted once; the console copy only adds the colour codes
+  * around the level. A binary or JSON format log file gets its own record
+  * instead.
   * @param entry The log entry.
-  * @param log_output The file pointer (typically stderr for screen output).
+  * @param index The sequence index to print with the entry.
+  * @param log_file The file to write to, or NULL for none.
+  * @param to_console Whether to write the entry to the console (stderr).
   */
- static void publish_log_entry(const LogEntry_T* entry, FILE* log_output) {
+ static void publish_log_entry(const LogEntry_T* entry, unsigned long long index, LogFile* log_file,
+                               bool to_console) {
      if (!entry || entry->message[0] == '\0') {
          stream_print(stderr, "Log Error: Attempted to log NULL or blank message\n");
          return;
@@ -237,53 +603,74 @@ void init_logger_mutex(void) {
      time_t rawtime;
      int64_t nanoseconds;
      platform_timestamp_to_calendar_time(&entry->timestamp, &rawtime, &nanoseconds);
- 
-     /* Format time using platform-independent function */
-     struct tm timeinfo;
-     platform_localtime(&rawtime, &timeinfo);
- 
-     /* Calculate fractional part */
-     int64_t adjusted_time = nanoseconds / (1000000000 / g_log_timestamp_granularity);
- 
-     /* Rest of the existing code remains the same */
-     int fractional_width = (int)log10((double)g_log_timestamp_granularity);
-     int index_width = (g_log_leading_zeros >= 0) ? g_log_leading_zeros : 12;
-     const char* log_colour = (log_output == stderr && g_log_use_ansi_colours) ? get_log_level_colour(entry->level) : "";
-     const char* reset_colour = (log_output == stderr && g_log_use_ansi_colours) ? "\x1b[0m" : "";
- 
-     char time_buffer[64];
-     strftime(time_buffer, sizeof(time_buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
- 
-     /* Print the log entry */
-     if (fractional_width > 0) {
-         char log_buffer[LOG_MSG_BUFFER_SIZE];
-         size_t written = snprintf(log_buffer, sizeof(log_buffer),
-             "%0*llu %s.%0*lld %s%s%s: [%s] %s\n",
-             index_width, entry->index,
-             time_buffer,
-             fractional_width, adjusted_time,
-             log_colour, log_level_to_string(entry->level), reset_colour,
-             entry->thread_label,
-             entry->message);
-         if (written > 0 && written < sizeof(log_buffer)) {
-             stream_print(log_output, "%s", log_buffer);
-         }
-     }
-     else {
-         char log_buffer[LOG_MSG_BUFFER_SIZE];
-         size_t written = snprintf(log_buffer, sizeof(log_buffer),
-             "%0*llu %s %s%s%s: [%s] %s\n",
-             index_width, entry->index,
-             time_buffer,
-             log_colour, log_level_to_string(entry->level), reset_colour,
-             entry->thread_label,
-             entry->message);
-         if (written > 0 && written < sizeof(log_buffer)) {
-             stream_print(log_output, "%s", log_buffer);
+
+     if (log_file && g_log_file_format != LOG_FILE_FORMAT_TEXT) {
+         if (g_log_file_format == LOG_FILE_FORMAT_BINARY) {
+             stage_binary_entry(log_file, entry, index, (uint64_t)rawtime * 1000000000ULL + (uint64_t)nanoseconds);
+         } else {
+             stage_json_entry(log_file, entry, index, rawtime, nanoseconds);
+         }
+         log_file = NULL;  // The text line is then only wanted for the console
+         if (!to_console) {
+             return;
+         }
+     }
+
+     /* index date time[.fraction] LEVEL: [label] message */
+     char line[LOG_LINE_BUFFER_SIZE];
+     size_t pos = format_decimal(line, index, g_log_leading_zeros >= 0 ? g_log_leading_zeros : 12);
+     line[pos++] = ' ';
+     pos += format_timestamp_seconds(rawtime, line + pos);
+     if (g_log_fraction_digits > 0) {
+         line[pos++] = '.';
+         pos += format_decimal(line + pos,
+                               (unsigned long long)(nanoseconds / (1000000000 / g_log_timestamp_granularity)),
+                               g_log_fraction_digits);
+     }
+     line[pos++] = ' ';
+
+     size_t level_start = pos;
+     const char* level_name = log_level_to_string(entry->level);
+     size_t level_length = strlen(level_name);
+     memcpy(line + pos, level_name, level_length);
+     pos += level_length;
+     size_t level_end = pos;
+
+     line[pos++] = ':';
+     line[pos++] = ' ';
+     line[pos++] = '[';
+     size_t label_length = strnlen(entry->thread_label, sizeof(entry->thread_label));
+     memcpy(line + pos, entry->thread_label, label_length);
+     pos += label_length;
+     line[pos++] = ']';
+     line[pos++] = ' ';
+
+     // Whatever the prefix took, always leave room for the newline
+     size_t message_length = strnlen(entry->message, sizeof(entry->message));
+     if (message_length > sizeof(line) - 1 - pos) {
+         message_length = sizeof(line) - 1 - pos;
+     }
+     memcpy(line + pos, entry->message, message_length);
+     pos += message_length;
+     line[pos++] = '\n';
+
+     if (log_file) {
+         stage_log_file_bytes(log_file, line, pos);
+     }
+
+     if (to_console) {
+         if (g_log_use_ansi_colours) {
+             const char* reset_colour = "\x1b[0m";
+             const char* log_colour = get_log_level_colour(entry->level);
+             stage_log_line(&console_staging, stderr, line, level_start);
+             stage_log_line(&console_staging, stderr, log_colour, strlen(log_colour));
+             stage_log_line(&console_staging, stderr, line + level_start, level_end - level_start);
+             stage_log_line(&console_staging, stderr, reset_colour, strlen(reset_colour));
+             stage_log_line(&console_staging, stderr, line + level_end, pos - level_end);
+         } else {
+             stage_log_line(&console_staging, stderr, line, pos);
          }
      }
- 
-     fflush(log_output);
  }
  
  
@@ -308,14 +695,16 @@ void init_logger_mutex(void) {
  /**
   * @brief Sets the log file for the current thread.
   * @param filename The log file name to set.
+  * @return The route id for entries from the thread, or APP_LOG_FILE_INDEX
+  *         if no more thread log files can be added.
   */
- void set_log_thread_file(const char *label, const char *filename) {
+ static uint16_t set_log_thread_file(const char *label, const char *filename) {
      lock_mutex(&logging_mutex); // Lock the mutex
 
      if (g_thread_log_file_count >= MAX_THREADS) {
          // Maximum number of threads reached
          unlock_mutex(&logging_mutex); // Unlock the mutex
-         return;
+         return APP_LOG_FILE_INDEX;
      }
 
      // Initialize thread label
@@ -341,13 +730,20 @@ void init_logger_mutex(void) {
          log_file->ref_count = 1;
      }
 
+     if (log_file == NULL) {
+         // No room for another log file, stay on the application log
+         unlock_mutex(&logging_mutex);
+         return APP_LOG_FILE_INDEX;
+     }
+
      // Link the ThreadLogFile to the LogFile
      thread_log_files[g_thread_log_file_count].log_file = log_file;
      thread_log_files[g_thread_log_file_count].first_open = false;
 
-     g_thread_log_file_count++;
+     uint16_t route = (uint16_t)g_thread_log_file_count++;
 
      unlock_mutex(&logging_mutex); // Unlock the mutex
+     return route;
 }
 
 static const char* find_parent_log_file(const char* thread_label) {
@@ -373,19 +769,59 @@ static const char* find_parent_log_file(const char* thread_label) {
     return log_file;
 }
 
+/**
+ * @brief Finds a label's level in [log_levels], trying the label itself and
+ *        then each parent as "PARENT.*".
+ */
+static const char* find_configured_log_level(const char* thread_label) {
+    const char* level = get_config_string(CONFIG_LOG_LEVELS_SECTION, thread_label, NULL);
+    char parent_label[THREAD_LABEL_SIZE];
+    char config_key[THREAD_LABEL_SIZE + 2];
+
+    snprintf(parent_label, sizeof(parent_label), "%s", thread_label);
+    char* last_dot;
+    while (!level && (last_dot = strrchr(parent_label, '.')) != NULL) {
+        *last_dot = '\0';
+        snprintf(config_key, sizeof(config_key), "%s.*", parent_label);
+        level = get_config_string(CONFIG_LOG_LEVELS_SECTION, config_key, NULL);
+    }
+    return level;
+}
+
+static LogLevelSlot* find_log_level_slot(const char* thread_label) {
+    for (int i = 1; i < g_log_level_slot_count; i++) {
+        if (strcmp(log_level_slots[i].label, thread_label) == 0) {
+            return &log_level_slots[i];
+        }
+    }
+    return NULL;
+}
+
+void set_thread_log_level_from_config(const char* thread_label) {
+    if (!thread_label) {
+        return;
+    }
+
+    lock_mutex(&logging_mutex);
+    LogLevelSlot* slot = find_log_level_slot(thread_label);
+    if (!slot && g_log_level_slot_count < (int)(sizeof(log_level_slots) / sizeof(log_level_slots[0]))) {
+        slot = &log_level_slots[g_log_level_slot_count++];
+        snprintf(slot->label, sizeof(slot->label), "%s", thread_label);
+        const char* configured = find_configured_log_level(thread_label);
+        slot->pinned = configured != NULL;
+        slot->level = (uint8_t)log_level_from_string(configured, (LogLevel)log_level_slots[0].level);
+    }
+    unlock_mutex(&logging_mutex);
+
+    // Threads sharing a label share a slot; past the table they follow the global level
+    g_thread_log_level = slot ? &slot->level : &log_level_slots[0].level;
+}
+
 void set_thread_log_file_from_config(const char* thread_label) {
     char file_config_key[MAX_PATH_LEN];
     const char* config_thread_log_file = NULL;
     const char* config_thread_log_path = get_config_string("logger", CONFIG_LOG_PATH_KEY, NULL);
 
-    /* Read log level from config */
-    const char* config_log_level = get_config_string("logger", "log_level", NULL);
-    g_log_level = log_level_from_string(config_log_level, g_log_level);
-
-#ifdef _DEBUG
-    g_trace_all = get_config_bool("debug", "trace_on", false);
-#endif
-
     // First try the full thread label
     snprintf(file_config_key, sizeof(file_config_key), "%s." CONFIG_LOG_FILE_KEY, thread_label);
     config_thread_log_file = get_config_string("logger", file_config_key, NULL);
@@ -401,10 +837,10 @@ void set_thread_log_file_from_config(const char* thread_label) {
             char full_log_file_name[MAX_PATH_LEN];
             construct_log_file_name(full_log_file_name, sizeof(full_log_file_name), 
                                   config_thread_log_path, config_thread_log_file);
-            set_log_thread_file(thread_label, full_log_file_name);
+            this_thread_route = set_log_thread_file(thread_label, full_log_file_name);
         }
         else {
-            set_log_thread_file(thread_label, config_thread_log_file);
+            this_thread_route = set_log_thread_file(thread_label, config_thread_log_file);
         }
     }
 }
@@ -453,12 +889,14 @@ void set_thread_log_file_from_config(const char* thread_label) {
      return false;
  }
 
+ static bool open_log_segment(LogFile *log_file);
+
  static bool open_log_file_if_needed(LogFile *log_file) {
      if (!log_file) {
          return false;
      }
 
-     if (log_file->fp != NULL) {
+     if (log_file->fp != NULL || log_file->mapping != NULL || log_file->writer != NULL) {
          return true;  // File already open
      }
 
@@ -471,22 +909,51 @@ void set_thread_log_file_from_config(const char* thread_label) {
      strip_directory_path(log_file->file_name, directory_path, sizeof(directory_path));
      create_log_directory(directory_path, &directory_creation_failure_count);
 
-     // Open file
-     char* mode = g_purge_logs_on_restart ? "w" : "a";
-     FILE* fp = NULL;
-     PlatformErrorCode err = platform_fopen(&fp, log_file->file_name, mode);
-     
-     if (err != PLATFORM_ERROR_SUCCESS || fp == NULL) {
-         log_file->fp = NULL;
-         return handle_open_failure(log_file->file_name, &log_failure_count);
-     }
+     if (g_log_mmap_segments) {
+         if (!open_log_segment(log_file)) {
+             return handle_open_failure(log_file->file_name, &log_failure_count);
+         }
+         log_file->bytes_written = 0;
+     } else if (g_log_async_writes) {
+         log_file->writer = platform_file_writer_open(log_file->file_name, g_purge_logs_on_restart,
+                                                      g_log_flush_bytes, g_log_async_write_buffers, NULL);
+         if (!log_file->writer) {
+             return handle_open_failure(log_file->file_name, &log_failure_count);
+         }
+         log_file->bytes_written = platform_file_writer_size(log_file->writer);
+         log_file->synced_bytes = log_file->bytes_written;
+     } else {
+         // Open file; binary files must not have their bytes translated
+         const char* mode = g_log_file_format == LOG_FILE_FORMAT_BINARY ?
+                            (g_purge_logs_on_restart ? "wb" : "ab") : (g_purge_logs_on_restart ? "w" : "a");
+         FILE* fp = NULL;
+         PlatformErrorCode err = platform_fopen(&fp, log_file->file_name, mode);
 
-     // Success path
-     log_file->fp = fp;
+         if (err != PLATFORM_ERROR_SUCCESS || fp == NULL) {
+             log_file->fp = NULL;
+             return handle_open_failure(log_file->file_name, &log_failure_count);
+         }
+
+         // Success path: staging does the buffering, so a flush is a single write
+         setvbuf(fp, NULL, _IONBF, 0);
+         log_file->fp = fp;
+
+         // Count from the current size; from here on writes are counted, not stat()ed
+         long size = 0;
+         if (!g_purge_logs_on_restart && fseek(fp, 0, SEEK_END) == 0) {
+             size = ftell(fp);
+         }
+         log_file->bytes_written = size > 0 ? (uint64_t)size : 0;
+     }
+     log_file->rotate_pending = log_file->bytes_written >= (uint64_t)g_log_file_size;
+     log_file->segment_pending = true;
      log_failure_count = 0;
 
      if (!log_file->first_open) {
          stream_print(stdout, "Successfully opened log file: %s\n", log_file->file_name);
+         if (log_file->writer && !platform_file_writer_is_async(log_file->writer)) {
+             stream_print(stdout, "io_uring unavailable, writing %s with blocking writes\n", log_file->file_name);
+         }
          log_file->first_open = true;
      }
 
@@ -522,36 +989,101 @@ static void generate_timestamp_suffix(char *buffer, size_t size) {
     strftime(buffer, size, ".%Y%m%d_%H%M%S", t);
 }
 
+/**
+ * @brief Whether a rotated file name is in use, either by a file not yet
+ *        compacted or by the one the compactor made of it.
+ */
+static bool rotated_log_filename_taken(const char* rotated_log_filename) {
+    struct stat file_status;
+    char compacted_filename[MAX_PATH_LEN];
+    if (stat(rotated_log_filename, &file_status) == 0) {
+        return true;
+    }
+    snprintf(compacted_filename, sizeof(compacted_filename), "%s" LOG_LZ_FILE_SUFFIX, rotated_log_filename);
+    return stat(compacted_filename, &file_status) == 0;
+}
+
+/**
+ * @brief Names the file a log file is rotated to, with the time inserted
+ *        before the extension.
+ *
+ * The time has 1 second resolution and segments can rotate faster than
+ * that, so a name already taken gets a counter after the time, _1, _2 and
+ * so on, rather than being renamed over.
+ */
 static void generate_rotated_log_filename(const char* original_filename, char* rotated_log_filename, size_t size) {
     char timestamp[32];
     generate_timestamp_suffix(timestamp, sizeof(timestamp));
     
     // Find the last dot in the original filename
     const char* last_dot = strrchr(original_filename, '.');
-    if (last_dot == NULL) {
-        // No extension - append timestamp at the end
-        snprintf(rotated_log_filename, size, "%s%s", original_filename, timestamp);
-    } else {
-        // Insert timestamp before the extension
-        size_t prefix_len = last_dot - original_filename;
-        snprintf(rotated_log_filename, size, "%.*s%s%s", 
-                (int)prefix_len, original_filename, 
-                timestamp, 
-                last_dot);
+    size_t prefix_len = last_dot != NULL ? (size_t)(last_dot - original_filename) : strlen(original_filename);
+    const char* extension = last_dot != NULL ? last_dot : "";
+
+    // Insert timestamp before the extension, if there is one
+    snprintf(rotated_log_filename, size, "%.*s%s%s", (int)prefix_len, original_filename, timestamp, extension);
+    for (unsigned counter = 1; rotated_log_filename_taken(rotated_log_filename) && counter < 10000; counter++) {
+        snprintf(rotated_log_filename, size, "%.*s%s_%u%s", (int)prefix_len, original_filename, timestamp,
+                 counter, extension);
     }
 }
 
  /**
-  * @brief Rotates the log file if it exceeds the configured size.
+  * @brief Maps a new, preallocated segment as a log file (mmap writer).
+  *
+  * A segment always starts empty, so anything already in the file is rotated
+  * aside first. The segment is mapped LOG_SEGMENT_RESERVE bytes longer than
+  * the rotation size so the entry that crosses it still fits.
+  */
+ static bool open_log_segment(LogFile *log_file) {
+     struct stat file_status;
+     if (!g_purge_logs_on_restart && stat(log_file->file_name, &file_status) == 0 && file_status.st_size > 0) {
+         char rotated_log_filename[MAX_PATH_LEN];
+         generate_rotated_log_filename(log_file->file_name, rotated_log_filename, sizeof(rotated_log_filename));
+         if (rename(log_file->file_name, rotated_log_filename) != 0) {
+             return handle_rename_failure(log_file->file_name, rotated_log_filename, errno);
+         }
+         log_compactor_submit(rotated_log_filename);
+     }
+
+     void* address = NULL;
+     uint64_t size = (uint64_t)g_log_file_size + LOG_SEGMENT_RESERVE;
+     PlatformFileMappingHandle mapping = platform_file_map_create(log_file->file_name, (size_t)size, &address, NULL);
+     if (!mapping) {
+         return false;
+     }
+     log_file->mapping = mapping;
+     log_file->segment = address;
+     log_file->segment_size = size;
+     log_file->synced_bytes = 0;
+     return true;
+ }
+
+ /**
+  * @brief Unmaps a log file's segment, cutting the file to the bytes written.
+  */
+ static void close_log_segment(LogFile *log_file) {
+     if (!platform_file_map_close_at(log_file->mapping, (size_t)log_file->bytes_written)) {
+         stream_print(stderr, "Failed to trim log file: %s\n", log_file->file_name);
+     }
+     log_file->mapping = NULL;
+     log_file->segment = NULL;
+     log_file->segment_size = 0;
+ }
+
+ /**
+  * @brief Rotates the log file if it has reached the configured size.
   */
  static bool rotate_log_file_if_needed(LogFile *log_file) {
-     struct stat st;
-     if (stat(log_file->file_name, &st) != 0 || st.st_size < g_log_file_size) {
+     if (!log_file->rotate_pending) {
          return true;  // No rotation needed
      }
+     // Cleared up front: on failure the next line written sets it again
+     log_file->rotate_pending = false;
 
-     // Close current file
+     // Close current file, after writing out what is staged for it
      if (log_file->fp != NULL) {
+         flush_staging(&log_file->staging, log_file->fp);
          if (fclose(log_file->fp) != 0) {
              stream_print(stderr, "Failed to close log file: %s (errno: %d)\n", 
                          log_file->file_name, errno);
@@ -560,6 +1092,16 @@ static void generate_rotated_log_filename(const char* original_filename, char* r
          }
          log_file->fp = NULL;
      }
+     if (log_file->mapping != NULL) {
+         close_log_segment(log_file);
+     }
+     if (log_file->writer != NULL) {
+         // Waits for the writes in flight, so the rename takes a complete file
+         if (platform_file_writer_close(log_file->writer) != PLATFORM_ERROR_SUCCESS) {
+             stream_print(stderr, "Failed to write log file: %s\n", log_file->file_name);
+         }
+         log_file->writer = NULL;
+     }
 
      // Generate new filename and rotate
      char rotated_log_filename[MAX_PATH_LEN];
@@ -571,19 +1113,108 @@ static void generate_rotated_log_filename(const char* original_filename, char* r
      if (rename(log_file->file_name, rotated_log_filename) != 0) {
          return handle_rename_failure(log_file->file_name, rotated_log_filename, errno);
      }
+     log_compactor_submit(rotated_log_filename);  // compressed in the background if enabled
 
      // Open new file
+     if (g_log_mmap_segments) {
+         if (!open_log_segment(log_file)) {
+             stream_print(stderr, "Failed to map new log file after rotation: %s\n",
+                         log_file->file_name);
+             return false;
+         }
+         log_file->bytes_written = 0;
+         log_file->segment_pending = true;
+         return true;
+     }
+     if (g_log_async_writes) {
+         log_file->writer = platform_file_writer_open(log_file->file_name, false, g_log_flush_bytes,
+                                                      g_log_async_write_buffers, NULL);
+         if (!log_file->writer) {
+             stream_print(stderr, "Failed to open new log file after rotation: %s\n",
+                         log_file->file_name);
+             return false;
+         }
+         log_file->bytes_written = 0;
+         log_file->synced_bytes = 0;
+         log_file->segment_pending = true;
+         return true;
+     }
      FILE* fp = NULL;
-     PlatformErrorCode err = platform_fopen(&fp, log_file->file_name, "a");
+     PlatformErrorCode err = platform_fopen(&fp, log_file->file_name,
+                                            g_log_file_format == LOG_FILE_FORMAT_BINARY ? "ab" : "a");
      if (err != PLATFORM_ERROR_SUCCESS || fp == NULL) {
          stream_print(stderr, "Failed to open new log file after rotation: %s\n", 
                      log_file->file_name);
          return false;
      }
 
+     setvbuf(fp, NULL, _IONBF, 0);
      log_file->fp = fp;
+     log_file->bytes_written = 0;
+     log_file->segment_pending = true;
      return true;
  }
+
+ /**
+  * @brief Housekeeping: rotates every log file that has reached the configured size.
+  *
+  * Runs after a flush rather than on the write path, so logging a line never
+  * waits on a rename. Caller holds the logging mutex.
+  */
+ static void rotate_pending_log_files(void) {
+     for (int i = 0; i < g_log_file_count; i++) {
+         if (log_files[i].rotate_pending) {
+             rotate_log_file_if_needed(&log_files[i]);
+         }
+     }
+ }
+
+ /**
+  * @brief Rolls a mapped log file over to a new segment now if the next entry might not fit.
+  *
+  * Housekeeping normally rotates a file soon after it reaches the rotation
+  * size; this covers a burst that fills the reserve before it runs.
+  * @return false if the file has no segment to write to.
+  */
+ static bool make_segment_room(LogFile *log_file) {
+     if (log_file->mapping && log_file->bytes_written + LOG_SEGMENT_RESERVE > log_file->segment_size) {
+         log_file->rotate_pending = true;
+         rotate_log_file_if_needed(log_file);
+     }
+     return log_file->mapping != NULL || log_file->fp != NULL || log_file->writer != NULL;
+ }
+
+ /**
+  * @brief Starts writing out what was copied into each mapped segment since the last sync.
+  *
+  * Does not wait for the disk. Caller holds the logging mutex.
+  */
+ static void sync_log_segments(void) {
+     for (int i = 0; i < g_log_file_count; i++) {
+         LogFile *log_file = &log_files[i];
+         if (log_file->mapping && log_file->bytes_written > log_file->synced_bytes) {
+             platform_file_map_sync(log_file->mapping, (size_t)log_file->synced_bytes,
+                                    (size_t)(log_file->bytes_written - log_file->synced_bytes));
+             log_file->synced_bytes = log_file->bytes_written;
+         }
+     }
+ }
+
+ /**
+  * @brief Hands each async written file what is buffered, with an fsync linked
+  * after it, if anything was written since the last sync.
+  *
+  * Does not wait for the disk. Caller holds the logging mutex.
+  */
+ static void sync_log_writers(void) {
+     for (int i = 0; i < g_log_file_count; i++) {
+         LogFile *log_file = &log_files[i];
+         if (log_file->writer && log_file->bytes_written != log_file->synced_bytes) {
+             platform_file_writer_flush(log_file->writer, true);
+             log_file->synced_bytes = log_file->bytes_written;
+         }
+     }
+ }
  
  /**
   * @brief Convert a log destination string to the corresponding LogOutput enum.
@@ -618,8 +1249,34 @@ static void generate_rotated_log_filename(const char* original_filename, char* r
      /* Return the default output if the string is unrecognized */
      return default_output;
  }
+
+ /**
+  * @brief Convert an overflow policy string to the corresponding LogOverflowPolicy enum.
+  * @param policy_str The string naming the policy.
+  * @param default_policy The policy to use if the string is invalid.
+  * @return The corresponding LogOverflowPolicy value.
+  */
+ static LogOverflowPolicy log_overflow_policy_from_string(const char* policy_str, LogOverflowPolicy default_policy) {
+     if (!policy_str) return default_policy;
+
+     if (strcmp_nocase(policy_str, "block") == 0) return LOG_OVERFLOW_BLOCK;
+     if (strcmp_nocase(policy_str, "drop_newest") == 0) return LOG_OVERFLOW_DROP_NEWEST;
+     if (strcmp_nocase(policy_str, "drop_oldest_lockfree") == 0 ||
+         strcmp_nocase(policy_str, "drop_oldest") == 0) {
+         return LOG_OVERFLOW_DROP_OLDEST;
+     }
+     if (strcmp_nocase(policy_str, "spill_to_disk") == 0) return LOG_OVERFLOW_SPILL_TO_DISK;
+
+     return default_policy;
+ }
  
  
+static unsigned long long safe_increment_index(void) {
+     static PlatformAtomicUInt64 log_index = {0};
+     // Use new platform-agnostic atomic fetch-and-add
+     return platform_atomic_fetch_add_uint64(&log_index, 1) + 1;
+ }
+ 
  /**
   * @brief Logs a message immediately to file and console.
   * @param level The log level of the message.
@@ -627,6 +1284,19 @@ static void generate_rotated_log_filename(const char* original_filename, char* r
   */
 void log_immediately(const LogEntry_T* entry) {
     // mutex will have been aquired by the caller
+     /* Render deferred entries; their message holds packed arguments */
+     LogEntry_T rendered;
+     if (entry && entry->site) {
+         rendered.level = entry->level;
+         rendered.timestamp = entry->timestamp;
+         rendered.site = NULL;
+         rendered.route = entry->route;
+         memcpy(rendered.thread_label, entry->thread_label, sizeof(rendered.thread_label));
+         log_format_render(entry->site, entry->message, rendered.message, sizeof(rendered.message));
+         rendered.message_length = (uint16_t)strlen(rendered.message);
+         entry = &rendered;
+     }
+
      if (!entry || entry->message[0] == '\0') {
          char error_buffer[LOG_MSG_BUFFER_SIZE];
          size_t written = (size_t)snprintf(error_buffer, sizeof(error_buffer), 
@@ -649,43 +1319,32 @@ void log_immediately(const LogEntry_T* entry) {
          can_log_to_file = false;
          current_output = LOG_OUTPUT_SCREEN;  // Temporary fallback to screen logging
      } else {
-         /* Rotate & open the main log file if needed */
-         if (tlf->log_file->fp) {
-             if (!rotate_log_file_if_needed(tlf->log_file)) {
-                 can_log_to_file = false;
-                 current_output = LOG_OUTPUT_SCREEN;  // Fallback to screen logging
-             }
-         }
+         /* Open the main log file if needed; rotation is left to housekeeping */
          if (!open_log_file_if_needed(tlf->log_file)) {
              can_log_to_file = false;
              current_output = LOG_OUTPUT_SCREEN;  // Fallback to screen logging
          }
 
-         /* Check if the current thread has a specific log file */
-         for (int i = 1; i < g_thread_log_file_count; i++) {
-             if (thread_label && strcmp_nocase(thread_log_files[i].thread_label, thread_label) == 0) {
-                 if (thread_log_files[i].log_file->fp) {
-                     if (!rotate_log_file_if_needed(thread_log_files[i].log_file)) {
-                         stream_print(stderr, "File Error: Could not rotate log file for thread %s\n", thread_label);
-                     }
-                 }
-                 if (!open_log_file_if_needed(thread_log_files[i].log_file)) {
-                     stream_print(stderr, "File Error: Could not open log file for thread %s\n", thread_label);
-                 }
-                 tlf = &thread_log_files[i];
-                 break;
+         /* The entry's route was resolved when its thread registered a log file */
+         if (entry->route != APP_LOG_FILE_INDEX && entry->route < g_thread_log_file_count) {
+             ThreadLogFile* route_tlf = &thread_log_files[entry->route];
+             if (!open_log_file_if_needed(route_tlf->log_file)) {
+                 stream_print(stderr, "File Error: Could not open log file for thread %s\n", thread_label);
              }
+             tlf = route_tlf;
          }
      }
 
-     /* Log to file if enabled and filename is valid */
-     if (can_log_to_file && (current_output == LOG_OUTPUT_FILE || current_output == LOG_OUTPUT_BOTH)) {
-         publish_log_entry(entry, tlf->log_file->fp);
-     }
+     /* Callers hold the logging mutex, so indices follow output order */
+     unsigned long long index = safe_increment_index();
 
-     /* Log to screen if enabled */
-     if (!console_logging_suspended && (current_output == LOG_OUTPUT_SCREEN || current_output == LOG_OUTPUT_BOTH)) {
-         publish_log_entry(entry, stderr);
+     /* Log to file if enabled and filename is valid, and to screen if enabled */
+     bool to_file = can_log_to_file && (current_output == LOG_OUTPUT_FILE || current_output == LOG_OUTPUT_BOTH) &&
+                    make_segment_room(tlf->log_file);
+     bool to_console = !console_logging_suspended &&
+                       (current_output == LOG_OUTPUT_SCREEN || current_output == LOG_OUTPUT_BOTH);
+     if (to_file || to_console) {
+         publish_log_entry(entry, index, to_file ? tlf->log_file : NULL, to_console);
      }
  }
  
@@ -696,58 +1355,204 @@ void log_immediately(const LogEntry_T* entry) {
  void log_now(const LogEntry_T *entry) {
      lock_mutex(&logging_mutex);
      log_immediately(entry);
+     // Lines from the logger thread go out with its next batch, anyone else's now
+     if (!is_logger_thread) {
+         flush_log_output();
+         rotate_pending_log_files();
+     }
      unlock_mutex(&logging_mutex);
  }
  
- unsigned long long safe_increment_index(void) {
-     static PlatformAtomicUInt64 log_index = {0};
-     // Use new platform-agnostic atomic fetch-and-add
-     return platform_atomic_fetch_add_uint64(&log_index, 1) + 1;
- }
- 
- void create_log_entry(LogEntry_T* entry, LogLevel level, const char* message) {
+ /**
+  * @brief Fills in everything but the message of a log entry for the calling thread.
+  */
+ static void init_log_entry_header(LogEntry_T* entry, LogLevel level) {
      const char* this_thread_label = get_thread_label();
      const char* name = this_thread_label ? this_thread_label : "UNKNOWN";
 
-     entry->index = safe_increment_index();
      // Use platform-agnostic timestamp function
      platform_get_high_res_timestamp(&entry->timestamp);
      entry->level = level;
-     
-     // Initialize strings to empty first
+     entry->site = NULL;
+     entry->route = this_thread_route;
+
      entry->thread_label[0] = '\0';
-     entry->message[0] = '\0';
-     
-     // Copy the thread label and message safely using platform_strcat
      platform_strcat(entry->thread_label, name, sizeof(entry->thread_label));
+ }
+
+ void create_log_entry(LogEntry_T* entry, LogLevel level, const char* message) {
+     init_log_entry_header(entry, level);
+
+     // Copy the message safely using platform_strcat
+     entry->message[0] = '\0';
      platform_strcat(entry->message, message, sizeof(entry->message));
+     entry->message_length = (uint16_t)strlen(entry->message);
  }
- 
- 
+
+ /**
+  * @brief Hands an entry to the logger thread, or logs it directly if that is not possible.
+  */
+ static void submit_log_entry(const LogEntry_T* entry) {
+     // Recorded before queueing, so it is kept even if the logger thread never gets to it
+     log_flight_record(entry);
+
+     if (logging_thread_started && !is_logger_thread) {
+         // Queue the entry, or apply the overflow policy; only once the logger has gone log it here
+         if (!log_queue_submit(log_queue_for_thread(), entry)) {
+             log_now(entry);
+         }
+     } else {
+         log_now(entry);
+     }
+ }
+
+ /**
+  * @brief Formats a message on the calling thread and submits it.
+  */
+ static void log_formatted(LogLevel level, const char* format, va_list args) {
+     LogEntry_T entry;
+     init_log_entry_header(&entry, level);
+
+     int written = vsnprintf(entry.message, sizeof(entry.message), format, args);
+     if (written < 0) {
+         written = 0;
+         entry.message[0] = '\0';
+     } else if (written >= (int)sizeof(entry.message)) {
+         written = sizeof(entry.message) - 1;
+     }
+     entry.message_length = (uint16_t)written;
+     submit_log_entry(&entry);
+ }
+
  void _logger_log(LogLevel level, const char* format, ...) {
-     if (level < g_log_level) {
+     if (!logger_level_enabled(level)) {
          return;
      }
- 
+
      va_list args;
      va_start(args, format);
- 
-     // Format the log message
-     char log_buffer[LOG_MSG_BUFFER_SIZE];
-     vsnprintf(log_buffer, sizeof(log_buffer), format, args);
+     log_formatted(level, format, args);
      va_end(args);
- 
-     LogEntry_T entry;
-     create_log_entry(&entry, level, log_buffer);
- 
-     if (logging_thread_started) {
-         // Push the log message to the queue; if full, log immediately
-         if (!log_queue_push(&global_log_queue, &entry)) {
-             log_now(&entry);
+ }
+
+/**
+ * @brief Applies a call site's rate limit; lock-free, any thread.
+ *
+ * Each interval admits the site's first rate_limit entries. The first one
+ * withheld puts the site on the suppressed_sites list for the logger thread
+ * to report.
+ * @return true if the entry may be logged.
+ */
+static bool log_site_admit(LogCallSite_T* site, LogLevel level, const char* format) {
+    uint32_t limit = site->rate_limit ? site->rate_limit : g_log_rate_limit;
+    if (limit == 0) {
+        return true;
+    }
+    uint32_t interval_ms = site->rate_interval_ms ? site->rate_interval_ms : g_log_rate_interval_ms;
+
+    // One caller starts each new interval; the count it clears may miss a racing entry or two
+    uint32_t now = get_time_ms();
+    uint32_t window_start = platform_atomic_load_uint32(&site->window_start_ms);
+    if (now - window_start >= interval_ms &&
+        platform_atomic_compare_exchange_uint32(&site->window_start_ms, &window_start, now)) {
+        platform_atomic_store_uint32(&site->window_count, 0);
+    }
+    if (platform_atomic_fetch_add_uint32(&site->window_count, 1) < limit) {
+        return true;
+    }
+
+    if (platform_atomic_fetch_add_uint32(&site->suppressed, 1) == 0) {
+        // Only this caller writes these until the logger thread has reported them
+        site->suppressed_format = format;
+        site->suppressed_level = (uint8_t)level;
+        site->suppressed_route = this_thread_route;
+        const char* label = get_thread_label();
+        snprintf(site->suppressed_label, sizeof(site->suppressed_label), "%s", label ? label : "UNKNOWN");
+        void* head = platform_atomic_load_ptr(&suppressed_sites);
+        do {
+            site->next_suppressed = head;
+        } while (!platform_atomic_compare_exchange_ptr(&suppressed_sites, &head, site));
+    }
+    return false;
+}
+
+/**
+ * @brief Writes one line for each call site that withheld entries, once its
+ * interval is over. Logger thread only, with the logging mutex held.
+ * @param all Report every site now, as at shutdown.
+ */
+static void report_suppressed_entries(bool all) {
+    LogCallSite_T* site = platform_atomic_exchange_ptr(&suppressed_sites, NULL);
+    uint32_t now = get_time_ms();
+
+    while (site) {
+        // Read the link first: once the count is cleared a caller may list the site again
+        LogCallSite_T* next = site->next_suppressed;
+        uint32_t interval_ms = site->rate_interval_ms ? site->rate_interval_ms : g_log_rate_interval_ms;
+        if (all || now - platform_atomic_load_uint32(&site->window_start_ms) >= interval_ms) {
+            // Copied while the count is still non-zero: once it is cleared the
+            // next entry withheld rewrites these fields
+            LogLevel level = (LogLevel)site->suppressed_level;
+            const char* format = site->suppressed_format;
+            uint16_t route = site->suppressed_route;
+            char label[THREAD_LABEL_SIZE];
+            snprintf(label, sizeof(label), "%s", site->suppressed_label);
+            uint32_t suppressed = platform_atomic_exchange_uint32(&site->suppressed, 0);
+
+            char message[LOG_MSG_BUFFER_SIZE];
+            snprintf(message, sizeof(message), "Suppressed %u repeats of \"%s\"", suppressed, format);
+            log_metrics_note_suppressed(suppressed);
+            // Goes out as the withheld entries would have: under their thread's label, to its log file
+            LogEntry_T entry;
+            create_log_entry(&entry, level, message);
+            entry.route = route;
+            snprintf(entry.thread_label, sizeof(entry.thread_label), "%s", label);
+            log_immediately(&entry);
+        } else {
+            // Still within its interval; keep it listed
+            void* head = platform_atomic_load_ptr(&suppressed_sites);
+            do {
+                site->next_suppressed = head;
+            } while (!platform_atomic_compare_exchange_ptr(&suppressed_sites, &head, site));
+        }
+        site = next;
+    }
+}
+
+ void _logger_log_site(LogCallSite_T* site, LogLevel level, const char* format, ...) {
+     // logger_log has already checked; this covers direct callers
+     if (!logger_level_enabled(level) || !log_site_admit(site, level, format)) {
+         return;
+     }
+
+     va_list args;
+     va_start(args, format);
+
+     // Deferring only pays off when the logger thread does the formatting
+     if (g_log_deferred_formatting && logging_thread_started && !is_logger_thread &&
+         log_format_prepare_site(site, format)) {
+         LogEntry_T entry;
+         init_log_entry_header(&entry, level);
+
+         va_list pack_args;
+         va_copy(pack_args, args);
+         size_t packed_size = 0;
+         // Leave room for the terminator the queue adds when the entry is popped
+         bool packed = log_format_pack_args(site, entry.message, sizeof(entry.message) - 1, pack_args,
+                                            &packed_size);
+         va_end(pack_args);
+
+         if (packed) {
+             entry.site = site;
+             entry.message_length = (uint16_t)packed_size;
+             submit_log_entry(&entry);
+             va_end(args);
+             return;
          }
-     } else {
-         log_now(&entry);
      }
+
+     log_formatted(level, format, args);
+     va_end(args);
  }
  
  /**
@@ -763,6 +1568,13 @@ void log_immediately(const LogEntry_T* entry) {
 
      g_purge_logs_on_restart = get_config_bool("logger", "purge_logs_on_restart", g_purge_logs_on_restart);
 
+     /* Read the global log level; [log_levels] is read as each thread registers */
+     log_level_slots[0].level = (uint8_t)log_level_from_string(get_config_string("logger", "log_level", NULL),
+                                                               (LogLevel)log_level_slots[0].level);
+#ifdef _DEBUG
+     g_trace_all = get_config_bool("debug", "trace_on", false);
+#endif
+
      /* Read log destination */
      const char* config_log_destination = get_config_string("logger", "log_destination", NULL);
      g_log_output = log_output_from_string(config_log_destination, LOG_OUTPUT_SCREEN);
@@ -770,6 +1582,79 @@ void log_immediately(const LogEntry_T* entry) {
      /* Read timestamp granularity */
      const char* config_timestamp_granularity = get_config_string("logger", "timestamp_granularity", NULL);
      g_log_timestamp_granularity = timestamp_granularity_from_string(config_timestamp_granularity, LOG_TS_NANOSECOND);
+     g_log_fraction_digits = 0;
+     for (int units = g_log_timestamp_granularity; units > 1; units /= 10) {
+         g_log_fraction_digits++;
+     }
+
+     /* Read deferred formatting setting */
+     g_log_deferred_formatting = get_config_bool("logger", "deferred_formatting", g_log_deferred_formatting);
+
+     /* Read output batching settings */
+     g_log_flush_interval_ms = (uint32_t)get_config_int("logger", "flush_interval_ms", (int)g_log_flush_interval_ms);
+     g_log_flush_bytes = (size_t)get_config_int("logger", "flush_bytes", (int)g_log_flush_bytes);
+
+     /* Read idle wait setting */
+     g_log_park_when_idle = get_config_bool("logger", "park_when_idle", g_log_park_when_idle);
+
+     /* Read queue overflow settings */
+     g_log_overflow_policy = log_overflow_policy_from_string(
+         get_config_string("logger", "overflow_policy", NULL), g_log_overflow_policy);
+     const char* config_spill_file = get_config_string("logger", "spill_file_name", NULL);
+     if (config_spill_file) {
+         g_log_spill_file_name[0] = '\0';
+         platform_strcat(g_log_spill_file_name, config_spill_file, sizeof(g_log_spill_file_name));
+     }
+     g_log_spill_size = (uint64_t)get_config_int("logger", "spill_size", (int)g_log_spill_size);
+
+     /* Read the per call site rate limit */
+     g_log_rate_limit = (uint32_t)get_config_int("logger", "rate_limit", (int)g_log_rate_limit);
+     g_log_rate_interval_ms = (uint32_t)get_config_int("logger", "rate_limit_interval_ms",
+                                                       (int)g_log_rate_interval_ms);
+     if (g_log_rate_interval_ms == 0) {
+         g_log_rate_interval_ms = 1000;
+     }
+
+     /* Read whether to collect pipeline metrics */
+     g_log_metrics_enabled = get_config_bool("logger", "metrics", g_log_metrics_enabled);
+
+     /* Start the flight recorder */
+     if (get_config_bool("logger", "flight_recorder", false)) {
+         const char* flight_file = get_config_string("logger", "flight_recorder_file", "ether_recorder.flight");
+         int flight_records = get_config_int("logger", "flight_recorder_records", 4096);
+         char flight_directory[MAX_PATH_LEN];
+         strip_directory_path(flight_file, flight_directory, sizeof(flight_directory));
+         if (flight_directory[0] != '\0') {
+             create_directories(flight_directory);
+         }
+         if (flight_records <= 0 || !log_flight_open(flight_file, (uint32_t)flight_records)) {
+             stream_print(stderr, "Failed to start the flight recorder in %s\n", flight_file);
+         }
+     }
+
+     /* Read log file format */
+     const char* config_file_format = get_config_string("logger", "log_file_format", NULL);
+     if (config_file_format) {
+         if (strcmp_nocase(config_file_format, "binary") == 0) {
+             g_log_file_format = LOG_FILE_FORMAT_BINARY;
+         } else if (strcmp_nocase(config_file_format, "json") == 0) {
+             g_log_file_format = LOG_FILE_FORMAT_JSON;
+         } else {
+             g_log_file_format = LOG_FILE_FORMAT_TEXT;
+         }
+     }
+
+     /* Read mmap writer settings */
+     g_log_mmap_segments = get_config_bool("logger", "mmap_segments", g_log_mmap_segments);
+     g_log_mmap_sync_interval_ms = (uint32_t)get_config_int("logger", "mmap_sync_interval_ms",
+                                                            (int)g_log_mmap_sync_interval_ms);
+
+     /* Read async writer settings; mmap_segments takes precedence */
+     g_log_async_writes = get_config_bool("logger", "async_writes", g_log_async_writes) && !g_log_mmap_segments;
+     int config_write_buffers = get_config_int("logger", "async_write_buffers", (int)g_log_async_write_buffers);
+     g_log_async_write_buffers = config_write_buffers > 0 ? (unsigned)config_write_buffers : 1;
+     g_log_async_sync_interval_ms = (uint32_t)get_config_int("logger", "async_sync_interval_ms",
+                                                             (int)g_log_async_sync_interval_ms);
 
      /* Read ANSI colour setting */
      g_log_use_ansi_colours = get_config_bool("logger", "ansi_colours", g_log_use_ansi_colours);
@@ -822,8 +1707,33 @@ void log_immediately(const LogEntry_T* entry) {
          thread_log_files[APP_LOG_FILE_INDEX].thread_label[0] = '\0';  // Main log has no specific thread
      }
 
-     /* Initialize log queue */
-     log_queue_init(&global_log_queue);
+     /* The spill file sits with the logs and must exist before any queue is used */
+     if (g_log_overflow_policy == LOG_OVERFLOW_SPILL_TO_DISK) {
+         char spill_file[MAX_PATH_LEN];
+         construct_log_file_name(spill_file, sizeof(spill_file), config_log_file_path, g_log_spill_file_name);
+         if (*config_log_file_path) {
+             create_directories(config_log_file_path);
+         }
+         // The ring size must be a power of two
+         while (g_log_spill_size & (g_log_spill_size - 1)) {
+             g_log_spill_size &= g_log_spill_size - 1;
+         }
+         if (!log_queue_set_overflow_policy(g_log_overflow_policy, spill_file, g_log_spill_size)) {
+             stream_print(stderr, "Failed to create log spill file %s, overflowing entries will be dropped\n",
+                          spill_file);
+         }
+     } else {
+         log_queue_set_overflow_policy(g_log_overflow_policy, NULL, 0);
+     }
+
+     /* Initialize the shared log queue; threads add their own as they start */
+     if (!log_queue_init(&global_log_queue, LOG_QUEUE_SIZE, false)) {
+         snprintf(logger_init_result, LOG_MSG_BUFFER_SIZE, "Failed to allocate the log queue");
+         return false;
+     }
+     if (g_log_park_when_idle && !log_queue_init_wakeup()) {
+         g_log_park_when_idle = false;  // No event to park on, keep polling
+     }
 
      /* Start logging thread regardless of success */
      logging_thread_started = true;
@@ -843,11 +1753,50 @@ void log_immediately(const LogEntry_T* entry) {
  
  
  /**
-  * @brief Sets the log level.
+  * @brief Sets the global log level, and that of every label without one of its own.
   * @param level The log level to set.
   */
  void logger_set_level(LogLevel level) {
-     g_log_level = level;
+     lock_mutex(&logging_mutex);
+     log_level_slots[0].level = (uint8_t)level;
+     for (int i = 1; i < g_log_level_slot_count; i++) {
+         if (!log_level_slots[i].pinned) {
+             log_level_slots[i].level = (uint8_t)level;
+         }
+     }
+     unlock_mutex(&logging_mutex);
+ }
+
+ /**
+  * @copydoc logger_set_thread_level
+  */
+ int logger_set_thread_level(const char* label_pattern, LogLevel level) {
+     if (!label_pattern) {
+         return 0;
+     }
+
+     // "CLIENT.*" matches every label under CLIENT, anything else one label exactly
+     size_t pattern_length = strlen(label_pattern);
+     size_t prefix_length = pattern_length;
+     if (pattern_length >= 2 && strcmp(label_pattern + pattern_length - 2, ".*") == 0) {
+         prefix_length = pattern_length - 1;  // keep the dot
+     }
+
+     int matched = 0;
+     lock_mutex(&logging_mutex);
+     for (int i = 1; i < g_log_level_slot_count; i++) {
+         LogLevelSlot* slot = &log_level_slots[i];
+         bool match = prefix_length == pattern_length ?
+                      strcmp_nocase(slot->label, label_pattern) == 0 :
+                      strncmp_nocase(slot->label, label_pattern, prefix_length) == 0;
+         if (match) {
+             slot->pinned = true;
+             slot->level = (uint8_t)level;
+             matched++;
+         }
+     }
+     unlock_mutex(&logging_mutex);
+     return matched;
  }
  
  /**
@@ -863,12 +1812,23 @@ void log_immediately(const LogEntry_T* entry) {
   */
  void logger_close(void) {
      lock_mutex(&logging_mutex);
+     log_flight_close();
+     flush_log_output();
      // Close all unique log files
      for (int i = 0; i < g_log_file_count; i++) {
          if (log_files[i].fp) {
              fclose(log_files[i].fp);
              log_files[i].fp = NULL;
          }
+         if (log_files[i].mapping) {
+             close_log_segment(&log_files[i]);
+         }
+         if (log_files[i].writer) {
+             platform_file_writer_close(log_files[i].writer);
+             log_files[i].writer = NULL;
+         }
+         free(log_files[i].staging.data);
+         log_files[i].staging = (LogStaging){0};
      }
      g_log_file_count = 0;
      g_thread_log_file_count = 0;  // Reset thread counter for completeness
@@ -882,36 +1842,182 @@ void log_immediately(const LogEntry_T* entry) {
  }
  
  LogLevel logger_get_level(void) {
-     return g_log_level;
+     return (LogLevel)log_level_slots[0].level;
  }
  
  const char* get_level_name(LogLevel level) {
      return log_level_to_string(level);
  }
 
+/**
+ * @brief Writes one line summarising the entries dropped by the overflow policy
+ * since the last report. Logger thread only, with the logging mutex held.
+ */
+static void report_dropped_entries(void) {
+    uint64_t counts[LOG_QUEUE_LEVELS];
+    uint64_t total = log_queue_take_dropped(counts);
+    if (total == 0) {
+        return;
+    }
+    log_metrics_note_dropped(counts);
+
+    char message[LOG_MSG_BUFFER_SIZE];
+    int pos = snprintf(message, sizeof(message), "Log queue overflow: dropped %llu entries (",
+                       (unsigned long long)total);
+    const char* separator = "";
+    for (int level = 0; level < LOG_QUEUE_LEVELS && pos < (int)sizeof(message); level++) {
+        if (counts[level] == 0) {
+            continue;
+        }
+        const char* name = log_level_to_string((LogLevel)level);
+        int name_length = (int)strlen(name);
+        while (name_length > 0 && name[name_length - 1] == ' ') {
+            name_length--;
+        }
+        pos += snprintf(message + pos, sizeof(message) - (size_t)pos, "%s%.*s %llu",
+                        separator, name_length, name, (unsigned long long)counts[level]);
+        separator = ", ";
+    }
+    if (pos < (int)sizeof(message)) {
+        snprintf(message + pos, sizeof(message) - (size_t)pos, ")");
+    }
+
+    LogEntry_T entry;
+    create_log_entry(&entry, LOG_WARN, message);
+    log_immediately(&entry);
+}
+
+/**
+ * @brief Writes one line of the metrics report to the log.
+ */
+static void emit_log_metrics_line(const char* line) {
+    LogEntry_T entry;
+    create_log_entry(&entry, LOG_INFO, line);
+    log_immediately(&entry);
+}
+
+/**
+ * @brief Writes the pipeline metrics report, then the bytes written to each
+ * log file. Logger thread only, with the logging mutex held.
+ */
+static void report_log_metrics(void) {
+    LogQueueStats_T queues;
+    log_queue_collect_stats(&queues);
+    log_metrics_report(&queues, emit_log_metrics_line);
+
+    for (int i = 0; i < g_log_file_count; i++) {
+        char message[LOG_MSG_BUFFER_SIZE];
+        snprintf(message, sizeof(message), "Log metrics: %llu bytes written to %s",
+                 (unsigned long long)log_files[i].total_bytes, log_files[i].file_name);
+        emit_log_metrics_line(message);
+    }
+}
+
+/**
+ * @brief Publishes up to one batch of queued entries under a single hold of the
+ * logging mutex, then writes out the staging buffers if the flush interval has passed.
+ * @return The number of entries published.
+ */
+static int drain_log_batch(uint32_t* last_flush_ms) {
+    static uint32_t last_sync_ms = 0;
+    static uint32_t last_writer_sync_ms = 0;
+    LogEntry_T entry;
+    int published = 0;
+
+    lock_mutex(&logging_mutex);
+    while (published < LOG_DRAIN_BATCH && log_queue_pop_merged(&entry)) {
+        if (*entry.thread_label == '\0')
+           printf("Logger thread processing log from: NULL\n");
+        log_immediately(&entry);
+        published++;
+    }
+    if (g_log_metrics_enabled) {
+        log_metrics_note_drain((uint32_t)published, log_queue_last_fill());
+    }
+
+    uint32_t now = get_time_ms();
+    if (now - *last_flush_ms >= g_log_flush_interval_ms) {
+        report_dropped_entries();
+        report_suppressed_entries(false);
+        if (log_metrics_take_report_request()) {
+            report_log_metrics();
+        }
+        flush_log_output();
+        rotate_pending_log_files();
+        *last_flush_ms = now;
+    }
+    if (g_log_mmap_segments && now - last_sync_ms >= g_log_mmap_sync_interval_ms) {
+        sync_log_segments();
+        last_sync_ms = now;
+    }
+    if (g_log_async_writes && g_log_async_sync_interval_ms > 0 &&
+        now - last_writer_sync_ms >= g_log_async_sync_interval_ms) {
+        sync_log_writers();
+        last_writer_sync_ms = now;
+    }
+    unlock_mutex(&logging_mutex);
+
+    return published;
+}
+
 static void* logger_thread_function(void* arg) {
     // printf("Logger thread started\n");
     (void)arg;
+    is_logger_thread = true;
     logger_log(LOG_INFO, "Logger thread started");
 
     // No more condition/flag needed - thread registry state is enough
-    LogEntry_T entry;
+    uint32_t last_flush_ms = get_time_ms();
  
+    uint32_t idle_polls = 0;
     while (!shutdown_signalled()) {
-        while (log_queue_pop(&global_log_queue, &entry)) {
-            if (*entry.thread_label == '\0')
-               printf("Logger thread processing log from: NULL\n");
-            log_now(&entry);
+        if (drain_log_batch(&last_flush_ms) > 0) {
+            idle_polls = 0;
+            continue;
+        }
+
+        // Spin, then yield, so a burst that resumes quickly is picked up at once
+        idle_polls++;
+        if (!g_log_park_when_idle || idle_polls <= LOG_IDLE_SPIN_POLLS) {
+            continue;
         }
-        // sleep_ms(1);
+        if (idle_polls <= LOG_IDLE_SPIN_POLLS + LOG_IDLE_YIELD_POLLS) {
+            platform_thread_yield();
+            continue;
+        }
+
+        // Nothing is coming: write out what is staged and sleep until a push
+        lock_mutex(&logging_mutex);
+        flush_log_output();
+        rotate_pending_log_files();
+        sync_log_segments();
+        unlock_mutex(&logging_mutex);
+        last_flush_ms = get_time_ms();
+        log_queue_park(LOG_PARK_TIMEOUT_MS);
+        idle_polls = 0;
     }
 
     PlatformWaitResult wait_result = thread_registry_wait_others();
     if (wait_result != PLATFORM_WAIT_SUCCESS) {
         logger_log(LOG_WARN, "Logger thread failed to wait for other threads: %d", wait_result);
     }
+
+    // From here on stragglers log directly; publish what was queued before that
+    log_queue_close_consumer();
+    while (drain_log_batch(&last_flush_ms) > 0) {
+    }
+    lock_mutex(&logging_mutex);
+    report_dropped_entries();
+    report_suppressed_entries(true);
+    if (g_log_metrics_enabled) {
+        report_log_metrics();
+    }
+    unlock_mutex(&logging_mutex);
     
     logger_log(LOG_INFO, "Logger thread shutting down.");
+    lock_mutex(&logging_mutex);
+    flush_log_output();
+    unlock_mutex(&logging_mutex);
     stream_print(stdout, "Logger thread bye bye.\n");
     return (void*)THREAD_SUCCESS;
 }
@@ -16,6 +16,7 @@
 #include "thread_registry.h"
 #include "shutdown_handler.h"
 #include "message_types.h"
+#include "payload_pool.h"
 #include "version_info.h"
 
 #define MAX_PATH_LEN 256
@@ -101,6 +102,17 @@ static PlatformErrorCode init_app(void) {
         return PLATFORM_ERROR_THREAD_CREATE;
     }
 
+    // Buffers relayed reads are received into, and those that hold the
+    // queues' byte budgets while the reads wait to be sent
+    int payload_buffers = get_config_int("network", "payload_buffers", 256);
+    uint32_t buffers = payload_buffers > 0 ? (uint32_t)payload_buffers : 0;
+    uint32_t queue_buffers = thread_registry_queue_payload_buffers();
+    buffers = queue_buffers < UINT32_MAX - buffers ? buffers + queue_buffers : UINT32_MAX;
+    if (!payload_pool_init(buffers)) {
+        logger_log(LOG_ERROR, "Failed to allocate %u payload buffers", buffers);
+        return PLATFORM_ERROR_MEMORY_ALLOC;
+    }
+
     // Initialize thread management
     ThreadRegistryError thread_result = register_main_thread();
     if (thread_result != THREAD_REG_SUCCESS) {
@@ -129,6 +141,7 @@ static PlatformErrorCode cleanup_app(void) {
     
     // Clean up in reverse order of initialization
     app_thread_cleanup();
+    payload_pool_cleanup();
     platform_socket_cleanup();
     cleanup_shutdown_handler();
     logger_close();
@@ -1,10 +1,408 @@
 #include "message_types.h"
 
 #include "logger.h"
+#include <stddef.h>
 #include <string.h>
 #include <stdlib.h>
 
+#include "payload_pool.h"
+#include "platform_atomic.h"
+#include "platform_string.h"
 #include "platform_threads.h"
+#include "platform_time.h"
+
+#define MESSAGE_QUEUE_DEFAULT_BLOCK_MS 5000
+#define MESSAGE_QUEUE_EVICT_ATTEMPTS 4  // Evictions tried before an offer gives up
+
+static const char* const QUEUE_OVERFLOW_POLICY_STRINGS[QUEUE_OVERFLOW_POLICY_COUNT] = {
+    "block",
+    "drop_oldest",
+    "drop_newest",
+    "sample_1_in_n"
+};
+
+/**
+ * @brief Inline content bytes of a message: content_size, or none if its
+ * content is in a pooled buffer.
+ */
+static size_t inline_bytes(const MessageHeader_T* header) {
+    if (header->payload != PAYLOAD_NONE) {
+        return 0;
+    }
+    return header->content_size < MESSAGE_CONTENT_SIZE ? header->content_size : MESSAGE_CONTENT_SIZE;
+}
+
+static inline MessageSlot_T* slot_at(const MessageQueue_T* queue, uint64_t position) {
+    return (MessageSlot_T*)(queue->slots + (size_t)(position & queue->mask) * queue->slot_size);
+}
+
+/**
+ * @copydoc message_content
+ */
+const uint8_t* message_content(const Message_T* message) {
+    if (message->header.payload != PAYLOAD_NONE) {
+        return payload_data(message->header.payload) + message->header.payload_offset;
+    }
+    return message->content;
+}
+
+/**
+ * @copydoc message_release
+ */
+void message_release(Message_T* message) {
+    payload_release(message->header.payload);
+    message->header.payload = PAYLOAD_NONE;
+}
+
+/**
+ * @copydoc message_queue_init
+ */
+bool message_queue_init(MessageQueue_T* queue, uint32_t max_size, size_t max_bytes, const char* owner_label) {
+    if (!queue || max_size == 0 || max_size > MESSAGE_QUEUE_MAX_CAPACITY) {
+        return false;
+    }
+
+    size_t inline_size = max_bytes ? MESSAGE_QUEUE_COMPACT_INLINE : MESSAGE_CONTENT_SIZE;
+    size_t slot_size = (offsetof(MessageSlot_T, content) + inline_size + 7) & ~(size_t)7;
+    uint64_t capacity = 1;
+    while (capacity < max_size) {
+        capacity <<= 1;
+    }
+
+    memset(queue, 0, sizeof(*queue));
+    queue->slots = (uint8_t*)calloc((size_t)capacity, slot_size);
+    if (!queue->slots) {
+        return false;
+    }
+    queue->slot_size = slot_size;
+    queue->inline_size = inline_size;
+    queue->mask = capacity - 1;
+    for (uint64_t i = 0; i < capacity; i++) {
+        platform_atomic_init_uint64(&slot_at(queue, i)->sequence, i);
+    }
+    queue->max_size = (int32_t)capacity;
+    queue->owner_label = owner_label;
+    platform_atomic_init_uint64(&queue->tail, 0);
+    platform_atomic_init_uint64(&queue->head, 0);
+    platform_atomic_init_uint32(&queue->push_waiters, 0);
+    platform_atomic_init_uint32(&queue->pop_waiters, 0);
+    queue->overflow_policy = QUEUE_OVERFLOW_BLOCK;
+    queue->block_timeout_ms = MESSAGE_QUEUE_DEFAULT_BLOCK_MS;
+    queue->sample_interval = 1;
+    platform_atomic_init_uint32(&queue->overflows, 0);
+    platform_atomic_init_uint32(&queue->returned_count, 0);
+    for (int i = 0; i < QUEUE_OVERFLOW_POLICY_COUNT; i++) {
+        platform_atomic_init_uint64(&queue->dropped[i], 0);
+    }
+
+    if (platform_event_create(&queue->not_empty_event, false, false) != PLATFORM_ERROR_SUCCESS) {
+        free(queue->slots);
+        queue->slots = NULL;
+        return false;
+    }
+    if (platform_event_create(&queue->not_full_event, false, false) != PLATFORM_ERROR_SUCCESS) {
+        platform_event_destroy(queue->not_empty_event);
+        free(queue->slots);
+        queue->slots = NULL;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @copydoc message_queue_memory
+ */
+size_t message_queue_memory(const MessageQueue_T* queue) {
+    return queue && queue->slots ? (size_t)(queue->mask + 1) * queue->slot_size : 0;
+}
+
+/**
+ * @copydoc message_queue_count
+ */
+uint32_t message_queue_count(const MessageQueue_T* queue) {
+    if (!queue || !queue->slots) {
+        return 0;
+    }
+    // head first: read the other way round, a pop between the loads could
+    // leave head past the tail read
+    uint64_t head = platform_atomic_load_uint64(&queue->head);
+    uint64_t tail = platform_atomic_load_uint64(&queue->tail);
+    // The stash indices belong to the consumer; any thread may count
+    uint32_t returned = platform_atomic_load_uint32(&queue->returned_count);
+    return (tail > head ? (uint32_t)(tail - head) : 0) + returned;
+}
+
+/**
+ * @brief Claims the free positions from tail on, up to count, with one
+ * update of tail, and copies messages into them, without waiting.
+ * @return The number of messages pushed; 0 if the queue is full
+ */
+static uint32_t try_push(MessageQueue_T* queue, const Message_T* messages, uint32_t count) {
+    uint64_t position = platform_atomic_load_uint64_explicit(&queue->tail, PLATFORM_MEMORY_ORDER_RELAXED);
+    for (;;) {
+        // Slots stay free until tail passes them, so the run counted here
+        // is still free if tail has not moved when the claim is made
+        uint32_t run = 0;
+        int64_t difference = 0;
+        while (run < count) {
+            MessageSlot_T* slot = slot_at(queue, position + run);
+            uint64_t sequence = platform_atomic_load_uint64_explicit(&slot->sequence, PLATFORM_MEMORY_ORDER_ACQUIRE);
+            difference = (int64_t)(sequence - (position + run));
+            if (difference != 0) {
+                break;
+            }
+            run++;
+        }
+
+        if (run > 0) {
+            if (platform_atomic_compare_exchange_uint64(&queue->tail, &position, position + run)) {
+                for (uint32_t i = 0; i < run; i++) {
+                    MessageSlot_T* slot = slot_at(queue, position + i);
+                    slot->header = messages[i].header;
+                    memcpy(slot->content, messages[i].content, inline_bytes(&messages[i].header));
+                    // Hands the slot to the consumer of this position
+                    platform_atomic_store_uint64_explicit(&slot->sequence, position + i + 1,
+                                                          PLATFORM_MEMORY_ORDER_RELEASE);
+                }
+                return run;
+            }
+            // Another producer took the position; position now holds the tail it left
+        } else if (difference < 0) {
+            // The slot still holds the message from a lap ago
+            return 0;
+        } else {
+            position = platform_atomic_load_uint64_explicit(&queue->tail, PLATFORM_MEMORY_ORDER_RELAXED);
+        }
+    }
+}
+
+/**
+ * @brief Claims the published positions from head on, up to max_count,
+ * with one update of head, and copies their messages out, without waiting.
+ * @return The number of messages popped; 0 if the queue is empty
+ */
+static uint32_t try_pop(MessageQueue_T* queue, Message_T* messages, uint32_t max_count) {
+    uint64_t position = platform_atomic_load_uint64_explicit(&queue->head, PLATFORM_MEMORY_ORDER_RELAXED);
+    for (;;) {
+        uint32_t run = 0;
+        int64_t difference = 0;
+        while (run < max_count) {
+            MessageSlot_T* slot = slot_at(queue, position + run);
+            uint64_t sequence = platform_atomic_load_uint64_explicit(&slot->sequence, PLATFORM_MEMORY_ORDER_ACQUIRE);
+            difference = (int64_t)(sequence - (position + run + 1));
+            if (difference != 0) {
+                break;
+            }
+            run++;
+        }
+
+        if (run > 0) {
+            if (platform_atomic_compare_exchange_uint64(&queue->head, &position, position + run)) {
+                for (uint32_t i = 0; i < run; i++) {
+                    MessageSlot_T* slot = slot_at(queue, position + i);
+                    messages[i].header = slot->header;
+                    memcpy(messages[i].content, slot->content, inline_bytes(&slot->header));
+                    // Hands the slot to the producer of the next lap
+                    platform_atomic_store_uint64_explicit(&slot->sequence, position + i + queue->mask + 1,
+                                                          PLATFORM_MEMORY_ORDER_RELEASE);
+                }
+                return run;
+            }
+        } else if (difference < 0) {
+            // Not yet published
+            return 0;
+        } else {
+            position = platform_atomic_load_uint64_explicit(&queue->head, PLATFORM_MEMORY_ORDER_RELAXED);
+        }
+    }
+}
+
+/**
+ * @copydoc message_queue_destroy
+ */
+void message_queue_destroy(MessageQueue_T* queue) {
+    if (!queue || !queue->slots) {
+        return;
+    }
+    // Messages never popped still hold their buffers
+    Message_T message;
+    while (try_pop(queue, &message, 1)) {
+        message_release(&message);
+    }
+    for (uint32_t i = queue->returned_first; i < queue->returned_end; i++) {
+        message_release(&queue->returned[i]);
+    }
+    free(queue->returned);
+    queue->returned = NULL;
+    queue->returned_first = queue->returned_end = 0;
+    platform_atomic_store_uint32(&queue->returned_count, 0);
+    platform_event_destroy(queue->not_empty_event);
+    platform_event_destroy(queue->not_full_event);
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+static bool has_messages(MessageQueue_T* queue) {
+    uint64_t position = platform_atomic_load_uint64(&queue->head);
+    MessageSlot_T* slot = slot_at(queue, position);
+    return platform_atomic_load_uint64_explicit(&slot->sequence, PLATFORM_MEMORY_ORDER_ACQUIRE) == position + 1;
+}
+
+static bool has_room(MessageQueue_T* queue) {
+    uint64_t position = platform_atomic_load_uint64(&queue->tail);
+    MessageSlot_T* slot = slot_at(queue, position);
+    return platform_atomic_load_uint64_explicit(&slot->sequence, PLATFORM_MEMORY_ORDER_ACQUIRE) == position;
+}
+
+/**
+ * @brief Sets the events only threads that are waiting need.
+ *
+ * A waiting thread counts itself in before its last try, and the fence here
+ * comes after the message was copied in or out, so either that try sees
+ * the change or this sees the waiter. Setting the event for its own side as
+ * well passes a wake-up on when several threads wait and the event, which
+ * resets on waking one, took only one set.
+ */
+static void wake_waiters(MessageQueue_T* queue) {
+    platform_atomic_thread_fence(PLATFORM_MEMORY_ORDER_SEQ_CST);
+    if (platform_atomic_load_uint32(&queue->pop_waiters) != 0 && has_messages(queue)) {
+        platform_event_set(queue->not_empty_event);
+    }
+    if (platform_atomic_load_uint32(&queue->push_waiters) != 0 && has_room(queue)) {
+        platform_event_set(queue->not_full_event);
+    }
+}
+
+/**
+ * @brief Milliseconds of a timeout still to run, or 0 once it has passed.
+ */
+static uint32_t remaining_ms(uint32_t start, uint32_t timeout_ms) {
+    if (timeout_ms == PLATFORM_WAIT_INFINITE) {
+        return PLATFORM_WAIT_INFINITE;
+    }
+    uint32_t now = start;
+    platform_get_tick_count(&now);
+    uint32_t elapsed = now - start;
+    return elapsed < timeout_ms ? timeout_ms - elapsed : 0;
+}
+
+/**
+ * @brief Pushes what there is room for, without waiting.
+ *
+ * Messages whose inline content fits the queue's slots go in runs; one
+ * with more is first moved into a pooled payload buffer, which the
+ * consumer releases with the message.
+ *
+ * @return The number pushed; fewer than count if the queue, or the payload pool, ran out
+ */
+static uint32_t push_available(MessageQueue_T* queue, const Message_T* messages, uint32_t count) {
+    uint32_t pushed = 0;
+    while (pushed < count) {
+        uint32_t run = 0;
+        while (pushed + run < count && inline_bytes(&messages[pushed + run].header) <= queue->inline_size) {
+            run++;
+        }
+        if (run > 0) {
+            uint32_t done = try_push(queue, messages + pushed, run);
+            pushed += done;
+            if (done < run) {
+                break;
+            }
+            continue;
+        }
+
+        Message_T moved;
+        moved.header = messages[pushed].header;
+        moved.header.payload = payload_acquire();
+        moved.header.payload_offset = 0;
+        if (moved.header.payload == PAYLOAD_NONE) {
+            break;
+        }
+        memcpy(payload_data(moved.header.payload), messages[pushed].content, inline_bytes(&messages[pushed].header));
+        if (try_push(queue, &moved, 1) == 0) {
+            payload_release(moved.header.payload);
+            break;
+        }
+        pushed++;
+    }
+    return pushed;
+}
+
+/**
+ * @brief Pushes messages in order, waiting for room until the timeout runs out.
+ * @return The number pushed
+ */
+static uint32_t push_messages(MessageQueue_T* queue, const Message_T* messages, uint32_t count, uint32_t timeout_ms) {
+    uint32_t pushed = push_available(queue, messages, count);
+    if (pushed < count && timeout_ms != 0) {
+        uint32_t start = 0;
+        platform_get_tick_count(&start);
+        platform_atomic_fetch_add_uint32(&queue->push_waiters, 1);
+        for (;;) {
+            pushed += push_available(queue, messages + pushed, count - pushed);
+            uint32_t remaining = pushed == count ? 0 : remaining_ms(start, timeout_ms);
+            if (remaining == 0) {
+                break;
+            }
+            PlatformErrorCode result = platform_event_wait(queue->not_full_event, remaining);
+            if (result != PLATFORM_ERROR_SUCCESS && result != PLATFORM_ERROR_TIMEOUT) {
+                break;
+            }
+        }
+        platform_atomic_fetch_add_uint32(&queue->push_waiters, (uint32_t)-1);
+    }
+    if (pushed > 0) {
+        wake_waiters(queue);
+    }
+    return pushed;
+}
+
+/**
+ * @brief Pops messages handed back with message_queue_unpop, which come
+ * before any in the ring.
+ * @return The number popped
+ */
+static uint32_t pop_returned(MessageQueue_T* queue, Message_T* messages, uint32_t max_count) {
+    uint32_t popped = 0;
+    while (popped < max_count && queue->returned_first < queue->returned_end) {
+        messages[popped++] = queue->returned[queue->returned_first++];
+    }
+    platform_atomic_store_uint32(&queue->returned_count, queue->returned_end - queue->returned_first);
+    return popped;
+}
+
+/**
+ * @brief Pops up to max_count messages, waiting for the first until the timeout runs out.
+ * @return The number popped
+ */
+static uint32_t pop_messages(MessageQueue_T* queue, Message_T* messages, uint32_t max_count, uint32_t timeout_ms) {
+    // Handed back messages are popped on their own, as they were taken
+    if (queue->returned_first < queue->returned_end) {
+        return pop_returned(queue, messages, max_count);
+    }
+    uint32_t popped = try_pop(queue, messages, max_count);
+    if (popped == 0 && timeout_ms != 0) {
+        uint32_t start = 0;
+        platform_get_tick_count(&start);
+        platform_atomic_fetch_add_uint32(&queue->pop_waiters, 1);
+        for (;;) {
+            popped = try_pop(queue, messages, max_count);
+            uint32_t remaining = popped > 0 ? 0 : remaining_ms(start, timeout_ms);
+            if (remaining == 0) {
+                break;
+            }
+            PlatformErrorCode result = platform_event_wait(queue->not_empty_event, remaining);
+            if (result != PLATFORM_ERROR_SUCCESS && result != PLATFORM_ERROR_TIMEOUT) {
+                break;
+            }
+        }
+        platform_atomic_fetch_add_uint32(&queue->pop_waiters, (uint32_t)-1);
+    }
+    if (popped > 0) {
+        wake_waiters(queue);
+    }
+    return popped;
+}
 
 bool message_queue_push(MessageQueue_T* queue, const Message_T* message, uint32_t timeout_ms) {
     if (!queue || !message) {
@@ -12,50 +410,189 @@ bool message_queue_push(MessageQueue_T* queue, const Message_T* message, uint32_
         return false;
     }
 
-    // First check if queue is full before waiting
-    int32_t next_tail = (queue->tail + 1) % queue->max_size;
-    if (next_tail == queue->head) {
-        if (!platform_event_wait(queue->not_full_event, timeout_ms)) {
+    if (push_messages(queue, message, 1, timeout_ms) == 0) {
+        // Without a timeout this was only a try, and full is an answer
+        if (timeout_ms != 0) {
             logger_log(LOG_ERROR, "Queue full timeout (owner: %s)", queue->owner_label);
-            return false;
-        }
-        // Recheck after wait
-        next_tail = (queue->tail + 1) % queue->max_size;
-        if (next_tail == queue->head) {
-            logger_log(LOG_ERROR, "Queue still full after wait (owner: %s)", queue->owner_label);
-            return false;
         }
+        return false;
     }
-
-    memcpy(&queue->entries[queue->tail], message, sizeof(Message_T));
-    queue->tail = next_tail;
-
-    platform_event_set(queue->not_empty_event);
     return true;
 }
 
+/**
+ * @copydoc message_queue_try_push
+ */
+bool message_queue_try_push(MessageQueue_T* queue, const Message_T* message) {
+    return queue && message && push_messages(queue, message, 1, 0) == 1;
+}
+
 bool message_queue_pop(MessageQueue_T* queue, Message_T* message, uint32_t timeout_ms) {
     if (!queue || !message) {
         logger_log(LOG_ERROR, "Invalid parameters for message queue pop");
         return false;
     }
 
-    // First check if queue is empty before waiting
-    if (queue->head == queue->tail) {
-        if (!platform_event_wait(queue->not_empty_event, timeout_ms)) {
-            // logger_log(LOG_DEBUG, "Queue empty timeout");
-            return false;
+    if (pop_messages(queue, message, 1, timeout_ms) == 0) {
+        // logger_log(LOG_DEBUG, "Queue empty timeout");
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @copydoc message_queue_push_batch
+ */
+uint32_t message_queue_push_batch(MessageQueue_T* queue, const Message_T* messages, uint32_t count,
+                                  uint32_t timeout_ms) {
+    if (!queue || !messages) {
+        logger_log(LOG_ERROR, "Invalid parameters for message queue push");
+        return 0;
+    }
+
+    uint32_t pushed = push_messages(queue, messages, count, timeout_ms);
+    if (pushed < count) {
+        logger_log(LOG_ERROR, "Queue full timeout, %u of %u messages pushed (owner: %s)", pushed, count,
+                   queue->owner_label);
+    }
+    return pushed;
+}
+
+/**
+ * @copydoc message_queue_pop_batch
+ */
+uint32_t message_queue_pop_batch(MessageQueue_T* queue, Message_T* messages, uint32_t max_count,
+                                 uint32_t timeout_ms) {
+    if (!queue || !messages) {
+        logger_log(LOG_ERROR, "Invalid parameters for message queue pop");
+        return 0;
+    }
+    return max_count > 0 ? pop_messages(queue, messages, max_count, timeout_ms) : 0;
+}
+
+/**
+ * @copydoc message_queue_unpop
+ */
+uint32_t message_queue_unpop(MessageQueue_T* queue, const Message_T* messages, uint32_t count) {
+    if (!queue || !messages) {
+        return 0;
+    }
+    if (!queue->returned) {
+        queue->returned = (Message_T*)malloc(MESSAGE_BATCH_MAX * sizeof(Message_T));
+        if (!queue->returned) {
+            return 0;
         }
-        // Recheck after wait
-        if (queue->head == queue->tail) {
-            // logger_log(LOG_DEBUG, "Queue still empty after wait");
-            return false;
+    }
+
+    // Those still held back stay after the ones handed back now, at the end of the array
+    uint32_t held = queue->returned_end - queue->returned_first;
+    if (count > MESSAGE_BATCH_MAX - held) {
+        count = MESSAGE_BATCH_MAX - held;
+    }
+    if (held > 0 && queue->returned_end != MESSAGE_BATCH_MAX) {
+        memmove(queue->returned + MESSAGE_BATCH_MAX - held, queue->returned + queue->returned_first,
+                held * sizeof(Message_T));
+    }
+    queue->returned_end = MESSAGE_BATCH_MAX;
+    queue->returned_first = MESSAGE_BATCH_MAX - held - count;
+    for (uint32_t i = 0; i < count; i++) {
+        queue->returned[queue->returned_first + i] = messages[i];
+    }
+    platform_atomic_store_uint32(&queue->returned_count, held + count);
+    return count;
+}
+
+/**
+ * @copydoc message_queue_set_overflow
+ */
+void message_queue_set_overflow(MessageQueue_T* queue, QueueOverflowPolicy policy, uint32_t block_timeout_ms,
+                                uint32_t sample_interval) {
+    if (!queue || (unsigned)policy >= QUEUE_OVERFLOW_POLICY_COUNT) {
+        return;
+    }
+    queue->overflow_policy = policy;
+    queue->block_timeout_ms = block_timeout_ms;
+    queue->sample_interval = sample_interval > 0 ? sample_interval : 1;
+}
+
+/**
+ * @brief Pushes a message in place of the oldest, which is dropped and
+ * counted against the policy.
+ *
+ * Consumers may empty the queue in between, and messages that need a
+ * pooled buffer may not fit even then, so this tries only a few times.
+ */
+static bool replace_oldest(MessageQueue_T* queue, const Message_T* message, QueueOverflowPolicy policy) {
+    for (int attempt = 0; attempt < MESSAGE_QUEUE_EVICT_ATTEMPTS; attempt++) {
+        Message_T oldest;
+        if (try_pop(queue, &oldest, 1) == 1) {
+            message_release(&oldest);
+            platform_atomic_fetch_add_uint64(&queue->dropped[policy], 1);
+        }
+        if (push_messages(queue, message, 1, 0) == 1) {
+            return true;
         }
     }
+    return false;
+}
+
+/**
+ * @copydoc message_queue_offer
+ */
+bool message_queue_offer(MessageQueue_T* queue, const Message_T* message) {
+    if (!queue || !message) {
+        logger_log(LOG_ERROR, "Invalid parameters for message queue offer");
+        return false;
+    }
 
-    memcpy(message, &queue->entries[queue->head], sizeof(Message_T));
-    queue->head = (queue->head + 1) % queue->max_size;
+    QueueOverflowPolicy policy = queue->overflow_policy;
+    uint32_t timeout_ms = policy == QUEUE_OVERFLOW_BLOCK ? queue->block_timeout_ms : 0;
+    if (push_messages(queue, message, 1, timeout_ms) == 1) {
+        return true;
+    }
 
-    platform_event_set(queue->not_full_event);
-    return true;
+    bool replace = policy == QUEUE_OVERFLOW_DROP_OLDEST;
+    if (policy == QUEUE_OVERFLOW_SAMPLE) {
+        // Spreads what gets through over a burst, rather than keeping its start or end
+        replace = platform_atomic_fetch_add_uint32(&queue->overflows, 1) % queue->sample_interval == 0;
+    }
+    if (replace && replace_oldest(queue, message, policy)) {
+        return true;
+    }
+    platform_atomic_fetch_add_uint64(&queue->dropped[policy], 1);
+    return false;
+}
+
+/**
+ * @copydoc message_queue_dropped
+ */
+uint64_t message_queue_dropped(const MessageQueue_T* queue, QueueOverflowPolicy policy) {
+    if (!queue || (unsigned)policy >= QUEUE_OVERFLOW_POLICY_COUNT) {
+        return 0;
+    }
+    return platform_atomic_load_uint64(&queue->dropped[policy]);
+}
+
+/**
+ * @copydoc queue_overflow_policy_from_string
+ */
+QueueOverflowPolicy queue_overflow_policy_from_string(const char* name, QueueOverflowPolicy default_policy) {
+    if (name) {
+        for (int i = 0; i < QUEUE_OVERFLOW_POLICY_COUNT; i++) {
+            if (strcmp_nocase(name, QUEUE_OVERFLOW_POLICY_STRINGS[i]) == 0) {
+                return (QueueOverflowPolicy)i;
+            }
+        }
+    }
+    return default_policy;
+}
+
+/**
+ * @copydoc queue_overflow_policy_to_string
+ */
+const char* queue_overflow_policy_to_string(QueueOverflowPolicy policy) {
+    if ((unsigned)policy >= QUEUE_OVERFLOW_POLICY_COUNT) {
+        return "unknown";
+    }
+    return QUEUE_OVERFLOW_POLICY_STRINGS[policy];
 }
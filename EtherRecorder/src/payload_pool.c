@@ -0,0 +1,129 @@
+/**
+ * @file payload_pool.c
+ * @brief Reference-counted buffers that messages carry received data in.
+ */
+#include "payload_pool.h"
+
+#include <stdlib.h>
+
+#include "platform_atomic.h"
+
+typedef struct {
+    PlatformAtomicUInt32 references;
+    PlatformAtomicUInt32 next_free;      // Handle of the next free buffer while this one is free
+} PayloadSlot_T;
+
+static struct {
+    uint8_t* data;                       // count buffers of PAYLOAD_BUFFER_SIZE bytes
+    PayloadSlot_T* slots;
+    uint32_t count;
+    // Low 32 bits: handle of the first free buffer. High 32 bits: a count
+    // of changes, so a compare-exchange cannot succeed on a head that was
+    // taken and put back in between (the ABA problem)
+    PlatformAtomicUInt64 free_head;
+} g_pool;
+
+static void push_free(PayloadHandle handle) {
+    uint64_t head = platform_atomic_load_uint64(&g_pool.free_head);
+    for (;;) {
+        platform_atomic_store_uint32(&g_pool.slots[handle - 1].next_free, (uint32_t)head);
+        uint64_t desired = ((head >> 32) + 1) << 32 | handle;
+        if (platform_atomic_compare_exchange_uint64(&g_pool.free_head, &head, desired)) {
+            return;
+        }
+    }
+}
+
+/**
+ * @copydoc payload_pool_init
+ */
+bool payload_pool_init(uint32_t buffer_count) {
+    payload_pool_cleanup();
+    platform_atomic_init_uint64(&g_pool.free_head, PAYLOAD_NONE);
+    if (buffer_count == 0) {
+        return true;
+    }
+
+    g_pool.data = malloc((size_t)buffer_count * PAYLOAD_BUFFER_SIZE);
+    g_pool.slots = calloc(buffer_count, sizeof(PayloadSlot_T));
+    if (!g_pool.data || !g_pool.slots) {
+        payload_pool_cleanup();
+        return false;
+    }
+    g_pool.count = buffer_count;
+    // Pushed in reverse so the lowest addresses are handed out first
+    for (uint32_t handle = buffer_count; handle >= 1; handle--) {
+        platform_atomic_init_uint32(&g_pool.slots[handle - 1].references, 0);
+        push_free(handle);
+    }
+    return true;
+}
+
+/**
+ * @copydoc payload_pool_count
+ */
+uint32_t payload_pool_count(void) {
+    return g_pool.count;
+}
+
+/**
+ * @copydoc payload_pool_cleanup
+ */
+void payload_pool_cleanup(void) {
+    free(g_pool.data);
+    free(g_pool.slots);
+    g_pool.data = NULL;
+    g_pool.slots = NULL;
+    g_pool.count = 0;
+    platform_atomic_init_uint64(&g_pool.free_head, PAYLOAD_NONE);
+}
+
+/**
+ * @copydoc payload_acquire
+ */
+PayloadHandle payload_acquire(void) {
+    uint64_t head = platform_atomic_load_uint64(&g_pool.free_head);
+    for (;;) {
+        PayloadHandle handle = (PayloadHandle)head;
+        if (handle == PAYLOAD_NONE) {
+            return PAYLOAD_NONE;
+        }
+        uint32_t next = platform_atomic_load_uint32(&g_pool.slots[handle - 1].next_free);
+        uint64_t desired = ((head >> 32) + 1) << 32 | next;
+        if (platform_atomic_compare_exchange_uint64(&g_pool.free_head, &head, desired)) {
+            platform_atomic_store_uint32(&g_pool.slots[handle - 1].references, 1);
+            return handle;
+        }
+    }
+}
+
+/**
+ * @copydoc payload_retain
+ */
+void payload_retain(PayloadHandle handle) {
+    if (handle != PAYLOAD_NONE && handle <= g_pool.count) {
+        platform_atomic_fetch_add_uint32(&g_pool.slots[handle - 1].references, 1);
+    }
+}
+
+/**
+ * @copydoc payload_release
+ */
+void payload_release(PayloadHandle handle) {
+    if (handle == PAYLOAD_NONE || handle > g_pool.count) {
+        return;
+    }
+    if (platform_atomic_fetch_add_uint32(&g_pool.slots[handle - 1].references, (uint32_t)-1) == 1) {
+        push_free(handle);
+    }
+}
+
+/**
+ * @copydoc payload_data
+ */
+uint8_t* payload_data(PayloadHandle handle) {
+    if (handle == PAYLOAD_NONE || handle > g_pool.count) {
+        return NULL;
+    }
+    return g_pool.data + (size_t)(handle - 1) * PAYLOAD_BUFFER_SIZE;
+}
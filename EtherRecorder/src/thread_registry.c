@@ -1,20 +1,34 @@
 #include "thread_registry.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
 
 #include "platform_error.h"
 #include "platform_mutex.h"
+#include "platform_string.h"
 #include "platform_sync.h"
 
 #include "utils.h"
 #include "message_types.h"
+#include "app_config.h"
 #include "app_error.h"
 #include "logger.h"
+#include "payload_pool.h"
+
+#define CONFIG_QUEUES_SECTION "queues"  // per thread label sizes, e.g. SERVER.SEND.capacity = 65536
+
+// A queue whose thread deregistered with messages still in it
+typedef struct ParkedQueue {
+    char label[MAX_THREAD_LABEL_LENGTH];
+    MessageQueue_T* queue;
+    struct ParkedQueue* next;
+} ParkedQueue;
 
 typedef struct ThreadRegistry {
     ThreadRegistryEntry* head;          // Head of registry entries
+    ParkedQueue* parked;                // Queues kept for the next thread with their label
     PlatformMutex_T mutex;              // Registry lock
     uint32_t count;                     // Number of registered threads
 } ThreadRegistry;
@@ -59,6 +73,45 @@ ThreadRegistryEntry* thread_registry_find_thread(const char* thread_label) {
     return NULL;
 }
 
+/**
+ * @brief Takes a parked queue for a thread registering with its label.
+ * Called with the registry locked.
+ */
+static MessageQueue_T* adopt_parked_queue(const char* thread_label) {
+    for (ParkedQueue** link = &g_registry.parked; *link; link = &(*link)->next) {
+        ParkedQueue* parked = *link;
+        if (strcmp(parked->label, thread_label) == 0) {
+            MessageQueue_T* queue = parked->queue;
+            queue->owner_label = thread_label;
+            *link = parked->next;
+            free(parked);
+            return queue;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Keeps a deregistering thread's queue if it still holds messages,
+ * else frees it. Called with the registry locked.
+ */
+static void park_or_destroy_queue(const char* thread_label, MessageQueue_T* queue) {
+    if (message_queue_count(queue) > 0) {
+        ParkedQueue* parked = calloc(1, sizeof(ParkedQueue));
+        if (parked) {
+            snprintf(parked->label, sizeof(parked->label), "%s", thread_label);
+            parked->queue = queue;
+            // The thread's label may go with it
+            queue->owner_label = parked->label;
+            parked->next = g_registry.parked;
+            g_registry.parked = parked;
+            return;
+        }
+    }
+    message_queue_destroy(queue);
+    free(queue);
+}
+
 ThreadRegistryError thread_registry_register(
     const ThreadConfig* thread,
     bool auto_cleanup
@@ -96,6 +149,7 @@ ThreadRegistryError thread_registry_register(
     entry->thread = thread;
     entry->state = THREAD_STATE_CREATED;
     entry->auto_cleanup = auto_cleanup;
+    entry->queue = adopt_parked_queue(thread->label);
     entry->next = g_registry.head;
     
     g_registry.head = entry;
@@ -104,6 +158,10 @@ ThreadRegistryError thread_registry_register(
     platform_mutex_unlock(&g_registry.mutex);
     
     logger_log(LOG_INFO, "Thread '%s' registered successfully", thread->label);
+    if (entry->queue) {
+        logger_log(LOG_INFO, "Thread '%s' takes over %u queued messages", thread->label,
+                   message_queue_count(entry->queue));
+    }
     return THREAD_REG_SUCCESS;
 }
 
@@ -178,6 +236,14 @@ ThreadRegistryError init_global_thread_registry(void) {
         return THREAD_REG_SUCCESS;
     }
 
+    while (g_registry.parked) {
+        ParkedQueue* parked = g_registry.parked;
+        g_registry.parked = parked->next;
+        message_queue_destroy(parked->queue);
+        free(parked->queue);
+        free(parked);
+    }
+
     g_registry.head = NULL;
     g_registry.count = 0;
 
@@ -215,9 +281,7 @@ void thread_registry_cleanup(void) {
 
         // Clean up message queue if it exists
         if (current->queue) {
-            platform_event_destroy(current->queue->not_empty_event);
-            platform_event_destroy(current->queue->not_full_event);
-            free(current->queue->entries);
+            message_queue_destroy(current->queue);
             free(current->queue);
         }
 
@@ -233,6 +297,14 @@ void thread_registry_cleanup(void) {
         current = next;
     }
 
+    while (g_registry.parked) {
+        ParkedQueue* parked = g_registry.parked;
+        g_registry.parked = parked->next;
+        message_queue_destroy(parked->queue);
+        free(parked->queue);
+        free(parked);
+    }
+
     g_registry.head = NULL;
     g_registry.count = 0;
 
@@ -260,6 +332,133 @@ bool thread_registry_is_registered(
     return is_registered;
 }
 
+/**
+ * @brief A thread's queue size from [queues]: <label>.capacity messages and
+ *        <label>.bytes of memory, either of which may be left out.
+ * @return true if either is configured
+ */
+static bool find_configured_queue_size(const char* thread_label, uint32_t* capacity, size_t* max_bytes) {
+    char config_key[THREAD_LABEL_SIZE + 16];
+
+    snprintf(config_key, sizeof(config_key), "%s.capacity", thread_label);
+    int configured_capacity = get_config_int(CONFIG_QUEUES_SECTION, config_key, 0);
+    snprintf(config_key, sizeof(config_key), "%s.bytes", thread_label);
+    int configured_bytes = get_config_int(CONFIG_QUEUES_SECTION, config_key, 0);
+
+    *max_bytes = configured_bytes > 0 ? (size_t)configured_bytes : 0;
+    if (configured_capacity > 0) {
+        *capacity = (uint32_t)configured_capacity < MESSAGE_QUEUE_MAX_CAPACITY ? (uint32_t)configured_capacity
+                                                                              : MESSAGE_QUEUE_MAX_CAPACITY;
+    } else {
+        // With only a byte budget, a message for each pooled buffer it pays for
+        size_t buffers = *max_bytes / PAYLOAD_BUFFER_SIZE;
+        *capacity = buffers > MESSAGE_QUEUE_MAX_CAPACITY    ? MESSAGE_QUEUE_MAX_CAPACITY
+                  : buffers > MESSAGE_QUEUE_DEFAULT_CAPACITY ? (uint32_t)buffers
+                                                             : MESSAGE_QUEUE_DEFAULT_CAPACITY;
+    }
+    return configured_capacity > 0 || configured_bytes > 0;
+}
+
+/**
+ * @brief A thread's overflow policy from [queues]: <label>.overflow, with
+ *        <label>.block_timeout_ms for block and <label>.sample_n for sample_1_in_n.
+ * @return true if the policy is configured
+ */
+static bool find_configured_overflow(const char* thread_label, QueueOverflowPolicy* policy,
+                                     uint32_t* block_timeout_ms, uint32_t* sample_interval) {
+    char config_key[THREAD_LABEL_SIZE + 24];
+
+    snprintf(config_key, sizeof(config_key), "%s.overflow", thread_label);
+    const char* name = get_config_string(CONFIG_QUEUES_SECTION, config_key, NULL);
+    *policy = queue_overflow_policy_from_string(name, QUEUE_OVERFLOW_BLOCK);
+    if (name && strcmp_nocase(name, queue_overflow_policy_to_string(*policy)) != 0) {
+        logger_log(LOG_WARN, "Unknown overflow policy '%s' for '%s', using block", name, thread_label);
+    }
+    snprintf(config_key, sizeof(config_key), "%s.block_timeout_ms", thread_label);
+    int timeout = get_config_int(CONFIG_QUEUES_SECTION, config_key, DEFAULT_THREAD_WAIT_TIMEOUT_MS);
+    *block_timeout_ms = timeout >= 0 ? (uint32_t)timeout : DEFAULT_THREAD_WAIT_TIMEOUT_MS;
+    snprintf(config_key, sizeof(config_key), "%s.sample_n", thread_label);
+    int interval = get_config_int(CONFIG_QUEUES_SECTION, config_key, 10);
+    *sample_interval = interval > 0 ? (uint32_t)interval : 1;
+    return name != NULL;
+}
+
+/**
+ * @brief Allocates an entry's queue. Called with the registry locked.
+ */
+static ThreadRegistryError create_queue(ThreadRegistryEntry* entry) {
+    if (entry->queue) {
+        return THREAD_REG_SUCCESS;
+    }
+
+    uint32_t capacity = 0;
+    size_t max_bytes = 0;
+    find_configured_queue_size(entry->thread->label, &capacity, &max_bytes);
+
+    MessageQueue_T* queue = (MessageQueue_T*)calloc(1, sizeof(MessageQueue_T));
+    if (!queue) {
+        return THREAD_REG_CREATION_FAILED;
+    }
+    if (!message_queue_init(queue, capacity, max_bytes, entry->thread->label)) {
+        free(queue);
+        return THREAD_REG_CREATION_FAILED;
+    }
+    QueueOverflowPolicy policy;
+    uint32_t block_timeout_ms;
+    uint32_t sample_interval;
+    find_configured_overflow(entry->thread->label, &policy, &block_timeout_ms, &sample_interval);
+    message_queue_set_overflow(queue, policy, block_timeout_ms, sample_interval);
+
+    entry->queue = queue;
+    logger_log(LOG_DEBUG, "Queue for '%s': %d messages, %zu bytes, overflow %s", entry->thread->label,
+               queue->max_size, message_queue_memory(queue), queue_overflow_policy_to_string(policy));
+    // Its messages over MESSAGE_QUEUE_COMPACT_INLINE bytes, relayed reads
+    // among them, each hold a buffer from the pool every queue shares
+    if (max_bytes && (uint32_t)queue->max_size > payload_pool_count()) {
+        logger_log(LOG_WARN, "Queue for '%s' takes %d messages, but there are %u payload buffers for those "
+                   "over %d bytes; raise its bytes or [network] payload_buffers", entry->thread->label,
+                   queue->max_size, payload_pool_count(), MESSAGE_QUEUE_COMPACT_INLINE);
+    }
+    return THREAD_REG_SUCCESS;
+}
+
+/**
+ * @brief Adds up the buffers of one [queues] <label>.bytes entry.
+ */
+static void add_queue_payload_buffers(const char* key, const char* value, void* context) {
+    size_t key_length = strlen(key);
+    const char suffix[] = ".bytes";
+    if (key_length < sizeof(suffix) || strcmp_nocase(key + key_length - (sizeof(suffix) - 1), suffix) != 0) {
+        return;
+    }
+    long long bytes = strtoll(value, NULL, 10);
+    if (bytes > 0) {
+        *(uint64_t*)context += ((uint64_t)bytes + PAYLOAD_BUFFER_SIZE - 1) / PAYLOAD_BUFFER_SIZE;
+    }
+}
+
+/**
+ * @copydoc thread_registry_queue_payload_buffers
+ */
+uint32_t thread_registry_queue_payload_buffers(void) {
+    uint64_t buffers = 0;
+    for_each_config_key(CONFIG_QUEUES_SECTION, add_queue_payload_buffers, &buffers);
+    return buffers < UINT32_MAX ? (uint32_t)buffers : UINT32_MAX;
+}
+
+/**
+ * @brief Finds a thread's entry, creating its queue if it has none yet.
+ * Called with the registry locked.
+ */
+static ThreadRegistryEntry* find_thread_with_queue(const char* thread_label) {
+    ThreadRegistryEntry* entry = thread_registry_find_thread(thread_label);
+    if (entry && create_queue(entry) != THREAD_REG_SUCCESS) {
+        logger_log(LOG_ERROR, "Failed to create message queue for '%s'", thread_label);
+        return NULL;
+    }
+    return entry;
+}
+
 ThreadRegistryError init_queue(
     const char* thread_label
 ) {
@@ -267,8 +466,7 @@ ThreadRegistryError init_queue(
         return THREAD_REG_NOT_INITIALIZED;
     }
 
-    uint32_t max_size = 1024;  // Default size
-    if (!validate_thread_label(thread_label) || max_size == 0) {
+    if (!validate_thread_label(thread_label)) {
         return THREAD_REG_INVALID_ARGS;
     }
 
@@ -282,63 +480,28 @@ ThreadRegistryError init_queue(
         return THREAD_REG_NOT_FOUND;
     }
 
-    // Don't recreate if queue already exists
-    if (entry->queue) {
-        platform_mutex_unlock(&g_registry.mutex);
-        return THREAD_REG_SUCCESS;
-    }
-
-    // Allocate queue structure
-    entry->queue = (MessageQueue_T*)calloc(1, sizeof(MessageQueue_T));
-    if (!entry->queue) {
-        platform_mutex_unlock(&g_registry.mutex);
-        return THREAD_REG_CREATION_FAILED;
-    }
-
-    // Allocate message entries
-    entry->queue->entries = (Message_T*)calloc(max_size, sizeof(Message_T));
-    if (!entry->queue->entries) {
-        free(entry->queue);
-        entry->queue = NULL;
-        platform_mutex_unlock(&g_registry.mutex);
-        return THREAD_REG_CREATION_FAILED;
-    }
-
-    // Initialize queue fields
-    entry->queue->max_size = max_size;
-    entry->queue->head = 0;
-    entry->queue->tail = 0;
-    entry->queue->owner_label = thread_label;  // Set the owner label
-
-    // Create synchronization events
-    PlatformErrorCode err = platform_event_create(&entry->queue->not_empty_event, false, false);
-    if (err != PLATFORM_ERROR_SUCCESS) {
-        free(entry->queue->entries);
-        free(entry->queue);
-        entry->queue = NULL;
-        platform_mutex_unlock(&g_registry.mutex);
-        return THREAD_REG_CREATION_FAILED;
-    }
-
-    err = platform_event_create(&entry->queue->not_full_event, false, true);
-    if (err != PLATFORM_ERROR_SUCCESS) {
-        platform_event_destroy(entry->queue->not_empty_event);
-        free(entry->queue->entries);
-        free(entry->queue);
-        entry->queue = NULL;
-        platform_mutex_unlock(&g_registry.mutex);
-        return THREAD_REG_CREATION_FAILED;
+    // Threads that process messages, or have a configured queue, get it now;
+    // the rest only when a message is first pushed to or popped from it
+    ThreadRegistryError result = THREAD_REG_SUCCESS;
+    uint32_t capacity = 0;
+    size_t max_bytes = 0;
+    QueueOverflowPolicy policy;
+    uint32_t block_timeout_ms;
+    uint32_t sample_interval;
+    if (entry->thread->msg_processor || find_configured_queue_size(thread_label, &capacity, &max_bytes) ||
+        find_configured_overflow(thread_label, &policy, &block_timeout_ms, &sample_interval)) {
+        result = create_queue(entry);
     }
 
     platform_mutex_unlock(&g_registry.mutex);
-    return THREAD_REG_SUCCESS;
+    return result;
 }
 
-ThreadRegistryError push_message(
-    const char* thread_label,
-    const Message_T* message,
-    uint32_t timeout_ms
-) {
+/**
+ * @brief Finds the queue of a thread for a producer to push to.
+ */
+static ThreadRegistryError find_foreign_queue(const char* thread_label, const Message_T* message,
+                                              MessageQueue_T** queue) {
     if (!g_registry_initialized) {
         return THREAD_REG_NOT_INITIALIZED;
     }
@@ -351,14 +514,27 @@ ThreadRegistryError push_message(
         return THREAD_REG_LOCK_ERROR;
     }
 
-    ThreadRegistryEntry* entry = thread_registry_find_thread(thread_label);
-    if (!entry || !entry->queue) {
+    ThreadRegistryEntry* entry = find_thread_with_queue(thread_label);
+    if (!entry) {
         platform_mutex_unlock(&g_registry.mutex);
         return THREAD_REG_NOT_FOUND;
     }
 
-    MessageQueue_T* queue = entry->queue;
+    *queue = entry->queue;
     platform_mutex_unlock(&g_registry.mutex);
+    return THREAD_REG_SUCCESS;
+}
+
+ThreadRegistryError push_message(
+    const char* thread_label,
+    const Message_T* message,
+    uint32_t timeout_ms
+) {
+    MessageQueue_T* queue = NULL;
+    ThreadRegistryError result = find_foreign_queue(thread_label, message, &queue);
+    if (result != THREAD_REG_SUCCESS) {
+        return result;
+    }
 
     if (!message_queue_push(queue, message, timeout_ms)) {
         return THREAD_REG_QUEUE_FULL;
@@ -367,16 +543,27 @@ ThreadRegistryError push_message(
     return THREAD_REG_SUCCESS;
 }
 
-ThreadRegistryError pop_message(
-    const char* thread_label,
-    Message_T* message,
-    uint32_t timeout_ms
-) {
+/**
+ * @copydoc try_push_message
+ */
+ThreadRegistryError try_push_message(const char* thread_label, const Message_T* message) {
+    MessageQueue_T* queue = NULL;
+    ThreadRegistryError result = find_foreign_queue(thread_label, message, &queue);
+    if (result != THREAD_REG_SUCCESS) {
+        return result;
+    }
+    return message_queue_try_push(queue, message) ? THREAD_REG_SUCCESS : THREAD_REG_QUEUE_FULL;
+}
+
+/**
+ * @brief Finds the queue of a thread, checking the caller is that thread.
+ */
+static ThreadRegistryError find_own_queue(const char* thread_label, MessageQueue_T** queue) {
     if (!g_registry_initialized) {
         return THREAD_REG_NOT_INITIALIZED;
     }
 
-    if (!validate_thread_label(thread_label) || !message) {
+    if (!validate_thread_label(thread_label)) {
         return THREAD_REG_INVALID_ARGS;
     }
 
@@ -386,8 +573,8 @@ ThreadRegistryError pop_message(
         return THREAD_REG_LOCK_ERROR;
     }
 
-    ThreadRegistryEntry* entry = thread_registry_find_thread(thread_label);
-    if (!entry || !entry->queue) {
+    ThreadRegistryEntry* entry = find_thread_with_queue(thread_label);
+    if (!entry) {
         platform_mutex_unlock(&g_registry.mutex);
         return THREAD_REG_NOT_FOUND;
     }
@@ -397,8 +584,25 @@ ThreadRegistryError pop_message(
         return THREAD_REG_UNAUTHORIZED;
     }
 
-    MessageQueue_T* queue = entry->queue;
+    *queue = entry->queue;
     platform_mutex_unlock(&g_registry.mutex);
+    return THREAD_REG_SUCCESS;
+}
+
+ThreadRegistryError pop_message(
+    const char* thread_label,
+    Message_T* message,
+    uint32_t timeout_ms
+) {
+    if (!message) {
+        return THREAD_REG_INVALID_ARGS;
+    }
+
+    MessageQueue_T* queue = NULL;
+    ThreadRegistryError result = find_own_queue(thread_label, &queue);
+    if (result != THREAD_REG_SUCCESS) {
+        return result;
+    }
 
     if (!message_queue_pop(queue, message, timeout_ms)) {
         return THREAD_REG_QUEUE_EMPTY;
@@ -407,6 +611,49 @@ ThreadRegistryError pop_message(
     return THREAD_REG_SUCCESS;
 }
 
+ThreadRegistryError pop_message_batch(
+    const char* thread_label,
+    Message_T* messages,
+    uint32_t max_count,
+    uint32_t* count,
+    uint32_t timeout_ms
+) {
+    if (!messages || !count || max_count == 0) {
+        return THREAD_REG_INVALID_ARGS;
+    }
+    *count = 0;
+
+    MessageQueue_T* queue = NULL;
+    ThreadRegistryError result = find_own_queue(thread_label, &queue);
+    if (result != THREAD_REG_SUCCESS) {
+        return result;
+    }
+
+    *count = message_queue_pop_batch(queue, messages, max_count, timeout_ms);
+    return *count > 0 ? THREAD_REG_SUCCESS : THREAD_REG_QUEUE_EMPTY;
+}
+
+ThreadRegistryError unpop_message_batch(
+    const char* thread_label,
+    const Message_T* messages,
+    uint32_t count,
+    uint32_t* returned
+) {
+    if (!messages || !returned) {
+        return THREAD_REG_INVALID_ARGS;
+    }
+    *returned = 0;
+
+    MessageQueue_T* queue = NULL;
+    ThreadRegistryError result = find_own_queue(thread_label, &queue);
+    if (result != THREAD_REG_SUCCESS) {
+        return result;
+    }
+
+    *returned = message_queue_unpop(queue, messages, count);
+    return *returned == count ? THREAD_REG_SUCCESS : THREAD_REG_QUEUE_FULL;
+}
+
 MessageQueue_T* get_queue_by_label(const char* thread_label) {
     if (!validate_thread_label(thread_label)) {
         return NULL;
@@ -417,7 +664,7 @@ MessageQueue_T* get_queue_by_label(const char* thread_label) {
         return NULL;
     }
 
-    ThreadRegistryEntry* entry = thread_registry_find_thread(thread_label);
+    ThreadRegistryEntry* entry = find_thread_with_queue(thread_label);
     MessageQueue_T* queue = entry ? entry->queue : NULL;
 
     platform_mutex_unlock(&g_registry.mutex);
@@ -593,6 +840,19 @@ PlatformWaitResult thread_registry_wait_list(PlatformThreadId* thread_ids, uint3
     return final_result;
 }
 
+/**
+ * @brief Logs what a queue's overflow policy dropped over its life, if anything.
+ */
+static void log_queue_drops(const MessageQueue_T* queue) {
+    for (int policy = 0; policy < QUEUE_OVERFLOW_POLICY_COUNT; policy++) {
+        uint64_t dropped = message_queue_dropped(queue, (QueueOverflowPolicy)policy);
+        if (dropped > 0) {
+            logger_log(LOG_WARN, "Queue '%s' dropped %llu messages (%s)", queue->owner_label,
+                       (unsigned long long)dropped, queue_overflow_policy_to_string((QueueOverflowPolicy)policy));
+        }
+    }
+}
+
 ThreadRegistryError thread_registry_deregister(const char* thread_label) {
     if (!g_registry_initialized) {
         return THREAD_REG_NOT_INITIALIZED;
@@ -622,10 +882,8 @@ ThreadRegistryError thread_registry_deregister(const char* thread_label) {
             platform_event_destroy(entry->completion_event);
             
             if (entry->queue) {
-                platform_event_destroy(entry->queue->not_empty_event);
-                platform_event_destroy(entry->queue->not_full_event);
-                free(entry->queue->entries);
-                free(entry->queue);
+                log_queue_drops(entry->queue);
+                park_or_destroy_queue(thread_label, entry->queue);
             }
 
             free(entry);
@@ -0,0 +1,289 @@
+/**
+ * @file etherlog_dump.c
+ * @brief Decodes binary log files back into the text layout or into JSON.
+ *
+ * Compressed (.lz) rotated files are decompressed first; a compressed text
+ * log is written out as it is.
+ *
+ * Usage: etherlog-dump [--json] [--block <n>] [--output <file>] <log file>...
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_binary.h"
+#include "log_lz.h"
+#include "logger.h"
+#include "platform_path.h"
+#include "platform_time.h"
+
+typedef enum DumpFormat {
+    DUMP_FORMAT_TEXT,
+    DUMP_FORMAT_JSON
+} DumpFormat;
+
+// Decoding state of the current segment
+typedef struct DumpSegment {
+    unsigned long long index;
+    int fraction_digits;
+    int index_width;
+    const char *labels[LOG_BINARY_MAX_THREADS];
+    size_t label_lengths[LOG_BINARY_MAX_THREADS];
+} DumpSegment;
+
+/**
+ * @brief Names a level as logger.c's log_level_to_string does.
+ */
+static const char *level_name(uint8_t level) {
+    switch ((LogLevel)level) {
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_INFO: return  "INFO ";
+        case LOG_WARN: return  "WARN ";
+        case LOG_ERROR: return "ERROR";
+        case LOG_FATAL: return "FATAL";
+        default: return "UNKNN";
+    }
+}
+
+/**
+ * @brief Writes bytes as the contents of a JSON string.
+ */
+static void write_json_string(FILE *out, const char *text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = (unsigned char)text[i];
+        switch (c) {
+            case '"':  fputs("\\\"", out); break;
+            case '\\': fputs("\\\\", out); break;
+            case '\n': fputs("\\n", out); break;
+            case '\r': fputs("\\r", out); break;
+            case '\t': fputs("\\t", out); break;
+            default:
+                if (c < 0x20) {
+                    fprintf(out, "\\u%04x", c);
+                } else {
+                    fputc(c, out);
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Writes one entry in the chosen layout.
+ */
+static void write_entry(FILE *out, DumpFormat format, const DumpSegment *segment, const LogBinaryRecord_T *record) {
+    time_t seconds = (time_t)(record->timestamp_ns / 1000000000ULL);
+    unsigned long long fraction = record->timestamp_ns % 1000000000ULL;
+    for (int digits = 9; digits > segment->fraction_digits; digits--) {
+        fraction /= 10;
+    }
+
+    char date[32];
+    struct tm timeinfo;
+    platform_localtime(&seconds, &timeinfo);
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &timeinfo);
+
+    const char *label = "UNKNOWN";
+    int label_length = (int)strlen(label);
+    if (record->thread_id < LOG_BINARY_MAX_THREADS && segment->labels[record->thread_id]) {
+        label = segment->labels[record->thread_id];
+        label_length = (int)segment->label_lengths[record->thread_id];
+    }
+
+    if (format == DUMP_FORMAT_JSON) {
+        fprintf(out, "{\"index\": %llu, \"timestamp\": \"%s", segment->index, date);
+        if (segment->fraction_digits > 0) {
+            fprintf(out, ".%0*llu", segment->fraction_digits, fraction);
+        }
+        const char *name = level_name(record->level);
+        int name_length = (int)strlen(name);
+        while (name_length > 0 && name[name_length - 1] == ' ') {
+            name_length--;
+        }
+        fprintf(out, "\", \"level\": \"%.*s\", \"thread\": \"", name_length, name);
+        write_json_string(out, label, (size_t)label_length);
+        fputs("\", \"message\": \"", out);
+        write_json_string(out, record->text, record->length);
+        fputs("\"}\n", out);
+        return;
+    }
+
+    // index date time[.fraction] LEVEL: [label] message, as publish_log_entry writes it
+    fprintf(out, "%0*llu %s", segment->index_width, segment->index, date);
+    if (segment->fraction_digits > 0) {
+        fprintf(out, ".%0*llu", segment->fraction_digits, fraction);
+    }
+    fprintf(out, " %s: [%.*s] ", level_name(record->level), label_length, label);
+    fwrite(record->text, 1, record->length, out);
+    fputc('\n', out);
+}
+
+/**
+ * @brief Reads a whole file into memory.
+ * @return The contents, to be freed by the caller, or NULL on failure.
+ */
+static uint8_t *read_file(const char *file_name, size_t *size) {
+    FILE *fp = NULL;
+    if (platform_fopen(&fp, file_name, "rb") != PLATFORM_ERROR_SUCCESS || !fp) {
+        return NULL;
+    }
+
+    uint8_t *data = NULL;
+    long length = -1;
+    if (fseek(fp, 0, SEEK_END) == 0) {
+        length = ftell(fp);
+    }
+    if (length >= 0 && fseek(fp, 0, SEEK_SET) == 0) {
+        data = malloc(length > 0 ? (size_t)length : 1);
+        if (data && fread(data, 1, (size_t)length, fp) != (size_t)length) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(fp);
+    *size = (size_t)length;
+    return data;
+}
+
+/**
+ * @brief Decodes one log file.
+ * @param first_block For a compressed file, the block to start from.
+ * @return 0 on success, 1 if the file could not be read or is damaged.
+ */
+static int dump_file(const char *file_name, FILE *out, DumpFormat format, uint64_t first_block) {
+    size_t size = 0;
+    uint8_t *data = read_file(file_name, &size);
+    if (!data) {
+        fprintf(stderr, "etherlog-dump: cannot read %s\n", file_name);
+        return 1;
+    }
+
+    if (log_lz_is_compressed(data, size)) {
+        // The first block says whether the compressed log is binary or text
+        size_t first_size = 0;
+        uint8_t *first = log_lz_decompress_file(data, size, 0, 1, &first_size);
+        bool binary = first && first_size >= LOG_BINARY_MAGIC_LENGTH &&
+                      memcmp(first, LOG_BINARY_MAGIC, LOG_BINARY_MAGIC_LENGTH) == 0;
+        free(first);
+        if (binary && first_block > 0) {
+            // A binary log only decodes from its start, where the labels are
+            fprintf(stderr, "etherlog-dump: %s holds a binary log; decode it from block 0\n", file_name);
+            free(data);
+            return 1;
+        }
+
+        size_t raw_size = 0;
+        uint8_t *raw = log_lz_decompress_file(data, size, first_block, 0, &raw_size);
+        free(data);
+        if (!raw) {
+            fprintf(stderr, "etherlog-dump: cannot decompress %s from block %llu\n", file_name,
+                    (unsigned long long)first_block);
+            return 1;
+        }
+        if (!binary) {
+            // Text logs are already in the text layout
+            fwrite(raw, 1, raw_size, out);
+            free(raw);
+            return 0;
+        }
+        data = raw;
+        size = raw_size;
+    }
+
+    DumpSegment segment;
+    memset(&segment, 0, sizeof(segment));
+    bool in_segment = false;
+    int result = 0;
+
+    const uint8_t *cursor = data;
+    const uint8_t *end = data + size;
+    LogBinaryRecord_T record;
+    LogBinaryStatus status;
+    while ((status = log_binary_decode_record(&cursor, end, &record)) == LOG_BINARY_OK) {
+        switch (record.type) {
+            case LOG_BINARY_RECORD_SEGMENT:
+                memset(&segment, 0, sizeof(segment));
+                segment.fraction_digits = record.fraction_digits <= 9 ? record.fraction_digits : 9;
+                segment.index_width = record.index_width;
+                in_segment = true;
+                break;
+            case LOG_BINARY_RECORD_LABEL:
+                if (record.thread_id < LOG_BINARY_MAX_THREADS) {
+                    segment.labels[record.thread_id] = record.text;
+                    segment.label_lengths[record.thread_id] = record.length;
+                }
+                break;
+            case LOG_BINARY_RECORD_ENTRY:
+                segment.index += record.index_delta;
+                write_entry(out, format, &segment, &record);
+                break;
+        }
+        if (!in_segment) {
+            fprintf(stderr, "etherlog-dump: %s is not a binary log file\n", file_name);
+            result = 1;
+            break;
+        }
+    }
+
+    if (status == LOG_BINARY_TRUNCATED) {
+        // A file still being written, or cut short by a crash, ends part way through a record
+        fprintf(stderr, "etherlog-dump: %s ends part way through a record at offset %zu\n",
+                file_name, (size_t)(cursor - data));
+        result = 1;
+    } else if (status == LOG_BINARY_INVALID) {
+        fprintf(stderr, "etherlog-dump: %s has an unknown record at offset %zu\n",
+                file_name, (size_t)(cursor - data));
+        result = 1;
+    }
+
+    free(data);
+    return result;
+}
+
+static void print_usage(void) {
+    fprintf(stderr, "Usage: etherlog-dump [--json] [--block <n>] [--output <file>] <log file>...\n"
+                    "Decodes binary log files (log_file_format = binary) to the text layout,\n"
+                    "or to one JSON object per line with --json. Compressed (.lz) files are\n"
+                    "decompressed, from block n onwards with --block.\n");
+}
+
+int main(int argc, char *argv[]) {
+    DumpFormat format = DUMP_FORMAT_TEXT;
+    const char *output_name = NULL;
+    uint64_t first_block = 0;
+    int first_file = 1;
+
+    for (; first_file < argc && argv[first_file][0] == '-'; first_file++) {
+        if (strcmp(argv[first_file], "--json") == 0) {
+            format = DUMP_FORMAT_JSON;
+        } else if (strcmp(argv[first_file], "--block") == 0 && first_file + 1 < argc) {
+            first_block = strtoull(argv[++first_file], NULL, 10);
+        } else if (strcmp(argv[first_file], "--output") == 0 && first_file + 1 < argc) {
+            output_name = argv[++first_file];
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (first_file >= argc) {
+        print_usage();
+        return 2;
+    }
+
+    FILE *out = stdout;
+    if (output_name && (platform_fopen(&out, output_name, "w") != PLATFORM_ERROR_SUCCESS || !out)) {
+        fprintf(stderr, "etherlog-dump: cannot create %s\n", output_name);
+        return 1;
+    }
+
+    int result = 0;
+    for (int i = first_file; i < argc; i++) {
+        result |= dump_file(argv[i], out, format, first_block);
+    }
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return result;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file etherlog_recover.c
+ * @brief Decodes a flight recorder ring (log_flight.h) into the text layout.
+ *
+ * Records come out oldest first. Each line starts with the record's sequence
+ * number rather than a log index, since the index is only assigned when the
+ * logger thread publishes an entry.
+ *
+ * Usage: etherlog-recover [--output <file>] <flight recorder file>
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_flight.h"
+#include "log_format.h"
+#include "platform_path.h"
+#include "platform_time.h"
+
+/**
+ * @brief Names a level as logger.c's log_level_to_string does.
+ */
+static const char *level_name(uint8_t level) {
+    switch ((LogLevel)level) {
+        case LOG_DEBUG: return "DEBUG";
+        case LOG_INFO: return  "INFO ";
+        case LOG_WARN: return  "WARN ";
+        case LOG_ERROR: return "ERROR";
+        case LOG_FATAL: return "FATAL";
+        default: return "UNKNN";
+    }
+}
+
+/**
+ * @brief Orders records by sequence.
+ */
+static int compare_sequence(const void *a, const void *b) {
+    uint64_t left = (*(const LogFlightRecord_T *const *)a)->sequence.value;
+    uint64_t right = (*(const LogFlightRecord_T *const *)b)->sequence.value;
+    return left < right ? -1 : left > right;
+}
+
+/**
+ * @brief Writes one record in the text layout.
+ */
+static void write_record(FILE *out, const LogFlightHeader_T *header, const LogFlightRecord_T *record) {
+    uint64_t time_ns = header->created_time_ns + record->elapsed_ns;
+    time_t seconds = (time_t)(time_ns / 1000000000ULL);
+    char date[32];
+    struct tm timeinfo;
+    platform_localtime(&seconds, &timeinfo);
+    strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", &timeinfo);
+
+    char text[LOG_MSG_BUFFER_SIZE];
+    size_t length = record->length < sizeof(record->data) ? record->length : sizeof(record->data);
+    if (record->deferred && record->format_length < length) {
+        // The format was copied with its terminator; the packed arguments follow
+        LogCallSite_T site = LOG_CALL_SITE_INIT;
+        const char *format = record->data;
+        if (log_format_prepare_site(&site, format)) {
+            log_format_render(&site, record->data + record->format_length + 1, text, sizeof(text));
+        } else {
+            snprintf(text, sizeof(text), "%s", format);
+        }
+    } else {
+        memcpy(text, record->data, length);
+        text[length] = '\0';
+    }
+
+    char label[LOG_FLIGHT_LABEL_SIZE + 1];
+    memcpy(label, record->thread_label, LOG_FLIGHT_LABEL_SIZE);
+    label[LOG_FLIGHT_LABEL_SIZE] = '\0';
+
+    fprintf(out, "%llu %s.%09llu %s: [%s] %s\n", (unsigned long long)(record->sequence.value - 1), date,
+            (unsigned long long)(time_ns % 1000000000ULL), level_name(record->level), label, text);
+}
+
+/**
+ * @brief Decodes a ring file.
+ * @return 0 on success, 1 if the file could not be read or is not a ring.
+ */
+static int recover_file(const char *file_name, FILE *out) {
+    FILE *fp = NULL;
+    if (platform_fopen(&fp, file_name, "rb") != PLATFORM_ERROR_SUCCESS || !fp) {
+        fprintf(stderr, "etherlog-recover: cannot read %s\n", file_name);
+        return 1;
+    }
+
+    LogFlightHeader_T header;
+    if (fread(&header, sizeof(header), 1, fp) != 1 || memcmp(header.magic, LOG_FLIGHT_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != LOG_FLIGHT_VERSION || header.record_size != LOG_FLIGHT_RECORD_SIZE) {
+        fprintf(stderr, "etherlog-recover: %s is not a flight recorder file\n", file_name);
+        fclose(fp);
+        return 1;
+    }
+
+    LogFlightRecord_T *records = malloc((size_t)header.record_count * sizeof(LogFlightRecord_T));
+    LogFlightRecord_T **order = malloc((size_t)header.record_count * sizeof(LogFlightRecord_T *));
+    size_t read = records ? fread(records, sizeof(LogFlightRecord_T), header.record_count, fp) : 0;
+    fclose(fp);
+    if (!records || !order) {
+        fprintf(stderr, "etherlog-recover: out of memory\n");
+        free(records);
+        free(order);
+        return 1;
+    }
+
+    // A record at sequence 0 was never written; a busy one was being written when the process died
+    size_t count = 0;
+    size_t partial = 0;
+    for (size_t i = 0; i < read; i++) {
+        if (records[i].sequence.value == LOG_FLIGHT_SEQUENCE_BUSY) {
+            partial++;
+        } else if (records[i].sequence.value != 0) {
+            order[count++] = &records[i];
+        }
+    }
+    qsort(order, count, sizeof(order[0]), compare_sequence);
+
+    fprintf(stderr, "etherlog-recover: %s: %s, %llu entries recorded, %zu recovered",
+            file_name, header.state == LOG_FLIGHT_STATE_CLOSED ? "closed cleanly" : "not closed (crash or still running)",
+            (unsigned long long)header.next_sequence.value, count);
+    if (partial > 0) {
+        fprintf(stderr, ", %zu part written", partial);
+    }
+    fputc('\n', stderr);
+
+    for (size_t i = 0; i < count; i++) {
+        write_record(out, &header, order[i]);
+    }
+
+    free(order);
+    free(records);
+    return 0;
+}
+
+static void print_usage(void) {
+    fprintf(stderr, "Usage: etherlog-recover [--output <file>] <flight recorder file>\n"
+                    "Writes the entries held in a flight recorder ring ([logger] flight_recorder),\n"
+                    "oldest first, in the text log layout with sequence numbers for indices.\n");
+}
+
+int main(int argc, char *argv[]) {
+    const char *output_name = NULL;
+    int first_file = 1;
+
+    for (; first_file < argc && argv[first_file][0] == '-'; first_file++) {
+        if (strcmp(argv[first_file], "--output") == 0 && first_file + 1 < argc) {
+            output_name = argv[++first_file];
+        } else {
+            print_usage();
+            return 2;
+        }
+    }
+    if (first_file != argc - 1) {
+        print_usage();
+        return 2;
+    }
+
+    FILE *out = stdout;
+    if (output_name && (platform_fopen(&out, output_name, "w") != PLATFORM_ERROR_SUCCESS || !out)) {
+        fprintf(stderr, "etherlog-recover: cannot create %s\n", output_name);
+        return 1;
+    }
+
+    int result = recover_file(argv[first_file], out);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    return result;
+}
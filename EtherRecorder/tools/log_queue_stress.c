@@ -0,0 +1,311 @@
+/**
+ * @file log_queue_stress.c
+ * @brief Stress test of the log queues with many producers and one consumer.
+ *
+ * Every producer pushes numbered entries whose message can be checked on
+ * arrival. The consumer takes them with log_queue_pop_merged, as the logger
+ * thread does, and checks that no entry is corrupted, reordered or
+ * duplicated, and that every entry is accounted for as popped or dropped.
+ * Enqueue latency is measured around each log_queue_submit.
+ *
+ * Usage: log_queue_stress [--producers <n>] [--entries <n>]
+ *                         [--policy block|drop_newest|drop_oldest] [--own-queues]
+ *                         [--close-consumer]
+ *
+ * --close-consumer stops consuming halfway and closes the consumer, as the
+ * logger thread does at shutdown; every producer must then still finish,
+ * with the entries it could not queue refused.
+ *
+ * Exits with 0 if every check passed.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log_queue.h"
+#include "logger.h"
+#include "platform_atomic.h"
+#include "platform_threads.h"
+#include "platform_time.h"
+#include "utils.h"
+
+#define STRESS_MAX_PRODUCERS 64
+#define STRESS_FILLER_SPAN 97  // Filler lengths cycle through this many values
+#define STRESS_CLOSE_TIMEOUT_MS 10000  // Longest producers may take to finish once the consumer closed
+
+typedef struct StressProducer {
+    uint32_t index;
+    uint32_t entries;
+    bool own_queue;
+    uint32_t *latency_ns;  // One sample per entry
+    uint32_t refused;      // Entries log_queue_submit refused
+} StressProducer;
+
+static PlatformAtomicUInt32 producers_done = {0};
+
+/**
+ * @brief Stands in for logger.c; the queue only uses it for its own warnings.
+ */
+void create_log_entry(LogEntry_T *entry, LogLevel level, const char *message) {
+    memset(entry, 0, sizeof(*entry));
+    entry->level = level;
+    platform_get_high_res_timestamp(&entry->timestamp);
+    snprintf(entry->message, sizeof(entry->message), "%s", message);
+    entry->message_length = (uint16_t)strlen(entry->message);
+}
+
+/**
+ * @brief Stands in for logger.c, printing the queue's warnings.
+ */
+void log_now(const LogEntry_T *entry) {
+    printf("queue: %s\n", entry->message);
+}
+
+/**
+ * @brief Writes the message of a producer's entry, whose filler depends on the sequence.
+ */
+static uint16_t format_message(char *message, size_t size, uint32_t producer, uint32_t sequence) {
+    int length = snprintf(message, size, "%u %u ", producer, sequence);
+    uint32_t filler = sequence % STRESS_FILLER_SPAN;
+    memset(message + length, 'a' + (int)(sequence % 26), filler);
+    message[length + filler] = '\0';
+    return (uint16_t)(length + filler);
+}
+
+static void *producer_thread(void *arg) {
+    StressProducer *producer = arg;
+    if (producer->own_queue) {
+        log_queue_attach_thread();
+    }
+
+    LogEntry_T entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.level = LOG_INFO;
+    snprintf(entry.thread_label, sizeof(entry.thread_label), "P%02u", producer->index);
+
+    for (uint32_t sequence = 0; sequence < producer->entries; sequence++) {
+        entry.message_length = format_message(entry.message, sizeof(entry.message), producer->index, sequence);
+
+        // The entry's own timestamp starts the measurement, as in log_queue_submit
+        PlatformHighResTimestamp_T queued;
+        platform_get_high_res_timestamp(&entry.timestamp);
+        if (!log_queue_submit(log_queue_for_thread(), &entry)) {
+            producer->refused++;
+        }
+        platform_get_high_res_timestamp(&queued);
+
+        uint64_t latency_ns = 0;
+        platform_timestamp_elapsed(&entry.timestamp, &queued, PLATFORM_TIME_GRANULARITY_NS, &latency_ns);
+        producer->latency_ns[sequence] = latency_ns > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_ns;
+    }
+
+    if (producer->own_queue) {
+        log_queue_detach_thread();
+    }
+    platform_atomic_fetch_add_uint32(&producers_done, 1);
+    return NULL;
+}
+
+/**
+ * @brief Checks a popped entry against what its producer wrote.
+ * @return The producer's index, or -1 if the entry is corrupted.
+ */
+static int check_entry(const LogEntry_T *entry, uint32_t producers, uint32_t *sequence) {
+    unsigned producer;
+    if (sscanf(entry->message, "%u %u ", &producer, sequence) != 2 || producer >= producers) {
+        return -1;
+    }
+    char expected[LOG_MSG_BUFFER_SIZE];
+    char label[THREAD_LABEL_SIZE];
+    uint16_t length = format_message(expected, sizeof(expected), producer, *sequence);
+    snprintf(label, sizeof(label), "P%02u", producer);
+    if (entry->message_length != length || strcmp(entry->message, expected) != 0 ||
+        strcmp(entry->thread_label, label) != 0 || entry->level != LOG_INFO) {
+        return -1;
+    }
+    return (int)producer;
+}
+
+static int compare_latency(const void *a, const void *b) {
+    uint32_t left = *(const uint32_t *)a;
+    uint32_t right = *(const uint32_t *)b;
+    return (left > right) - (left < right);
+}
+
+static uint32_t percentile(const uint32_t *sorted, uint64_t count, double fraction) {
+    uint64_t index = (uint64_t)((double)(count - 1) * fraction);
+    return sorted[index];
+}
+
+static bool parse_policy(const char *name, LogOverflowPolicy *policy) {
+    if (strcmp(name, "block") == 0) {
+        *policy = LOG_OVERFLOW_BLOCK;
+    } else if (strcmp(name, "drop_newest") == 0) {
+        *policy = LOG_OVERFLOW_DROP_NEWEST;
+    } else if (strcmp(name, "drop_oldest") == 0) {
+        *policy = LOG_OVERFLOW_DROP_OLDEST;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: log_queue_stress [--producers <n>] [--entries <n>]\n"
+                    "                        [--policy block|drop_newest|drop_oldest] [--own-queues]\n"
+                    "                        [--close-consumer]\n");
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t producers = 16;
+    uint32_t entries = 100000;  // Per producer
+    LogOverflowPolicy policy = LOG_OVERFLOW_BLOCK;
+    const char *policy_name = "block";
+    bool own_queues = false;
+    bool close_consumer = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--producers") == 0 && i + 1 < argc) {
+            producers = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--entries") == 0 && i + 1 < argc) {
+            entries = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--policy") == 0 && i + 1 < argc) {
+            policy_name = argv[++i];
+            if (!parse_policy(policy_name, &policy)) {
+                return usage();
+            }
+        } else if (strcmp(argv[i], "--own-queues") == 0) {
+            own_queues = true;
+        } else if (strcmp(argv[i], "--close-consumer") == 0) {
+            close_consumer = true;
+        } else {
+            return usage();
+        }
+    }
+    if (producers == 0 || producers > STRESS_MAX_PRODUCERS || entries == 0) {
+        return usage();
+    }
+
+    log_queue_set_overflow_policy(policy, NULL, 0);
+    if (!log_queue_init(&global_log_queue, LOG_QUEUE_SIZE, false)) {
+        fprintf(stderr, "Failed to allocate the log queue\n");
+        return 1;
+    }
+
+    uint64_t total = (uint64_t)producers * entries;
+    uint32_t *latency_ns = malloc(total * sizeof(uint32_t));
+    int64_t *next_sequence = calloc(producers, sizeof(int64_t));
+    StressProducer *producer_args = calloc(producers, sizeof(StressProducer));
+    if (!latency_ns || !next_sequence || !producer_args) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    PlatformHighResTimestamp_T start;
+    platform_get_high_res_timestamp(&start);
+    for (uint32_t i = 0; i < producers; i++) {
+        producer_args[i] = (StressProducer){ i, entries, own_queues, latency_ns + (uint64_t)i * entries, 0 };
+        PlatformThreadId thread_id;
+        if (platform_thread_create(&thread_id, NULL, producer_thread, &producer_args[i]) != PLATFORM_ERROR_SUCCESS) {
+            fprintf(stderr, "Failed to start producer %u\n", i);
+            return 1;
+        }
+    }
+
+    // Consume on this thread, as the logger thread would
+    uint64_t popped = 0;
+    uint64_t corrupted = 0;
+    uint64_t out_of_order = 0;
+    uint64_t gaps = 0;
+    bool closed = false;
+    bool hung = false;
+    LogEntry_T entry;
+    for (;;) {
+        if (close_consumer && !closed && popped == total / 2) {
+            // Stop taking entries, so producers overshoot a full queue, until they all finish
+            log_queue_close_consumer();
+            closed = true;
+            uint32_t closed_ms = get_time_ms();
+            while (platform_atomic_load_uint32(&producers_done) < producers) {
+                if (get_time_ms() - closed_ms > STRESS_CLOSE_TIMEOUT_MS) {
+                    hung = true;
+                    break;
+                }
+                sleep_ms(1);
+            }
+            if (hung) {
+                break;
+            }
+        }
+
+        // Read before popping: once all are done, an empty pop means drained
+        bool done = platform_atomic_load_uint32(&producers_done) == producers;
+        if (!log_queue_pop_merged(&entry)) {
+            if (done) {
+                break;
+            }
+            platform_thread_yield();
+            continue;
+        }
+        popped++;
+
+        uint32_t sequence;
+        int producer = check_entry(&entry, producers, &sequence);
+        if (producer < 0) {
+            if (corrupted++ < 5) {
+                fprintf(stderr, "Corrupted entry from '%s': '%.60s'\n", entry.thread_label, entry.message);
+            }
+            continue;
+        }
+        if ((int64_t)sequence < next_sequence[producer]) {
+            out_of_order++;
+        } else {
+            gaps += (uint64_t)sequence - (uint64_t)next_sequence[producer];
+            next_sequence[producer] = (int64_t)sequence + 1;
+        }
+    }
+
+    PlatformHighResTimestamp_T end;
+    uint64_t elapsed_ns = 0;
+    platform_get_high_res_timestamp(&end);
+    platform_timestamp_elapsed(&start, &end, PLATFORM_TIME_GRANULARITY_NS, &elapsed_ns);
+
+    uint64_t dropped_counts[LOG_QUEUE_LEVELS];
+    uint64_t dropped = log_queue_take_dropped(dropped_counts);
+    uint64_t refused = 0;
+    for (uint32_t i = 0; i < producers; i++) {
+        gaps += (uint64_t)entries - (uint64_t)next_sequence[i];  // Missing from the end
+        refused += producer_args[i].refused;
+    }
+    if (hung) {
+        // Producers are still running; leave the queue to them
+        printf("%u of %u producers still running %u ms after the consumer closed\nFAILED\n",
+               producers - platform_atomic_load_uint32(&producers_done), producers, STRESS_CLOSE_TIMEOUT_MS);
+        return 1;
+    }
+
+    qsort(latency_ns, total, sizeof(uint32_t), compare_latency);
+    printf("%u producers x %u entries, policy %s, %s\n", producers, entries, policy_name,
+           own_queues ? "own queues" : "shared queue");
+    printf("popped %llu, dropped %llu, refused %llu, missing %llu, corrupted %llu, out of order %llu\n",
+           (unsigned long long)popped, (unsigned long long)dropped, (unsigned long long)refused,
+           (unsigned long long)gaps,
+           (unsigned long long)corrupted, (unsigned long long)out_of_order);
+    printf("enqueue latency ns: p50 %u, p99 %u, p99.9 %u, max %u\n",
+           percentile(latency_ns, total, 0.50), percentile(latency_ns, total, 0.99),
+           percentile(latency_ns, total, 0.999), latency_ns[total - 1]);
+    printf("%.0f entries per second\n", elapsed_ns ? (double)popped * 1e9 / (double)elapsed_ns : 0.0);
+
+    // Every entry missing from the sequence must have been counted as dropped or refused
+    bool passed = corrupted == 0 && out_of_order == 0 && popped + dropped + refused == total &&
+                  gaps == dropped + refused && (policy != LOG_OVERFLOW_BLOCK || dropped == 0) &&
+                  (close_consumer || refused == 0);
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+
+    free(producer_args);
+    free(next_sequence);
+    free(latency_ns);
+    log_queue_destroy(&global_log_queue);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,341 @@
+/**
+ * @file message_queue_stress.c
+ * @brief Stress test of a message queue with many producers and consumers.
+ *
+ * Every message carries a tag naming its producer and sequence number, and
+ * content derived from the tag. Consumers check the content and mark each
+ * tag as seen, so a lost, duplicated or corrupted message is found. With a
+ * single consumer each producer's messages must also arrive in order.
+ *
+ * Usage: message_queue_stress [--producers <n>] [--consumers <n>] [--messages <n>]
+ *                             [--size <bytes>] [--capacity <n>] [--bytes <budget>]
+ *                             [--batch <n>] [--unpop]
+ *                             [--policy <name>] [--sample <n>] [--block-ms <ms>]
+ *
+ * --batch pushes and pops up to n messages at a time with the batch calls.
+ * --unpop, for a single consumer, hands the back half of every other batch
+ * back to the queue, as a send thread does with what it could not send.
+ * --policy makes producers offer messages under that overflow policy (block,
+ * drop_oldest, drop_newest or sample_1_in_n), as the relay does; every
+ * message missing must then be one the policy counted as dropped.
+ * --bytes gives the queue a byte budget, as the [queues] settings do, so
+ * messages over MESSAGE_QUEUE_COMPACT_INLINE bytes travel in pooled buffers.
+ * Exits with 0 if every check passed.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "message_types.h"
+#include "payload_pool.h"
+#include "platform_atomic.h"
+#include "platform_threads.h"
+#include "platform_time.h"
+
+#define STRESS_MAX_THREADS 64
+#define STRESS_TAG_SIZE sizeof(uint64_t)
+#define STRESS_PUSH_TIMEOUT_MS 10
+#define STRESS_POP_TIMEOUT_MS 10
+#define STRESS_BLOCK_TIMEOUT_MS 100  // Default wait of an offer under the block policy
+
+// Full queue timeouts are expected here; only fatal errors are printed
+static const uint8_t stress_log_level = LOG_FATAL;
+THREAD_LOCAL const volatile uint8_t *g_thread_log_level = &stress_log_level;
+bool g_trace_all = false;  // Read by the debug build's logging macros
+
+typedef struct StressConfig {
+    uint32_t producers;
+    uint32_t consumers;
+    uint32_t messages;  // Per producer
+    uint32_t size;      // Content bytes of each message
+    uint32_t batch;     // Messages pushed or popped at a time
+    bool unpop;         // Hand part of each other batch back
+    bool offer;         // Offer under the queue's overflow policy rather than push
+} StressConfig;
+
+static StressConfig config = { 4, 4, 250000, 64, 1, false, false };
+static MessageQueue_T queue;
+static PlatformAtomicUInt8 *seen;  // One flag per tag
+static PlatformAtomicUInt32 producers_done = {0};
+static PlatformAtomicUInt32 consumers_done = {0};
+static PlatformAtomicUInt64 popped = {0};
+static PlatformAtomicUInt64 duplicated = {0};
+static PlatformAtomicUInt64 corrupted = {0};
+static PlatformAtomicUInt64 out_of_order = {0};
+static uint64_t *next_sequence;  // Per producer, single consumer only
+
+/**
+ * @brief Stands in for logger.c, printing what the queue logs.
+ */
+void _logger_log_site(LogCallSite_T *site, LogLevel level, const char *format, ...) {
+    (void)site;
+    (void)level;
+    va_list args;
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+    fputc('\n', stderr);
+}
+
+/**
+ * @brief Writes a message's tag and the content derived from it.
+ */
+static void fill_message(Message_T *message, uint64_t tag) {
+    memset(message, 0, sizeof(message->header));
+    message->header.type = MSG_TYPE_RELAY;
+    message->header.content_size = config.size;
+    memcpy(message->content, &tag, STRESS_TAG_SIZE);
+    memset(message->content + STRESS_TAG_SIZE, (int)(tag % 251), config.size - STRESS_TAG_SIZE);
+}
+
+/**
+ * @brief Checks a popped message against its tag and marks the tag seen.
+ */
+static void check_message(const Message_T *message) {
+    const uint8_t *content = message_content(message);
+    uint64_t total = (uint64_t)config.producers * config.messages;
+    uint64_t tag;
+    memcpy(&tag, content, STRESS_TAG_SIZE);
+
+    bool intact = message->header.content_size == config.size && tag < total;
+    for (uint32_t i = STRESS_TAG_SIZE; intact && i < config.size; i++) {
+        intact = content[i] == (uint8_t)(tag % 251);
+    }
+    if (!intact) {
+        platform_atomic_fetch_add_uint64(&corrupted, 1);
+        return;
+    }
+
+    if (platform_atomic_exchange_uint8(&seen[tag], 1) != 0) {
+        platform_atomic_fetch_add_uint64(&duplicated, 1);
+    }
+    if (config.consumers == 1) {
+        uint64_t producer = tag / config.messages;
+        uint64_t sequence = tag % config.messages;
+        if (sequence < next_sequence[producer]) {
+            platform_atomic_fetch_add_uint64(&out_of_order, 1);
+        }
+        next_sequence[producer] = sequence + 1;
+    }
+}
+
+static void *producer_thread(void *arg) {
+    uint64_t first_tag = (uint64_t)(uintptr_t)arg * config.messages;
+    Message_T messages[MESSAGE_BATCH_MAX];
+    for (uint32_t i = 0; i < config.messages; i += config.batch) {
+        uint32_t count = config.messages - i < config.batch ? config.messages - i : config.batch;
+        for (uint32_t j = 0; j < count; j++) {
+            fill_message(&messages[j], first_tag + i + j);
+        }
+        if (config.offer) {
+            message_queue_offer(&queue, &messages[0]);  // Counted by the queue if dropped
+            continue;
+        }
+        // A consumer releasing a pooled buffer sets no event, so keep retrying
+        if (config.batch == 1) {
+            while (!message_queue_push(&queue, &messages[0], STRESS_PUSH_TIMEOUT_MS)) {
+            }
+            continue;
+        }
+        uint32_t pushed = 0;
+        while (pushed < count) {
+            pushed += message_queue_push_batch(&queue, messages + pushed, count - pushed, STRESS_PUSH_TIMEOUT_MS);
+        }
+    }
+    platform_atomic_fetch_add_uint32(&producers_done, 1);
+    return NULL;
+}
+
+static void *consumer_thread(void *arg) {
+    (void)arg;
+    Message_T messages[MESSAGE_BATCH_MAX];
+    uint64_t batches = 0;
+    for (;;) {
+        // Read before popping: once all are done, an empty queue stays empty
+        bool done = platform_atomic_load_uint32(&producers_done) == config.producers;
+        uint32_t count = config.batch == 1 ?
+                         (message_queue_pop(&queue, &messages[0], STRESS_POP_TIMEOUT_MS) ? 1 : 0) :
+                         message_queue_pop_batch(&queue, messages, config.batch, STRESS_POP_TIMEOUT_MS);
+        if (count == 0) {
+            if (done && message_queue_count(&queue) == 0) {
+                break;
+            }
+            continue;
+        }
+
+        // Hand the back half of every other batch back, to be popped again first
+        uint32_t kept = count;
+        uint32_t returned = 0;
+        if (config.unpop && count > 1 && batches++ % 2 == 0) {
+            kept = count / 2;
+            returned = message_queue_unpop(&queue, messages + kept, count - kept);
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (i < kept || i >= kept + returned) {
+                check_message(&messages[i]);
+                message_release(&messages[i]);
+            }
+        }
+        platform_atomic_fetch_add_uint64(&popped, count - returned);
+    }
+    platform_atomic_fetch_add_uint32(&consumers_done, 1);
+    return NULL;
+}
+
+static bool start_stress_threads(uint32_t count, PlatformThreadFunction function) {
+    for (uint32_t i = 0; i < count; i++) {
+        PlatformThreadId thread_id;
+        if (platform_thread_create(&thread_id, NULL, function, (void *)(uintptr_t)i) != PLATFORM_ERROR_SUCCESS) {
+            fprintf(stderr, "Failed to start thread %u\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Takes every free buffer from the pool and gives them back.
+ * @return How many there were; all of them once no message holds one
+ */
+static uint32_t count_free_payloads(void) {
+    uint32_t count = payload_pool_count();
+    PayloadHandle *handles = malloc((count + 1) * sizeof(PayloadHandle));
+    uint32_t taken = 0;
+    while (handles && taken <= count && (handles[taken] = payload_acquire()) != PAYLOAD_NONE) {
+        taken++;
+    }
+    for (uint32_t i = 0; i < taken; i++) {
+        payload_release(handles[i]);
+    }
+    free(handles);
+    return taken;
+}
+
+static int usage(void) {
+    fprintf(stderr, "Usage: message_queue_stress [--producers <n>] [--consumers <n>] [--messages <n>]\n"
+                    "                            [--size <bytes>] [--capacity <n>] [--bytes <budget>]\n"
+                    "                            [--batch <n>] [--unpop]\n"
+                    "                            [--policy <name>] [--sample <n>] [--block-ms <ms>]\n");
+    return 2;
+}
+
+int main(int argc, char *argv[]) {
+    uint32_t capacity = MESSAGE_QUEUE_DEFAULT_CAPACITY;
+    size_t max_bytes = 0;
+    QueueOverflowPolicy policy = QUEUE_OVERFLOW_BLOCK;
+    uint32_t sample_interval = 10;
+    uint32_t block_timeout_ms = STRESS_BLOCK_TIMEOUT_MS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--unpop") == 0) {
+            config.unpop = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return usage();
+        }
+        unsigned long value = strtoul(argv[i + 1], NULL, 10);
+        if (strcmp(argv[i], "--producers") == 0) {
+            config.producers = (uint32_t)value;
+        } else if (strcmp(argv[i], "--consumers") == 0) {
+            config.consumers = (uint32_t)value;
+        } else if (strcmp(argv[i], "--messages") == 0) {
+            config.messages = (uint32_t)value;
+        } else if (strcmp(argv[i], "--size") == 0) {
+            config.size = (uint32_t)value;
+        } else if (strcmp(argv[i], "--capacity") == 0) {
+            capacity = (uint32_t)value;
+        } else if (strcmp(argv[i], "--bytes") == 0) {
+            max_bytes = (size_t)value;
+        } else if (strcmp(argv[i], "--batch") == 0) {
+            config.batch = (uint32_t)value;
+        } else if (strcmp(argv[i], "--policy") == 0) {
+            policy = queue_overflow_policy_from_string(argv[i + 1], QUEUE_OVERFLOW_POLICY_COUNT);
+            config.offer = true;
+        } else if (strcmp(argv[i], "--sample") == 0) {
+            sample_interval = (uint32_t)value;
+        } else if (strcmp(argv[i], "--block-ms") == 0) {
+            block_timeout_ms = (uint32_t)value;
+        } else {
+            return usage();
+        }
+        i++;
+    }
+    if (config.producers == 0 || config.producers > STRESS_MAX_THREADS || config.consumers == 0 ||
+        config.consumers > STRESS_MAX_THREADS || config.messages == 0 || config.size < STRESS_TAG_SIZE ||
+        config.size > MESSAGE_CONTENT_SIZE || config.batch == 0 || config.batch > MESSAGE_BATCH_MAX ||
+        (config.unpop && config.consumers != 1) || policy == QUEUE_OVERFLOW_POLICY_COUNT ||
+        (config.offer && config.batch != 1)) {
+        return usage();
+    }
+
+    // Pooled buffers for the budget, as main sizes the pool from [queues]
+    if (!payload_pool_init((uint32_t)(max_bytes / PAYLOAD_BUFFER_SIZE)) ||
+        !message_queue_init(&queue, capacity, max_bytes, "STRESS")) {
+        fprintf(stderr, "Failed to set up the queue\n");
+        return 1;
+    }
+    message_queue_set_overflow(&queue, policy, block_timeout_ms, sample_interval);
+
+    uint64_t total = (uint64_t)config.producers * config.messages;
+    seen = calloc((size_t)total, sizeof(PlatformAtomicUInt8));
+    next_sequence = calloc(config.producers, sizeof(uint64_t));
+    if (!seen || !next_sequence) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    PlatformHighResTimestamp_T start;
+    platform_get_high_res_timestamp(&start);
+    if (!start_stress_threads(config.consumers, consumer_thread) ||
+        !start_stress_threads(config.producers, producer_thread)) {
+        return 1;
+    }
+    while (platform_atomic_load_uint32(&consumers_done) < config.consumers) {
+        sleep_ms(1);
+    }
+    PlatformHighResTimestamp_T end;
+    uint64_t elapsed_ns = 0;
+    platform_get_high_res_timestamp(&end);
+    platform_timestamp_elapsed(&start, &end, PLATFORM_TIME_GRANULARITY_NS, &elapsed_ns);
+
+    uint64_t missing = 0;
+    for (uint64_t tag = 0; tag < total; tag++) {
+        missing += platform_atomic_load_uint8(&seen[tag]) == 0;
+    }
+    uint64_t dropped = 0;
+    for (int i = 0; i < QUEUE_OVERFLOW_POLICY_COUNT; i++) {
+        dropped += message_queue_dropped(&queue, (QueueOverflowPolicy)i);
+    }
+    message_queue_destroy(&queue);
+    uint32_t free_payloads = count_free_payloads();
+    uint64_t popped_count = platform_atomic_load_uint64(&popped);
+
+    printf("%u producers, %u consumers, %u messages each of %u bytes, capacity %u, byte budget %zu\n",
+           config.producers, config.consumers, config.messages, config.size, capacity, max_bytes);
+    printf("batches of %u%s\n", config.batch, config.unpop ? ", half of every other handed back" : "");
+    if (config.offer) {
+        printf("offered under %s\n", queue_overflow_policy_to_string(policy));
+    }
+    printf("popped %llu, dropped %llu, missing %llu, duplicated %llu, corrupted %llu, out of order %llu\n",
+           (unsigned long long)popped_count, (unsigned long long)dropped, (unsigned long long)missing,
+           (unsigned long long)platform_atomic_load_uint64(&duplicated),
+           (unsigned long long)platform_atomic_load_uint64(&corrupted),
+           (unsigned long long)platform_atomic_load_uint64(&out_of_order));
+    printf("payload buffers free %u of %u\n", free_payloads, payload_pool_count());
+    printf("%.0f messages per second\n", elapsed_ns ? (double)popped_count * 1e9 / (double)elapsed_ns : 0.0);
+
+    // Every message missing must have been counted as dropped
+    bool passed = missing == dropped && popped_count + dropped == total &&
+                  platform_atomic_load_uint64(&duplicated) == 0 &&
+                  platform_atomic_load_uint64(&corrupted) == 0 && platform_atomic_load_uint64(&out_of_order) == 0 &&
+                  free_payloads == payload_pool_count();
+    printf("%s\n", passed ? "PASSED" : "FAILED");
+
+    free(next_sequence);
+    free(seen);
+    payload_pool_cleanup();
+    return passed ? 0 : 1;
+}
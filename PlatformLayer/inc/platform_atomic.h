@@ -224,6 +224,16 @@ uint32_t platform_atomic_fetch_add_uint32(PlatformAtomicUInt32* atomic, uint32_t
 int64_t  platform_atomic_fetch_add_int64(PlatformAtomicInt64* atomic, int64_t value);
 uint64_t platform_atomic_fetch_add_uint64(PlatformAtomicUInt64* atomic, uint64_t value);
 
+/**
+ * @brief Load and store with an explicit memory order
+ *
+ * The operations above are all sequentially consistent. These take the
+ * ordering the caller needs, so an acquire load or a release store costs no
+ * more than a plain move on x86-64.
+ */
+uint64_t platform_atomic_load_uint64_explicit(const PlatformAtomicUInt64* atomic, PlatformMemoryOrder order);
+void platform_atomic_store_uint64_explicit(PlatformAtomicUInt64* atomic, uint64_t value, PlatformMemoryOrder order);
+
 /**
  * @brief Memory fence operation
  */
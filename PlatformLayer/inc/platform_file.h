@@ -7,6 +7,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include "platform_error.h"
 
 // Opaque file handle
@@ -78,4 +79,133 @@ PlatformErrorCode platform_file_get_size(
  */
 void platform_file_close(PlatformFileHandle handle);
 
+// Opaque memory-mapped file handle
+typedef struct PlatformFileMapping* PlatformFileMappingHandle;
+
+/**
+ * @brief Creates a file of the given size and maps it into memory
+ *
+ * An existing file is truncated. Disk space for the whole file is reserved
+ * up front where the platform supports it. The mapping is shared with the
+ * file and starts zeroed, so stores to it reach the file without further calls.
+ *
+ * @param filepath Path to the file
+ * @param size Size of the file and of the mapping in bytes
+ * @param address Receives the address of the mapping
+ * @param error_code Optional pointer to receive error code
+ * @return PlatformFileMappingHandle NULL if failed
+ */
+PlatformFileMappingHandle platform_file_map_create(
+    const char* filepath,
+    size_t size,
+    void** address,
+    PlatformErrorCode* error_code
+);
+
+/**
+ * @brief Unmaps a memory-mapped file and closes it; the file is kept
+ * 
+ * @param mapping Mapping handle
+ */
+void platform_file_map_close(PlatformFileMappingHandle mapping);
+
+/**
+ * @brief Starts writing a range of a mapping out to its file
+ *
+ * Does not wait for the write to complete.
+ *
+ * @param mapping Mapping handle
+ * @param offset Start of the range in bytes
+ * @param length Length of the range in bytes
+ * @return true if the write-out was started
+ */
+bool platform_file_map_sync(PlatformFileMappingHandle mapping, size_t offset, size_t length);
+
+/**
+ * @brief Unmaps a memory-mapped file and closes it, cutting the file to the given size
+ *
+ * Used when only the start of a preallocated file was filled.
+ *
+ * @param mapping Mapping handle
+ * @param file_size Size to leave the file at
+ * @return true if the file was cut to size
+ */
+bool platform_file_map_close_at(PlatformFileMappingHandle mapping, size_t file_size);
+
+// Opaque asynchronous file writer handle
+typedef struct PlatformFileWriter* PlatformFileWriterHandle;
+
+/**
+ * @brief Opens a file for appending through a set of write buffers
+ *
+ * Each buffer is handed to the disk when it fills or is flushed, and is
+ * written out while the caller goes on filling the next. On Linux the
+ * buffers go through io_uring; where io_uring is unavailable, and on other
+ * platforms, a flushed buffer is written out before the call returns.
+ * A writer is used by one thread at a time.
+ *
+ * @param filepath Path to the file, created if missing
+ * @param truncate true to empty an existing file, false to append to it
+ * @param buffer_size Size of each write buffer in bytes
+ * @param buffer_count Number of write buffers, and so of writes in flight
+ * @param error_code Optional pointer to receive error code
+ * @return PlatformFileWriterHandle NULL if failed
+ */
+PlatformFileWriterHandle platform_file_writer_open(
+    const char* filepath,
+    bool truncate,
+    size_t buffer_size,
+    unsigned buffer_count,
+    PlatformErrorCode* error_code
+);
+
+/**
+ * @brief Copies bytes into the current write buffer
+ *
+ * A buffer that fills is handed to the disk. Waits only if every buffer is
+ * still being written.
+ *
+ * @param writer Writer handle
+ * @param data Bytes to write
+ * @param length Number of bytes
+ * @return PlatformErrorCode PLATFORM_ERROR_FILE_WRITE if an earlier write failed
+ */
+PlatformErrorCode platform_file_writer_write(PlatformFileWriterHandle writer, const void* data, size_t length);
+
+/**
+ * @brief Hands the current write buffer to the disk, if it holds anything
+ *
+ * Does not wait for the write to complete.
+ *
+ * @param writer Writer handle
+ * @param sync true to have the file's data flushed to the device once
+ *             every write handed over so far is done
+ * @return PlatformErrorCode PLATFORM_ERROR_FILE_WRITE if an earlier write failed
+ */
+PlatformErrorCode platform_file_writer_flush(PlatformFileWriterHandle writer, bool sync);
+
+/**
+ * @brief Size of the file including every byte written to the writer so far
+ *
+ * @param writer Writer handle
+ * @return Size in bytes
+ */
+uint64_t platform_file_writer_size(PlatformFileWriterHandle writer);
+
+/**
+ * @brief Whether the writer's buffers are written without blocking the caller
+ *
+ * @param writer Writer handle
+ * @return true for io_uring, false for the blocking fallback
+ */
+bool platform_file_writer_is_async(PlatformFileWriterHandle writer);
+
+/**
+ * @brief Writes out what is buffered, waits for every write and closes the file
+ *
+ * @param writer Writer handle
+ * @return PlatformErrorCode PLATFORM_ERROR_FILE_WRITE if any write failed
+ */
+PlatformErrorCode platform_file_writer_close(PlatformFileWriterHandle writer);
+
 #endif // PLATFORM_FILE_H
\ No newline at end of file
@@ -193,6 +193,18 @@ PlatformErrorCode platform_socket_get_stats(
     PlatformSocketHandle handle,
     PlatformSocketStats* stats);
 
+/**
+ * @brief Get the local and remote addresses of a connected socket
+ * @param[in] handle Socket handle
+ * @param[out] local Pointer to store the local address (optional)
+ * @param[out] remote Pointer to store the peer's address (optional)
+ * @return PlatformErrorCode indicating success or failure
+ */
+PlatformErrorCode platform_socket_get_endpoints(
+    PlatformSocketHandle handle,
+    PlatformSocketAddress* local,
+    PlatformSocketAddress* remote);
+
 /**
  * @brief Get string representation of socket error
  * @param[in] error_code Error code from PlatformErrorCode
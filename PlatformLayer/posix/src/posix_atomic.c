@@ -83,6 +83,15 @@ void platform_atomic_store_uint32(PlatformAtomicUInt32* atomic, uint32_t value)
     atomic_store((_Atomic uint32_t*)&atomic->value, value);
 }
 
+// 64-bit store
+void platform_atomic_store_int64(PlatformAtomicInt64* atomic, int64_t value) {
+    atomic_store((_Atomic int64_t*)&atomic->value, value);
+}
+
+void platform_atomic_store_uint64(PlatformAtomicUInt64* atomic, uint64_t value) {
+    atomic_store((_Atomic uint64_t*)&atomic->value, value);
+}
+
 // Load operations
 // 8-bit load
 int8_t platform_atomic_load_int8(const PlatformAtomicInt8* atomic) {
@@ -302,6 +311,15 @@ uint64_t platform_atomic_fetch_add_uint64(PlatformAtomicUInt64* atomic, uint64_t
     return atomic_fetch_add((_Atomic uint64_t*)&atomic->value, value);
 }
 
+// Explicitly ordered load and store
+uint64_t platform_atomic_load_uint64_explicit(const PlatformAtomicUInt64* atomic, PlatformMemoryOrder order) {
+    return atomic_load_explicit((_Atomic uint64_t*)&atomic->value, (memory_order)order);
+}
+
+void platform_atomic_store_uint64_explicit(PlatformAtomicUInt64* atomic, uint64_t value, PlatformMemoryOrder order) {
+    atomic_store_explicit((_Atomic uint64_t*)&atomic->value, value, (memory_order)order);
+}
+
 // Memory fence operation
 void platform_atomic_thread_fence(PlatformMemoryOrder order) {
     atomic_thread_fence(order);
@@ -1,14 +1,60 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  // syscall() is only declared with it under strict C17
+#endif
+
 #include "platform_file.h"
+#include <stdlib.h>
+#include <string.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
 #include <errno.h>
 
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <stdatomic.h>
+#include <sys/syscall.h>
+#define PLATFORM_FILE_IO_URING 1
+#endif
+
 struct PlatformFile {
     int fd;
     bool is_valid;
 };
 
+struct PlatformFileMapping {
+    int fd;
+    void* address;
+    size_t size;
+};
+
+/**
+ * Reserves disk blocks for the first size bytes of a file, so stores to a
+ * mapping of it neither allocate blocks nor fault on a full disk.
+ * Returns false only if the disk is full; where the platform or file system
+ * cannot preallocate, the blocks are allocated as pages are written.
+ */
+static bool preallocate_file(int fd, size_t size) {
+#if defined(__APPLE__)
+    fstore_t store = { F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, (off_t)size, 0 };
+    if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+        store.fst_flags = F_ALLOCATEALL;
+        if (fcntl(fd, F_PREALLOCATE, &store) == -1) {
+            return errno != ENOSPC;
+        }
+    }
+    return true;
+#elif defined(__linux__)
+    return posix_fallocate(fd, 0, (off_t)size) != ENOSPC;
+#else
+    (void)fd;
+    (void)size;
+    return true;
+#endif
+}
+
 static int get_posix_flags(PlatformFileAccess access, PlatformFileShare share) {
     int flags = 0;
     
@@ -123,4 +169,548 @@ void platform_file_close(PlatformFileHandle handle) {
         handle->is_valid = false;
         free(handle);
     }
-}
\ No newline at end of file
+}
+
+PlatformFileMappingHandle platform_file_map_create(
+    const char* filepath,
+    size_t size,
+    void** address,
+    PlatformErrorCode* error_code
+) {
+    if (!filepath || size == 0 || !address) {
+        if (error_code) *error_code = PLATFORM_ERROR_INVALID_ARGUMENT;
+        return NULL;
+    }
+
+    PlatformFileMappingHandle mapping = malloc(sizeof(struct PlatformFileMapping));
+    if (!mapping) {
+        if (error_code) *error_code = PLATFORM_ERROR_OUT_OF_MEMORY;
+        return NULL;
+    }
+
+    mapping->fd = open(filepath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (mapping->fd == -1) {
+        free(mapping);
+        if (error_code) *error_code = PLATFORM_ERROR_FILE_OPEN;
+        return NULL;
+    }
+
+    // A freshly extended file reads as zeros
+    if (!preallocate_file(mapping->fd, size) || ftruncate(mapping->fd, (off_t)size) == -1) {
+        close(mapping->fd);
+        free(mapping);
+        if (error_code) *error_code = PLATFORM_ERROR_FILE_WRITE;
+        return NULL;
+    }
+
+    mapping->address = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, mapping->fd, 0);
+    if (mapping->address == MAP_FAILED) {
+        close(mapping->fd);
+        free(mapping);
+        if (error_code) *error_code = PLATFORM_ERROR_OUT_OF_MEMORY;
+        return NULL;
+    }
+
+    mapping->size = size;
+    *address = mapping->address;
+    if (error_code) *error_code = PLATFORM_ERROR_SUCCESS;
+    return mapping;
+}
+
+void platform_file_map_close(PlatformFileMappingHandle mapping) {
+    if (mapping) {
+        munmap(mapping->address, mapping->size);
+        close(mapping->fd);
+        free(mapping);
+    }
+}
+
+bool platform_file_map_sync(PlatformFileMappingHandle mapping, size_t offset, size_t length) {
+    if (!mapping || offset >= mapping->size) {
+        return false;
+    }
+    if (length > mapping->size - offset) {
+        length = mapping->size - offset;
+    }
+
+    // msync wants a page aligned start
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = offset - offset % page_size;
+    return msync((char*)mapping->address + start, length + (offset - start), MS_ASYNC) == 0;
+}
+
+bool platform_file_map_close_at(PlatformFileMappingHandle mapping, size_t file_size) {
+    if (!mapping) {
+        return false;
+    }
+    munmap(mapping->address, mapping->size);
+    bool truncated = ftruncate(mapping->fd, (off_t)file_size) == 0;
+    close(mapping->fd);
+    free(mapping);
+    return truncated;
+}
+
+#define WRITER_SYNC_TAG UINT64_MAX  // user_data of a linked fsync
+
+// One write buffer of a file writer
+typedef struct WriterBuffer {
+    char* data;
+    size_t used;
+    uint64_t offset;  // where in the file the buffer is being written
+    bool in_flight;   // handed to io_uring, not yet completed
+} WriterBuffer;
+
+#if PLATFORM_FILE_IO_URING
+// The shared rings of an io_uring instance
+typedef struct WriterRing {
+    int fd;
+    unsigned entries;
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    struct io_uring_sqe* sqes;
+    _Atomic unsigned* sq_head;
+    _Atomic unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned* sq_array;
+    _Atomic unsigned* cq_head;
+    _Atomic unsigned* cq_tail;
+    unsigned cq_mask;
+    struct io_uring_cqe* cqes;
+    unsigned pending;         // queued in the submission ring, not yet published
+    unsigned in_flight;       // published, completion not yet reaped
+    bool fixed_buffers;       // buffers registered with the ring
+} WriterRing;
+#endif
+
+struct PlatformFileWriter {
+    int fd;
+    uint64_t offset;          // file offset of the next buffer handed over
+    uint64_t size;            // offset plus what the current buffer holds
+    size_t buffer_size;
+    unsigned buffer_count;
+    unsigned current;         // buffer being filled
+    WriterBuffer* buffers;
+    bool failed;              // a write has failed; reported by every later call
+#if PLATFORM_FILE_IO_URING
+    bool has_ring;            // io_uring instance set up
+    bool async;               // buffers go through the ring rather than pwrite
+    WriterRing ring;
+#endif
+};
+
+/**
+ * Writes a whole range with pwrite, carrying on after short writes.
+ */
+static bool write_all_at(int fd, const char* data, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t written = pwrite(fd, data, length, (off_t)offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        length -= (size_t)written;
+        offset += (uint64_t)written;
+    }
+    return true;
+}
+
+#if PLATFORM_FILE_IO_URING
+/**
+ * Sets up an io_uring instance with room for a write and an fsync per buffer.
+ * Returns false where io_uring is missing or not permitted, as in many containers.
+ */
+static bool ring_open(WriterRing* ring, unsigned entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return false;
+    }
+
+    ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_map = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_map && ring->cq_map_size > ring->sq_map_size) {
+        ring->sq_map_size = ring->cq_map_size;
+    }
+
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED) {
+        close(ring->fd);
+        return false;
+    }
+    ring->cq_map = ring->sq_map;
+    if (!single_map) {
+        ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_map == MAP_FAILED) {
+            munmap(ring->sq_map, ring->sq_map_size);
+            close(ring->fd);
+            return false;
+        }
+    }
+    ring->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (!single_map) {
+            munmap(ring->cq_map, ring->cq_map_size);
+        }
+        munmap(ring->sq_map, ring->sq_map_size);
+        close(ring->fd);
+        return false;
+    }
+
+    char* sq = ring->sq_map;
+    char* cq = ring->cq_map;
+    ring->entries = params.sq_entries;
+    ring->sq_head = (_Atomic unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (_Atomic unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head = (_Atomic unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (_Atomic unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    ring->pending = 0;
+    ring->in_flight = 0;
+    ring->fixed_buffers = false;
+    return true;
+}
+
+static void ring_close(WriterRing* ring) {
+    munmap(ring->sqes, ring->entries * sizeof(struct io_uring_sqe));
+    if (ring->cq_map != ring->sq_map) {
+        munmap(ring->cq_map, ring->cq_map_size);
+    }
+    munmap(ring->sq_map, ring->sq_map_size);
+    close(ring->fd);
+}
+
+/**
+ * Takes the next free submission entry, cleared. The ring has room for every
+ * buffer's write and fsync, so one is always free.
+ */
+static struct io_uring_sqe* ring_get_sqe(WriterRing* ring) {
+    unsigned tail = atomic_load_explicit(ring->sq_tail, memory_order_relaxed) + ring->pending;
+    unsigned index = tail & ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->pending++;
+    return sqe;
+}
+
+/**
+ * Publishes the queued entries to the kernel and enters the ring, waiting
+ * for at least wait_for completions.
+ */
+static bool ring_enter(WriterRing* ring, unsigned wait_for) {
+    unsigned tail = atomic_load_explicit(ring->sq_tail, memory_order_relaxed);
+    if (ring->pending > 0) {
+        tail += ring->pending;
+        atomic_store_explicit(ring->sq_tail, tail, memory_order_release);
+        ring->in_flight += ring->pending;
+        ring->pending = 0;
+    }
+    for (;;) {
+        // Anything the kernel left in the ring last time goes along too
+        unsigned to_submit = tail - atomic_load_explicit(ring->sq_head, memory_order_acquire);
+        if (to_submit == 0 && wait_for == 0) {
+            return true;
+        }
+        long result = syscall(__NR_io_uring_enter, ring->fd, to_submit, wait_for,
+                              wait_for > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (result >= 0) {
+            return true;
+        }
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+}
+
+/**
+ * Takes every completion the kernel has posted, freeing the buffers whose
+ * writes are done. A short write is finished with pwrite.
+ */
+static void ring_reap(PlatformFileWriterHandle writer) {
+    WriterRing* ring = &writer->ring;
+    unsigned head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(ring->cq_tail, memory_order_acquire);
+    for (; head != tail; head++) {
+        const struct io_uring_cqe* cqe = &ring->cqes[head & ring->cq_mask];
+        ring->in_flight--;
+        if (cqe->user_data == WRITER_SYNC_TAG) {
+            // -ECANCELED: the write it was linked to failed and is reported itself
+            if (cqe->res < 0 && cqe->res != -ECANCELED) {
+                writer->failed = true;
+            }
+            continue;
+        }
+
+        WriterBuffer* buffer = &writer->buffers[cqe->user_data];
+        if (cqe->res < 0) {
+            writer->failed = true;
+        } else if ((size_t)cqe->res < buffer->used &&
+                   !write_all_at(writer->fd, buffer->data + cqe->res, buffer->used - (size_t)cqe->res,
+                                 buffer->offset + (uint64_t)cqe->res)) {
+            writer->failed = true;
+        }
+        buffer->used = 0;
+        buffer->in_flight = false;
+    }
+    atomic_store_explicit(ring->cq_head, head, memory_order_release);
+}
+
+/**
+ * Queues an fsync of the file's data. It is drained: it starts only once
+ * every write handed over before it has completed.
+ */
+static void ring_queue_sync(PlatformFileWriterHandle writer) {
+    struct io_uring_sqe* sqe = ring_get_sqe(&writer->ring);
+    sqe->opcode = IORING_OP_FSYNC;
+    sqe->fd = writer->fd;
+    sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+    sqe->flags = IOSQE_IO_DRAIN;
+    sqe->user_data = WRITER_SYNC_TAG;
+}
+
+/**
+ * Queues a write of a buffer at its file offset, with a linked fsync after
+ * it if asked.
+ */
+static void ring_queue_write(PlatformFileWriterHandle writer, unsigned index, bool sync) {
+    WriterBuffer* buffer = &writer->buffers[index];
+    struct io_uring_sqe* sqe = ring_get_sqe(&writer->ring);
+    sqe->opcode = writer->ring.fixed_buffers ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+    sqe->fd = writer->fd;
+    sqe->off = buffer->offset;
+    sqe->addr = (uint64_t)(uintptr_t)buffer->data;
+    sqe->len = (uint32_t)buffer->used;
+    sqe->buf_index = (uint16_t)index;
+    sqe->user_data = index;
+    buffer->in_flight = true;
+    if (sync) {
+        sqe->flags = IOSQE_IO_LINK;
+        ring_queue_sync(writer);
+    }
+}
+
+/**
+ * Gives up on io_uring after the kernel refused to take entries: the data in
+ * the buffers is lost and reported as a failed write, and from here on
+ * buffers are written with pwrite.
+ */
+static void ring_abandon(PlatformFileWriterHandle writer) {
+    writer->failed = true;
+    writer->async = false;
+    for (unsigned i = 0; i < writer->buffer_count; i++) {
+        writer->buffers[i].used = 0;
+        writer->buffers[i].in_flight = false;
+    }
+}
+#endif
+
+/**
+ * Hands the current buffer to the disk and moves on to the next one,
+ * waiting for it if it is still being written.
+ */
+static void writer_submit_current(PlatformFileWriterHandle writer, bool sync) {
+    WriterBuffer* buffer = &writer->buffers[writer->current];
+    buffer->offset = writer->offset;
+    writer->offset += buffer->used;
+
+#if PLATFORM_FILE_IO_URING
+    if (writer->async) {
+        if (buffer->used == 0) {
+            ring_queue_sync(writer);
+        } else {
+            ring_queue_write(writer, writer->current, sync);
+            writer->current = (writer->current + 1) % writer->buffer_count;
+        }
+        if (!ring_enter(&writer->ring, 0)) {
+            ring_abandon(writer);
+            return;
+        }
+
+        ring_reap(writer);
+        while (writer->buffers[writer->current].in_flight) {
+            if (!ring_enter(&writer->ring, 1)) {
+                ring_abandon(writer);
+                return;
+            }
+            ring_reap(writer);
+        }
+        return;
+    }
+#endif
+
+    if (buffer->used > 0 && !write_all_at(writer->fd, buffer->data, buffer->used, buffer->offset)) {
+        writer->failed = true;
+    }
+    buffer->used = 0;
+    if (sync && fdatasync(writer->fd) != 0) {
+        writer->failed = true;
+    }
+}
+
+PlatformFileWriterHandle platform_file_writer_open(
+    const char* filepath,
+    bool truncate,
+    size_t buffer_size,
+    unsigned buffer_count,
+    PlatformErrorCode* error_code
+) {
+    if (!filepath || buffer_size == 0 || buffer_size > UINT32_MAX || buffer_count == 0) {
+        if (error_code) *error_code = PLATFORM_ERROR_INVALID_ARGUMENT;
+        return NULL;
+    }
+
+    PlatformFileWriterHandle writer = calloc(1, sizeof(struct PlatformFileWriter));
+    WriterBuffer* buffers = calloc(buffer_count, sizeof(WriterBuffer));
+    if (!writer || !buffers) {
+        free(writer);
+        free(buffers);
+        if (error_code) *error_code = PLATFORM_ERROR_OUT_OF_MEMORY;
+        return NULL;
+    }
+    writer->fd = -1;
+    writer->buffers = buffers;
+    writer->buffer_size = buffer_size;
+    writer->buffer_count = buffer_count;
+
+    // Page aligned, as the kernel pins registered buffers by the page
+    size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+    for (unsigned i = 0; i < buffer_count; i++) {
+        void* data = NULL;
+        if (posix_memalign(&data, page_size, buffer_size) != 0) {
+            platform_file_writer_close(writer);
+            if (error_code) *error_code = PLATFORM_ERROR_OUT_OF_MEMORY;
+            return NULL;
+        }
+        buffers[i].data = data;
+    }
+
+    writer->fd = open(filepath, O_WRONLY | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+    if (writer->fd == -1) {
+        platform_file_writer_close(writer);
+        if (error_code) *error_code = PLATFORM_ERROR_FILE_OPEN;
+        return NULL;
+    }
+    off_t end = lseek(writer->fd, 0, SEEK_END);
+    writer->offset = end > 0 ? (uint64_t)end : 0;
+    writer->size = writer->offset;
+
+#if PLATFORM_FILE_IO_URING
+    writer->has_ring = ring_open(&writer->ring, buffer_count * 2);
+    writer->async = writer->has_ring;
+    if (writer->async) {
+        // Fixed buffers save the kernel mapping each write's pages; without
+        // them, as when over the locked memory limit, plain writes do
+        struct iovec* iovecs = malloc(buffer_count * sizeof(struct iovec));
+        if (iovecs) {
+            for (unsigned i = 0; i < buffer_count; i++) {
+                iovecs[i].iov_base = buffers[i].data;
+                iovecs[i].iov_len = buffer_size;
+            }
+            writer->ring.fixed_buffers =
+                syscall(__NR_io_uring_register, writer->ring.fd, IORING_REGISTER_BUFFERS, iovecs, buffer_count) == 0;
+            free(iovecs);
+        }
+    }
+#endif
+
+    if (error_code) *error_code = PLATFORM_ERROR_SUCCESS;
+    return writer;
+}
+
+PlatformErrorCode platform_file_writer_write(PlatformFileWriterHandle writer, const void* data, size_t length) {
+    if (!writer || (!data && length > 0)) {
+        return PLATFORM_ERROR_INVALID_ARGUMENT;
+    }
+
+    const char* bytes = data;
+    while (length > 0) {
+        WriterBuffer* buffer = &writer->buffers[writer->current];
+        size_t room = writer->buffer_size - buffer->used;
+        size_t chunk = length < room ? length : room;
+        memcpy(buffer->data + buffer->used, bytes, chunk);
+        buffer->used += chunk;
+        writer->size += chunk;
+        bytes += chunk;
+        length -= chunk;
+        if (buffer->used == writer->buffer_size) {
+            writer_submit_current(writer, false);
+        }
+    }
+    return writer->failed ? PLATFORM_ERROR_FILE_WRITE : PLATFORM_ERROR_SUCCESS;
+}
+
+PlatformErrorCode platform_file_writer_flush(PlatformFileWriterHandle writer, bool sync) {
+    if (!writer) {
+        return PLATFORM_ERROR_INVALID_ARGUMENT;
+    }
+    if (writer->buffers[writer->current].used > 0 || sync) {
+        writer_submit_current(writer, sync);
+    }
+#if PLATFORM_FILE_IO_URING
+    if (writer->async) {
+        ring_reap(writer);
+    }
+#endif
+    return writer->failed ? PLATFORM_ERROR_FILE_WRITE : PLATFORM_ERROR_SUCCESS;
+}
+
+uint64_t platform_file_writer_size(PlatformFileWriterHandle writer) {
+    return writer ? writer->size : 0;
+}
+
+bool platform_file_writer_is_async(PlatformFileWriterHandle writer) {
+#if PLATFORM_FILE_IO_URING
+    return writer && writer->async;
+#else
+    (void)writer;
+    return false;
+#endif
+}
+
+PlatformErrorCode platform_file_writer_close(PlatformFileWriterHandle writer) {
+    if (!writer) {
+        return PLATFORM_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (writer->fd != -1) {
+        platform_file_writer_flush(writer, false);
+#if PLATFORM_FILE_IO_URING
+        if (writer->async) {
+            while (writer->ring.in_flight > 0) {
+                if (!ring_enter(&writer->ring, 1)) {
+                    writer->failed = true;
+                    break;
+                }
+                ring_reap(writer);
+            }
+        }
+#endif
+        close(writer->fd);
+    }
+#if PLATFORM_FILE_IO_URING
+    if (writer->has_ring) {
+        ring_close(&writer->ring);
+    }
+#endif
+
+    PlatformErrorCode result = writer->failed ? PLATFORM_ERROR_FILE_WRITE : PLATFORM_ERROR_SUCCESS;
+    for (unsigned i = 0; i < writer->buffer_count; i++) {
+        free(writer->buffers[i].data);
+    }
+    free(writer->buffers);
+    free(writer);
+    return result;
+}
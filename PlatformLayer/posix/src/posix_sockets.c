@@ -330,6 +330,20 @@ PlatformErrorCode platform_socket_listen(
     return PLATFORM_ERROR_SUCCESS;
 }
 
+static void fill_socket_address(const struct sockaddr_storage* addr, PlatformSocketAddress* address) {
+    if (addr->ss_family == AF_INET6) {
+        const struct sockaddr_in6* addr6 = (const struct sockaddr_in6*)addr;
+        address->is_ipv6 = true;
+        address->port = ntohs(addr6->sin6_port);
+        inet_ntop(AF_INET6, &addr6->sin6_addr, address->host, sizeof(address->host));
+    } else {
+        const struct sockaddr_in* addr4 = (const struct sockaddr_in*)addr;
+        address->is_ipv6 = false;
+        address->port = ntohs(addr4->sin_port);
+        inet_ntop(AF_INET, &addr4->sin_addr, address->host, sizeof(address->host));
+    }
+}
+
 PlatformErrorCode platform_socket_accept(
     PlatformSocketHandle handle,
     PlatformSocketHandle* client_handle,
@@ -359,19 +373,7 @@ PlatformErrorCode platform_socket_accept(
     client->opts = handle->opts;
 
     if (client_address) {
-        if (addr.ss_family == AF_INET6) {
-            struct sockaddr_in6* addr6 = (struct sockaddr_in6*)&addr;
-            client_address->is_ipv6 = true;
-            client_address->port = ntohs(addr6->sin6_port);
-            inet_ntop(AF_INET6, &addr6->sin6_addr, 
-                     client_address->host, sizeof(client_address->host));
-        } else {
-            struct sockaddr_in* addr4 = (struct sockaddr_in*)&addr;
-            client_address->is_ipv6 = false;
-            client_address->port = ntohs(addr4->sin_port);
-            inet_ntop(AF_INET, &addr4->sin_addr, 
-                     client_address->host, sizeof(client_address->host));
-        }
+        fill_socket_address(&addr, client_address);
     }
 
     *client_handle = client;
@@ -462,6 +464,33 @@ PlatformErrorCode platform_socket_get_stats(
     return PLATFORM_ERROR_SUCCESS;
 }
 
+PlatformErrorCode platform_socket_get_endpoints(
+    PlatformSocketHandle handle,
+    PlatformSocketAddress* local,
+    PlatformSocketAddress* remote)
+{
+    if (!handle) {
+        return PLATFORM_ERROR_INVALID_ARGUMENT;
+    }
+
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    if (local) {
+        if (getsockname(handle->fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+            return PLATFORM_ERROR_SOCKET_CLOSED;
+        }
+        fill_socket_address(&addr, local);
+    }
+    addr_len = sizeof(addr);
+    if (remote) {
+        if (getpeername(handle->fd, (struct sockaddr*)&addr, &addr_len) != 0) {
+            return PLATFORM_ERROR_SOCKET_CLOSED;
+        }
+        fill_socket_address(&addr, remote);
+    }
+    return PLATFORM_ERROR_SUCCESS;
+}
+
 PlatformErrorCode platform_socket_error_string(
     PlatformErrorCode error_code,
     char* buffer,
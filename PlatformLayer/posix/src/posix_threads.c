@@ -6,6 +6,11 @@
 
 #include "platform_error.h"
 
+// glibc only declares SCHED_IDLE with _GNU_SOURCE; the value is fixed by the kernel ABI
+#if defined(__linux__) && !defined(SCHED_IDLE)
+#define SCHED_IDLE 5
+#endif
+
 PlatformErrorCode platform_thread_init(void) {
     return PLATFORM_ERROR_SUCCESS;  // No specific init needed for POSIX threads
 }
@@ -111,6 +116,12 @@ PlatformErrorCode platform_thread_set_priority(
     // Map platform priority to POSIX priority
     switch (priority) {
         case PLATFORM_THREAD_PRIORITY_LOWEST:
+#ifdef SCHED_IDLE
+            // Linux gives ordinary threads no priority range; SCHED_IDLE runs them only on otherwise idle CPUs
+            if (sched_get_priority_min(policy) == sched_get_priority_max(policy)) {
+                policy = SCHED_IDLE;
+            }
+#endif
             param.sched_priority = sched_get_priority_min(policy);
             break;
         case PLATFORM_THREAD_PRIORITY_LOW:
@@ -325,6 +325,38 @@ uint64_t platform_atomic_fetch_add_uint64(PlatformAtomicUInt64* atomic, uint64_t
     return (uint64_t)InterlockedExchangeAdd64((volatile LONGLONG*)&atomic->value, (LONGLONG)value);
 }
 
+// Explicitly ordered load and store
+uint64_t platform_atomic_load_uint64_explicit(const PlatformAtomicUInt64* atomic, PlatformMemoryOrder order) {
+#ifdef _M_X64
+    // x64 does not move a load after later loads or stores; only the compiler must be held back
+    uint64_t value = (uint64_t)*(volatile const LONGLONG*)&atomic->value;
+    if (order != PLATFORM_MEMORY_ORDER_RELAXED) {
+        _ReadWriteBarrier();
+    }
+    return value;
+#else
+    (void)order;
+    return platform_atomic_load_uint64(atomic);
+#endif
+}
+
+void platform_atomic_store_uint64_explicit(PlatformAtomicUInt64* atomic, uint64_t value, PlatformMemoryOrder order) {
+#ifdef _M_X64
+    // Only a sequentially consistent store needs the locked exchange
+    if (order == PLATFORM_MEMORY_ORDER_SEQ_CST) {
+        InterlockedExchange64((volatile LONGLONG*)&atomic->value, (LONGLONG)value);
+        return;
+    }
+    if (order != PLATFORM_MEMORY_ORDER_RELAXED) {
+        _ReadWriteBarrier();
+    }
+    *(volatile LONGLONG*)&atomic->value = (LONGLONG)value;
+#else
+    (void)order;
+    platform_atomic_store_uint64(atomic, value);
+#endif
+}
+
 // Memory fence operation
 void platform_atomic_thread_fence(PlatformMemoryOrder order) {
     switch (order) {
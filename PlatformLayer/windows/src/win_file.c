@@ -1,6 +1,8 @@
 #include "platform_file.h"
 #include "platform_error.h"
 #include <windows.h>
+#include <stdlib.h>
+#include <string.h>
 
 #define MAX_FILE_HANDLES 256
 
@@ -9,6 +11,12 @@ struct PlatformFile {
     bool is_valid;
 };
 
+struct PlatformFileMapping {
+    HANDLE file;
+    HANDLE mapping;
+    void* address;
+};
+
 static struct PlatformFile g_file_pool[MAX_FILE_HANDLES];
 static bool g_file_pool_used[MAX_FILE_HANDLES];
 
@@ -136,6 +144,222 @@ void platform_file_close(PlatformFileHandle handle) {
     }
 }
 
+PlatformFileMappingHandle platform_file_map_create(
+    const char* filepath,
+    size_t size,
+    void** address,
+    PlatformErrorCode* error_code
+) {
+    if (!filepath || size == 0 || !address) {
+        if (error_code) *error_code = PLATFORM_ERROR_INVALID_ARGUMENT;
+        return NULL;
+    }
+
+    PlatformFileMappingHandle mapping = malloc(sizeof(struct PlatformFileMapping));
+    if (!mapping) {
+        if (error_code) *error_code = PLATFORM_ERROR_OUT_OF_MEMORY;
+        return NULL;
+    }
+
+    mapping->file = CreateFileA(
+        filepath,
+        GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ,
+        NULL,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if (mapping->file == INVALID_HANDLE_VALUE) {
+        free(mapping);
+        if (error_code) *error_code = PLATFORM_ERROR_FILE_OPEN;
+        return NULL;
+    }
+
+    // Mapping with an explicit size extends the file, zero filled
+    ULARGE_INTEGER mapping_size;
+    mapping_size.QuadPart = size;
+    mapping->mapping = CreateFileMappingA(mapping->file, NULL, PAGE_READWRITE,
+                                          mapping_size.HighPart, mapping_size.LowPart, NULL);
+    if (!mapping->mapping) {
+        CloseHandle(mapping->file);
+        free(mapping);
+        if (error_code) *error_code = PLATFORM_ERROR_FILE_WRITE;
+        return NULL;
+    }
+
+    mapping->address = MapViewOfFile(mapping->mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    if (!mapping->address) {
+        CloseHandle(mapping->mapping);
+        CloseHandle(mapping->file);
+        free(mapping);
+        if (error_code) *error_code = PLATFORM_ERROR_OUT_OF_MEMORY;
+        return NULL;
+    }
+
+    *address = mapping->address;
+    if (error_code) *error_code = PLATFORM_ERROR_SUCCESS;
+    return mapping;
+}
+
+void platform_file_map_close(PlatformFileMappingHandle mapping) {
+    if (mapping) {
+        UnmapViewOfFile(mapping->address);
+        CloseHandle(mapping->mapping);
+        CloseHandle(mapping->file);
+        free(mapping);
+    }
+}
+
+bool platform_file_map_sync(PlatformFileMappingHandle mapping, size_t offset, size_t length) {
+    if (!mapping) {
+        return false;
+    }
+    // Starts writing the dirty pages out without waiting for the disk
+    return FlushViewOfFile((char*)mapping->address + offset, length) != 0;
+}
+
+bool platform_file_map_close_at(PlatformFileMappingHandle mapping, size_t file_size) {
+    if (!mapping) {
+        return false;
+    }
+    UnmapViewOfFile(mapping->address);
+    CloseHandle(mapping->mapping);
+
+    LARGE_INTEGER end;
+    end.QuadPart = (LONGLONG)file_size;
+    bool truncated = SetFilePointerEx(mapping->file, end, NULL, FILE_BEGIN) && SetEndOfFile(mapping->file);
+    CloseHandle(mapping->file);
+    free(mapping);
+    return truncated;
+}
+
+// Buffered writer; each flushed buffer is written before the call returns
+struct PlatformFileWriter {
+    HANDLE file;
+    char* buffer;
+    size_t buffer_size;
+    size_t used;
+    uint64_t size;   // size of the file including what is buffered
+    bool failed;     // a write has failed; reported by every later call
+};
+
+static void writer_write_buffer(PlatformFileWriterHandle writer) {
+    const char* data = writer->buffer;
+    size_t remaining = writer->used;
+    while (remaining > 0) {
+        DWORD chunk = remaining > MAXDWORD ? MAXDWORD : (DWORD)remaining;
+        DWORD written = 0;
+        if (!WriteFile(writer->file, data, chunk, &written, NULL) || written == 0) {
+            writer->failed = true;
+            break;
+        }
+        data += written;
+        remaining -= written;
+    }
+    writer->used = 0;
+}
+
+PlatformFileWriterHandle platform_file_writer_open(
+    const char* filepath,
+    bool truncate,
+    size_t buffer_size,
+    unsigned buffer_count,
+    PlatformErrorCode* error_code
+) {
+    (void)buffer_count;  // writes block, so one buffer is all that is ever in use
+    if (!filepath || buffer_size == 0) {
+        if (error_code) *error_code = PLATFORM_ERROR_INVALID_ARGUMENT;
+        return NULL;
+    }
+
+    PlatformFileWriterHandle writer = calloc(1, sizeof(struct PlatformFileWriter));
+    char* buffer = malloc(buffer_size);
+    if (!writer || !buffer) {
+        free(writer);
+        free(buffer);
+        if (error_code) *error_code = PLATFORM_ERROR_OUT_OF_MEMORY;
+        return NULL;
+    }
+
+    // FILE_APPEND_DATA alone makes every write land at the end of the file
+    writer->file = CreateFileA(
+        filepath,
+        FILE_APPEND_DATA,
+        FILE_SHARE_READ | FILE_SHARE_DELETE,
+        NULL,
+        truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL
+    );
+    if (writer->file == INVALID_HANDLE_VALUE) {
+        free(buffer);
+        free(writer);
+        if (error_code) *error_code = PLATFORM_ERROR_FILE_OPEN;
+        return NULL;
+    }
+
+    LARGE_INTEGER size;
+    writer->size = GetFileSizeEx(writer->file, &size) ? (uint64_t)size.QuadPart : 0;
+    writer->buffer = buffer;
+    writer->buffer_size = buffer_size;
+    if (error_code) *error_code = PLATFORM_ERROR_SUCCESS;
+    return writer;
+}
+
+PlatformErrorCode platform_file_writer_write(PlatformFileWriterHandle writer, const void* data, size_t length) {
+    if (!writer || (!data && length > 0)) {
+        return PLATFORM_ERROR_INVALID_ARGUMENT;
+    }
+
+    const char* bytes = data;
+    while (length > 0) {
+        size_t room = writer->buffer_size - writer->used;
+        size_t chunk = length < room ? length : room;
+        memcpy(writer->buffer + writer->used, bytes, chunk);
+        writer->used += chunk;
+        writer->size += chunk;
+        bytes += chunk;
+        length -= chunk;
+        if (writer->used == writer->buffer_size) {
+            writer_write_buffer(writer);
+        }
+    }
+    return writer->failed ? PLATFORM_ERROR_FILE_WRITE : PLATFORM_ERROR_SUCCESS;
+}
+
+PlatformErrorCode platform_file_writer_flush(PlatformFileWriterHandle writer, bool sync) {
+    if (!writer) {
+        return PLATFORM_ERROR_INVALID_ARGUMENT;
+    }
+    writer_write_buffer(writer);
+    if (sync && !FlushFileBuffers(writer->file)) {
+        writer->failed = true;
+    }
+    return writer->failed ? PLATFORM_ERROR_FILE_WRITE : PLATFORM_ERROR_SUCCESS;
+}
+
+uint64_t platform_file_writer_size(PlatformFileWriterHandle writer) {
+    return writer ? writer->size : 0;
+}
+
+bool platform_file_writer_is_async(PlatformFileWriterHandle writer) {
+    (void)writer;
+    return false;
+}
+
+PlatformErrorCode platform_file_writer_close(PlatformFileWriterHandle writer) {
+    if (!writer) {
+        return PLATFORM_ERROR_INVALID_ARGUMENT;
+    }
+    writer_write_buffer(writer);
+    CloseHandle(writer->file);
+    PlatformErrorCode result = writer->failed ? PLATFORM_ERROR_FILE_WRITE : PLATFORM_ERROR_SUCCESS;
+    free(writer->buffer);
+    free(writer);
+    return result;
+}
+
 #ifdef _DEBUG
 // Debug helper to check for file handle leaks
 size_t platform_file_get_open_count(void) {
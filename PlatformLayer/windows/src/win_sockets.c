@@ -309,6 +309,20 @@ PlatformErrorCode platform_socket_listen(
     return PLATFORM_ERROR_SUCCESS;
 }
 
+static void fill_socket_address(const SOCKADDR_STORAGE* addr, PlatformSocketAddress* address) {
+    if (addr->ss_family == AF_INET6) {
+        const SOCKADDR_IN6* addr6 = (const SOCKADDR_IN6*)addr;
+        address->is_ipv6 = true;
+        address->port = ntohs(addr6->sin6_port);
+        InetNtopA(AF_INET6, &addr6->sin6_addr, address->host, sizeof(address->host));
+    } else {
+        const SOCKADDR_IN* addr4 = (const SOCKADDR_IN*)addr;
+        address->is_ipv6 = false;
+        address->port = ntohs(addr4->sin_port);
+        InetNtopA(AF_INET, &addr4->sin_addr, address->host, sizeof(address->host));
+    }
+}
+
 PlatformErrorCode platform_socket_accept(
     PlatformSocketHandle handle,
     PlatformSocketHandle* client_handle,
@@ -338,19 +352,7 @@ PlatformErrorCode platform_socket_accept(
     client->opts = handle->opts;
 
     if (client_address) {
-        if (addr.ss_family == AF_INET6) {
-            SOCKADDR_IN6* addr6 = (SOCKADDR_IN6*)&addr;
-            client_address->is_ipv6 = true;
-            client_address->port = ntohs(addr6->sin6_port);
-            InetNtopA(AF_INET6, &addr6->sin6_addr, 
-                    client_address->host, sizeof(client_address->host));
-        } else {
-            SOCKADDR_IN* addr4 = (SOCKADDR_IN*)&addr;
-            client_address->is_ipv6 = false;
-            client_address->port = ntohs(addr4->sin_port);
-            InetNtopA(AF_INET, &addr4->sin_addr, 
-                    client_address->host, sizeof(client_address->host));
-        }
+        fill_socket_address(&addr, client_address);
     }
 
     *client_handle = client;
@@ -434,6 +436,33 @@ PlatformErrorCode platform_socket_is_connected(
     return PLATFORM_ERROR_SUCCESS;
 }
 
+PlatformErrorCode platform_socket_get_endpoints(
+    PlatformSocketHandle handle,
+    PlatformSocketAddress* local,
+    PlatformSocketAddress* remote)
+{
+    if (!handle) {
+        return PLATFORM_ERROR_INVALID_ARGUMENT;
+    }
+
+    SOCKADDR_STORAGE addr;
+    int addr_len = sizeof(addr);
+    if (local) {
+        if (getsockname(handle->fd, (SOCKADDR*)&addr, &addr_len) != 0) {
+            return PLATFORM_ERROR_SOCKET_CLOSED;
+        }
+        fill_socket_address(&addr, local);
+    }
+    addr_len = sizeof(addr);
+    if (remote) {
+        if (getpeername(handle->fd, (SOCKADDR*)&addr, &addr_len) != 0) {
+            return PLATFORM_ERROR_SOCKET_CLOSED;
+        }
+        fill_socket_address(&addr, remote);
+    }
+    return PLATFORM_ERROR_SUCCESS;
+}
+
 const char* platform_socket_error_to_string(PlatformErrorCode error) {
     switch (error) {
         case PLATFORM_ERROR_SUCCESS: